@@ -15,26 +15,190 @@
 #define MIPS_ASSEMBLER_HPP
 
 /** C++ Includes */
+#include <array>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 /** Local Includes */
 #include "common.hpp"
+#include "file.hpp"
+#include "lexer.hpp"
+#include "obj.hpp"
 
 namespace mips
 {
-      /** This structure maps symbols to addresses */
+      /** Segments the assembler emits into */
+      enum class Segment : byte_t { Text, Data };
+
+      /** A defined symbol */
       struct Symbol {
-            std::string name;       /** The symbol name */
             address_t address;      /** The address */
+            Segment segment;        /** The segment it lives in */
+            size_t line;            /** The line it is defined on */
+      };
+
+      /** How a symbol reference is patched into the binary */
+      enum class FixupKind : byte_t {
+            Branch,     /** 16 bit word offset from the next instruction */
+            Jump,       /** 26 bit word address of a j/jal */
+            Word        /** Full 32 bit address (.word) */
+      };
 
-            Symbol(std::string name, address_t address) : name(name), address(address) {}
+      /** A reference to a symbol that may not be defined yet */
+      struct Fixup {
+            FixupKind kind;
+            Segment segment;        /** Segment holding the patched bytes */
+            word_t offset;          /** Offset of the patched word in its segment (chunk) */
+            size_t line;            /** Line of the reference, for errors */
+            std::string_view symbol;      /** The referenced symbol (a view of the source) */
+      };
+
+      /**
+       * @brief A line aligned slice of the source, assembled on its own
+       *
+       * @details A chunk assembles into its own text and data buffers as if
+       *          they started at the given base addresses. Labels keep the
+       *          address they would have at that base and every symbol
+       *          reference becomes a fixup, so once the chunks are laid out
+       *          one after the other only the bases have to be corrected.
+       */
+      class Chunk
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] source The lines of the chunk
+             * @param[i] first_line The line number of its first line
+             */
+            Chunk(std::string_view source, size_t first_line) : source(source), first_line(first_line) {}
+
+            /**
+             * @brief Finds the segment the chunk leaves selected
+             *
+             * @details Only lexes the source, looking for .text and .data.
+             *
+             * @return The segment of the last .text or .data, if any
+             */
+            std::optional<Segment> scan_segment() const;
+
+            /**
+             * @brief Assembles the chunk
+             *
+             * @details Syntax errors are kept (see get_error) instead of being
+             *          thrown, so that chunks assembled on worker threads report
+             *          them in source order.
+             *
+             * @param[i] start The segment in effect before the chunk
+             * @param[i] text_base The address of the first text byte
+             * @param[i] data_base The address of the first data byte
+             */
+            void assemble(Segment start, address_t text_base, address_t data_base);
+
+            /**
+             * @brief Patches the fixups of the chunk into the final segments
+             *
+             * @details The fixups must have been relocated to the final
+             *          segments. Errors are kept as in assemble().
+             *
+             * @param[i] symbols The symbol table
+             * @param[io] text The text segment
+             * @param[io] data The data segment
+             */
+            void backpatch(const std::unordered_map<std::string_view, Symbol>& symbols, std::vector<byte_t>& text, std::vector<byte_t>& data);
+
+            /** @brief Returns the first error of the last assemble() or backpatch(), if any */
+            std::exception_ptr get_error() const { return error; }
+
+      private:
+            friend class Assembler;
+
+            /** @brief Assembles the source up to the first error */
+            void parse();
+
+            /**
+             * @brief Reads the operands of a statement up to the end of the line
+             *
+             * @param[io] lexer The lexer, past the mnemonic or directive
+             * @throw mips::SyntaxException If the operands are not comma separated
+             */
+            void read_operands(Lexer& lexer);
+
+            /**
+             * @brief Assembles one instruction
+             *
+             * @param[i] mnemonic The mnemonic (operands are in this->operands)
+             * @throw mips::SyntaxException If the instruction is invalid
+             */
+            void assemble_instruction(std::string_view mnemonic);
+
+            /**
+             * @brief Assembles one directive (.text, .data, .word, ...)
+             *
+             * @param[i] directive The directive (operands are in this->operands)
+             * @throw mips::SyntaxException If the directive is invalid
+             */
+            void assemble_directive(std::string_view directive);
+
+            /**
+             * @brief Pads the current segment to an alignment
+             *
+             * @param[i] alignment The alignment in bytes (a power of two)
+             */
+            void align(size_t alignment);
+
+            /**
+             * @brief Records a label at the current address
+             *
+             * @param[i] name The label
+             */
+            void define_label(std::string_view name);
+
+            /**
+             * @brief Records a reference to a symbol at the current address
+             *
+             * @param[i] kind How the reference is patched
+             * @param[i] symbol The referenced symbol
+             */
+            void add_fixup(FixupKind kind, std::string_view symbol);
+
+            /** @brief Returns the bytes of the current segment */
+            std::vector<byte_t>& current() { return bytes[size_t(segment)]; }
+
+            /** @brief Returns the address of the next byte of the current segment */
+            address_t here() const { return base[size_t(segment)] + bytes[size_t(segment)].size(); }
+
+            /** Member Variables */
+            std::string_view source;                                    /** The lines of the chunk */
+            size_t first_line;                                          /** Line number of the first line */
+            Segment start = Segment::Text;                              /** Segment in effect before the chunk */
+            Segment segment = Segment::Text;                            /** The segment being assembled */
+            size_t line = 0;                                            /** The current line */
+            std::array<address_t, 2> base = {};                         /** Assumed address of each segment */
+            std::array<size_t, 2> alignment = {};                       /** Largest alignment padded to, per segment */
+            std::array<std::vector<byte_t>, 2> bytes;                   /** The text and data bytes */
+            std::vector<std::pair<std::string_view, Symbol>> labels;    /** Labels, in definition order */
+            std::vector<Fixup> fixups;                                  /** References to symbols */
+            std::vector<std::pair<word_t, size_t>> lines;               /** Text offset and line of each instruction */
+            std::vector<Token> operands;                                /** Operands of the current statement */
+            std::exception_ptr error;                                   /** The first error */
       };
 
       class Assembler
       {
       public:
-            Assembler() {}
+            /**
+             * @brief Constructor
+             *
+             * @param[i] threads Worker threads for large sources (0 = one per core)
+             */
+            Assembler(size_t threads = 0) : threads(threads) {}
             ~Assembler() {}
 
             /**
@@ -42,46 +206,92 @@ namespace mips
              *
              * @param[i] filename The filename
              * @param[i] output The output filename
-             * @throw std::runtime_error If the file is not found
-             * @throw std::runtime_error If the file contains syntax errors
+             * @throw mips::FileException If the file is not found
+             * @throw mips::SyntaxException If the file contains syntax errors
              */
             void assemble(std::string filename, std::string output);
+
+            /**
+             * @brief Gets the symbol table of the last assembled file
+             *
+             * @details Names are views of the source, valid until the
+             *          assembler is destroyed.
+             *
+             * @return The symbols, by name
+             */
+            const std::unordered_map<std::string_view, Symbol>& get_symbols() const { return symbols; }
       
       private:
             /**
-             * @brief Loads the file into memory
+             * @brief Maps the file into memory
              *
              * @param[i] filename The filename
-             * @throw std::runtime_error If the file is not found
+             * @throw mips::FileException If the file is not found
              */
             void load_file(std::string filename);
 
             /**
-             * @brief First pass
+             * @brief Splits the source into chunks at line boundaries
+             *
+             * @details One chunk per worker, but no chunk smaller than
+             *          MIN_CHUNK_SIZE, so small sources stay in one chunk.
+             *          Chunks end on a line with a statement, so a label
+             *          alone on its line stays with the statement it names.
+             *
+             * @param[i] workers The number of worker threads
+             */
+            void split(size_t workers);
+
+            /**
+             * @brief Assembles the chunks and lays them out
              *
-             * @details This function parses the file and stores the labels.
-             *          It also checks for syntax errors.
-             * 
-             * @throw std::runtime_error If the file contains syntax errors
+             * @details Each chunk is assembled on a worker thread assuming
+             *          it starts on a page boundary, in the segment its
+             *          predecessors leave behind (found by a quick scan).
+             *          The chunks are then appended in order and their
+             *          labels entered into the symbol table, shifted by
+             *          the actual start of each segment. A chunk whose
+             *          padding would differ at its actual start (or that
+             *          starts in another segment) is assembled again, in
+             *          place, so the output is that of a serial assembly.
+             *
+             * @throw mips::SyntaxException If the file contains syntax errors
+             */
+            void parse();
+
+            /**
+             * @brief Patches every recorded reference with its symbol address
+             *
+             * @throw mips::SyntaxException If a symbol is undefined or a
+             *        branch target is out of range
              */
-            void first_pass();
+            void backpatch();
 
             /**
-             * @brief Second pass
+             * @brief Runs a task for every chunk on the worker threads
+             *
+             * @param[i] task Called with the index of each chunk
+             */
+            void for_each_chunk(const std::function<void(size_t)>& task);
+
+            /**
+             * @brief Gathers the symbols, relocations and line map for the binary
+             *
+             * @details Symbols are sorted by address (then name), so the
+             *          output does not depend on hash table order.
              *
-             * @details This function parses the file and assembles the binary.
-             * 
-             * @throw std::runtime_error If the file contains syntax errors
+             * @return The debug info
              */
-            void second_pass();
+            MIPS_debug_info collect_debug_info() const;
 
             /** Member Variables */
-            std::vector<std::string> file_contents;  /** The file contents (assembly code) */
-            std::vector<Symbol> labels;              /** The labels */
-            std::vector<byte_t> binary;              /** The generated binary (executable bytecode) */
-            int line = 0;                            /** The current line */
-            word_t text_size = 0;                    /** The size of the text segment */
-            [[maybe_unused]] word_t data_size = 0;   /** The size of the data segment */
+            size_t threads;                                       /** Worker threads (0 = one per core) */
+            std::unique_ptr<MappedFile> file;                     /** The mapped source file */
+            std::string_view source;                              /** The file contents (assembly code) */
+            std::vector<Chunk> chunks;                            /** The source, split for the workers */
+            std::unordered_map<std::string_view, Symbol> symbols; /** The symbol table */
+            std::vector<byte_t> text;                             /** The text segment (executable bytecode) */
+            std::vector<byte_t> data;                             /** The data segment */
       };
 } // namespace mipspp
 
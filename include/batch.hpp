@@ -0,0 +1,191 @@
+/**
+ * @file    batch.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ batch runner.
+ *          The batch runner executes many MIPS binaries in parallel, one
+ *          emulator per task, and collects the results in a report.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_BATCH_HPP
+#define MIPS_BATCH_HPP
+
+/** C++ Includes */
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "emulator.hpp"
+#include "memory.hpp"
+
+namespace mips
+{
+      /** Instructions executed between timeout checks */
+      constexpr uint64_t BATCH_SLICE = 1 << 16;
+
+      /** Options shared by every task of a batch */
+      struct BatchOptions {
+            size_t threads = 0;                             /** Worker threads (0 = one per core) */
+            uint64_t budget = UINT64_MAX;                   /** Instruction budget per task */
+            uint64_t timeout_ms = 0;                        /** Wall clock limit per task (0 = none) */
+            MemoryBackend backend = MemoryBackend::Paged;
+            Engine engine = Engine::Interpreter;
+      };
+
+      /** Outcome of a batch task */
+      enum class TaskStatus { Halted, Faulted, BudgetExceeded, TimedOut, Error };
+
+      /** Result of a batch task */
+      struct TaskResult {
+            std::string path;             /** The binary */
+            TaskStatus status;
+            word_t exit_code;             /** Exit code (Halted) */
+            uint64_t instructions;        /** Instructions executed */
+            double seconds;               /** Wall clock time */
+            std::string output;           /** Captured syscall output */
+            std::string message;          /** Fault or error description */
+            TlbStats tlb;                 /** Memory TLB hits and misses */
+      };
+
+      /**
+       * @brief Work-stealing thread pool
+       *
+       * @details Every worker owns a deque of task indices. Workers pop from
+       *          the back of their own deque and, once it is empty, steal
+       *          from the front of the others, so long tasks do not leave
+       *          cores idle while another worker still has a backlog.
+       */
+      class WorkStealingPool
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] threads The number of workers (0 = one per core)
+             */
+            WorkStealingPool(size_t threads);
+            ~WorkStealingPool() {}
+
+            /**
+             * @brief Runs the tasks 0 .. count - 1 and waits for them
+             *
+             * @param[i] count The number of tasks
+             * @param[i] task Called with the index of each task, from any worker
+             */
+            void run(size_t count, const std::function<void(size_t)>& task);
+
+            /** @brief Gets the number of workers */
+            size_t size() const { return queues.size(); }
+
+      private:
+            /** A worker's tasks */
+            struct Queue {
+                  std::mutex mutex;
+                  std::deque<size_t> tasks;
+            };
+
+            /**
+             * @brief Takes the next task of the given worker
+             *
+             * @details Pops the worker's own queue first, then steals.
+             *
+             * @param[i] worker The worker index
+             * @param[o] task The task index
+             * @return true if a task was found
+             */
+            bool next_task(size_t worker, size_t& task);
+
+            std::vector<std::unique_ptr<Queue>> queues;
+      };
+
+      /**
+       * @brief Collects the binaries of a batch
+       *
+       * @details A directory yields every *.mips file in it (sorted), any
+       *          other file is read as a list with one path per line.
+       *
+       * @param[i] source The directory or list file
+       * @return The paths
+       * @throw mips::FileException If the source cannot be read
+       */
+      std::vector<std::string> collect_batch(const std::string& source);
+
+      /**
+       * @brief Runs a single task
+       *
+       * @details Syscall output is captured and input is empty. Never
+       *          throws: errors are reported in the result.
+       *
+       * @param[i] path The binary
+       * @param[i] options The batch options
+       * @return The result
+       */
+      TaskResult run_task(const std::string& path, const BatchOptions& options);
+
+      /**
+       * @brief Runs every binary of a batch in parallel
+       *
+       * @param[i] paths The binaries
+       * @param[i] options The batch options
+       * @return The results, in the order of the paths
+       */
+      std::vector<TaskResult> run_batch(const std::vector<std::string>& paths, const BatchOptions& options);
+
+      /**
+       * @brief Gets the name of a task status
+       *
+       * @param[i] status
+       * @return The name used in reports
+       */
+      std::string to_string(TaskStatus status);
+
+      /**
+       * @brief Writes a batch report as JSON
+       *
+       * @param[o] out
+       * @param[i] results
+       */
+      void write_json_report(std::ostream& out, const std::vector<TaskResult>& results);
+
+      /**
+       * @brief Writes a batch report as CSV
+       *
+       * @param[o] out
+       * @param[i] results
+       */
+      void write_csv_report(std::ostream& out, const std::vector<TaskResult>& results);
+} // namespace mips
+
+#endif // MIPS_BATCH_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,291 @@
+/**
+ * @file    cache.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ cache simulator.
+ *          A split L1 (instruction and data) backed by a unified L2 is
+ *          simulated over the accesses of the interpreted program. The
+ *          simulation only tracks tags; memory contents are untouched.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_CACHE_HPP
+#define MIPS_CACHE_HPP
+
+/** C++ Includes */
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+
+namespace mips
+{
+      /** Which line of a set is evicted */
+      enum class ReplacementPolicy : byte_t { Lru, Fifo, Random };
+
+      /** Geometry of one cache */
+      struct CacheConfig {
+            std::string name;
+            uint64_t size;                /** Capacity in bytes */
+            word_t associativity;         /** Lines per set */
+            word_t line_size;             /** Bytes per line */
+            ReplacementPolicy policy;
+      };
+
+      /** Geometry of the whole hierarchy */
+      struct CacheHierarchyConfig {
+            CacheConfig l1i;
+            CacheConfig l1d;
+            CacheConfig l2;
+      };
+
+      /**
+       * @brief Returns the default hierarchy
+       *
+       * @details 32 KiB 4-way L1I, 32 KiB 8-way L1D and 256 KiB 8-way L2,
+       *          all with 64 byte lines and LRU replacement.
+       *
+       * @return The configuration
+       */
+      CacheHierarchyConfig default_cache_config();
+
+      /**
+       * @brief Parses a hierarchy description
+       *
+       * @details "default", or a comma separated list of
+       *          level=size:ways:line:policy overriding the defaults, e.g.
+       *          "l1d=16k:2:32:fifo,l2=1m:16:64:lru". Sizes take k and m
+       *          suffixes; policies are lru, fifo and random.
+       *
+       * @param[i] description The description
+       * @return The configuration
+       * @throw mips::Exception If the description is invalid
+       */
+      CacheHierarchyConfig parse_cache_config(const std::string& description);
+
+      /** Counters of one cache */
+      struct CacheStats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;       /** Valid lines replaced */
+            uint64_t writebacks = 0;      /** Dirty lines replaced (write-back, write-allocate) */
+      };
+
+      /**
+       * @brief Set associative cache
+       *
+       * @details Tags, dirty bits and replacement stamps live in flat
+       *          arrays of sets * associativity entries; an access never
+       *          allocates. The tag is the whole line number, so no tag
+       *          ever matches INVALID_LINE.
+       */
+      class Cache
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] config The geometry
+             * @throw mips::Exception If the geometry is not made of powers of two
+             */
+            Cache(const CacheConfig& config);
+
+            /**
+             * @brief Looks an address up, filling its line on a miss
+             *
+             * @param[i] address The address
+             * @param[i] write Whether the access is a store (marks the line dirty)
+             * @return true on a hit
+             */
+            bool access(address_t address, bool write) {
+                  const word_t line = address >> line_shift;
+                  const size_t first = size_t(line & set_mask) * config.associativity;
+                  for (size_t way = first; way < first + config.associativity; way++) {
+                        if (tags[way] == line) {
+                              stats.hits++;
+                              if (config.policy == ReplacementPolicy::Lru) stamps[way] = ++clock;
+                              dirty[way] |= write;
+                              return true;
+                        }
+                  }
+                  fill(line, first, write);
+                  return false;
+            }
+
+            /**
+             * @brief Takes the address of the dirty line the last miss evicted
+             *
+             * @param[o] address The first address of the line
+             * @return false if the last miss did not evict a dirty line
+             */
+            bool take_writeback(address_t& address) {
+                  if (writeback == INVALID_LINE) return false;
+                  address = writeback << line_shift;
+                  writeback = INVALID_LINE;
+                  return true;
+            }
+
+            const CacheConfig& get_config() const { return config; }
+            const CacheStats& get_stats() const { return stats; }
+
+      private:
+            static constexpr word_t INVALID_LINE = UINT32_MAX;
+
+            /**
+             * @brief Fills a line after a miss
+             *
+             * @param[i] line The line number
+             * @param[i] first The first way of its set
+             * @param[i] write Whether the access is a store
+             */
+            void fill(word_t line, size_t first, bool write);
+
+            CacheConfig config;
+            word_t line_shift;
+            word_t set_mask;
+            std::vector<word_t> tags;
+            std::vector<uint64_t> stamps;       /** Last use (LRU) or fill (FIFO) */
+            std::vector<byte_t> dirty;
+            uint64_t clock = 0;
+            uint64_t random = 0x9E3779B97F4A7C15;
+            word_t writeback = INVALID_LINE;
+            CacheStats stats;
+      };
+
+      /**
+       * @brief Split L1 and unified L2 cache hierarchy
+       *
+       * @details Used as the inspector of CPU::run_inspected(): every
+       *          fetch goes to the L1I, every load and store to the L1D,
+       *          and their misses and dirty evictions to the L2. Misses are
+       *          also counted per instruction, in an array with one entry
+       *          per word of Memory::get_text_size().
+       */
+      class CacheHierarchy
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] config The geometry
+             * @param[i] memory The memory of the simulated program (sizes the
+             *                  per instruction counters)
+             * @throw mips::Exception If a geometry is invalid
+             */
+            CacheHierarchy(const CacheHierarchyConfig& config, Memory* memory);
+
+            /**
+             * @brief Simulates the accesses of an instruction
+             *
+             * @param[i] cpu The CPU, before the instruction executes
+             * @param[i] decoded The instruction
+             */
+            void operator()(const CPU& cpu, const DecodedInstruction& decoded) {
+                  const address_t index = (decoded.pc - TEXT_OFFSET) >> 2;
+                  PcStats* pc = index < per_pc.size() ? &per_pc[index] : &outside;
+
+                  if (!l1i.access(decoded.pc, false)) {
+                        pc->fetch_misses++;
+                        next_level(l1i);
+                        l2.access(decoded.pc, false);
+                  }
+
+                  switch (decoded.op) {
+                        case Operation::Lb:
+                        case Operation::Lbu:
+                        case Operation::Lh:
+                        case Operation::Lhu:
+                        case Operation::Lw:
+                              data(cpu.get_register(decoded.rs) + decoded.immediate, false, *pc);
+                              break;
+                        case Operation::Sb:
+                        case Operation::Sh:
+                        case Operation::Sw:
+                              data(cpu.get_register(decoded.rs) + decoded.immediate, true, *pc);
+                              break;
+                        default:
+                              break;
+                  }
+            }
+
+            /**
+             * @brief Writes the statistics of every cache and the instructions
+             *        that miss the most
+             *
+             * @param[o] output The stream
+             */
+            void write_report(std::ostream& output);
+
+      private:
+            /** Counters of one instruction */
+            struct PcStats {
+                  uint64_t fetch_misses = 0;
+                  uint64_t data_accesses = 0;
+                  uint64_t data_misses = 0;
+            };
+
+            /**
+             * @brief Simulates a data access
+             *
+             * @param[i] address The address
+             * @param[i] write Whether it is a store
+             * @param[io] pc The counters of the instruction
+             */
+            void data(address_t address, bool write, PcStats& pc) {
+                  pc.data_accesses++;
+                  if (!l1d.access(address, write)) {
+                        pc.data_misses++;
+                        next_level(l1d);
+                        l2.access(address, false);
+                  }
+            }
+
+            /**
+             * @brief Writes back the line an L1 miss evicted, if dirty
+             *
+             * @param[io] l1 The first level cache
+             */
+            void next_level(Cache& l1) {
+                  address_t address;
+                  if (l1.take_writeback(address)) l2.access(address, true);
+            }
+
+            Cache l1i;
+            Cache l1d;
+            Cache l2;
+            Memory* memory;
+            std::vector<PcStats> per_pc;
+            PcStats outside;        /** Instructions outside the text segment */
+      };
+} // namespace mips
+
+#endif // MIPS_CACHE_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
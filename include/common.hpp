@@ -14,7 +14,10 @@
 #define MIPS_COMMON_HPP
 
 /** C++ Includes */
+#include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <string>
 
 namespace mips
 {
@@ -13,12 +13,67 @@
 #ifndef MIPS_CPU_HPP
 #define MIPS_CPU_HPP
 
+/** C++ Includes */
+#include <string>
+#include <vector>
+
 /** Local Includes */
 #include "common.hpp"
+#include "except.hpp"
+#include "instruction.hpp"
 #include "memory.hpp"
+#include "syscall.hpp"
 
 namespace mips
 {
+      class CPU;
+
+      /**
+       * @brief Decoded instruction
+       *
+       * @details An instruction with its fields already extracted, ready to be
+       *          executed by calling its handler. The immediate is extended
+       *          once at decode time (sign extended for arithmetic, memory and
+       *          branch instructions, zero extended for logical ones).
+       */
+      struct DecodedInstruction {
+            using handler_t = void (*)(CPU&, const DecodedInstruction&);
+
+            handler_t handler;      /** Executes the instruction */
+            address_t pc;           /** Address the instruction was fetched from */
+            Operation op;           /** The operation */
+            byte_t rs;              /** Source register */
+            byte_t rt;              /** Target register */
+            byte_t rd;              /** Destination register */
+            byte_t shamt;           /** Shift amount */
+            word_t immediate;       /** Extended immediate / jump target */
+      };
+
+      /** Execution status of the CPU */
+      enum class Status : byte_t { Running, Halted, Faulted };
+
+      /** Reasons for a guest fault */
+      enum class FaultCause : byte_t {
+            None,
+            InvalidInstruction,
+            InvalidSyscall,
+            Overflow,         /** Signed overflow in add, addi or sub */
+            AddressError,     /** Misaligned halfword or word access */
+            Breakpoint,       /** break instruction */
+            AccessViolation   /** Access outside the segments or against their permissions */
+      };
+
+      /** Architectural state of a CPU */
+      struct CPUState {
+            register_t pc;
+            register_t hi;
+            register_t lo;
+            register_t registers[32];
+      };
+
+      /** Number of entries in the decoded instruction cache (direct mapped) */
+      constexpr size_t DECODE_CACHE_SIZE = 4096;
+
       /**
        * @brief CPU class
        *
@@ -37,10 +92,159 @@ namespace mips
              * @brief Steps the CPU
              *
              * @details This function goes through one fetch-decode-execute
-             *          cycle.
+             *          cycle. Decoded instructions are cached by PC, so only
+             *          the first visit of an address pays for fetch and decode.
              */
             void step();
 
+            /**
+             * @brief Steps the CPU, showing the instruction to an inspector
+             *
+             * @details The inspector is called with the CPU and the decoded
+             *          instruction after fetch and decode, right before the
+             *          instruction executes, so it sees the registers the
+             *          instruction reads (see mips::CacheHierarchy).
+             *
+             * @param[i] inspector Called with the CPU and the instruction
+             */
+            template <typename Inspector>
+            void step(Inspector&& inspector) {
+                  /** A write landed on a code page since the cache was filled */
+                  if (decode_cache_version != memory->get_code_version()) {
+                        flush_decode_cache();
+                  }
+
+                  const address_t address = pc;
+                  try {
+                        DecodedInstruction& decoded = decode_cache[(address >> 2) & (DECODE_CACHE_SIZE - 1)];
+                        if (decoded.pc != address) {
+                              decode(fetch(address), decoded);
+                              decoded.pc = address;
+                        }
+
+                        inspector(static_cast<const CPU&>(*this), static_cast<const DecodedInstruction&>(decoded));
+                        pc += sizeof(instruction_t);
+                        execute(decoded);
+                  } catch (const AccessViolation& violation) {
+                        raise_access_violation(violation, address);
+                  }
+            }
+
+            /**
+             * @brief Runs the CPU
+             *
+             * @details Steps the CPU until the budget is exhausted, the
+             *          program exits (syscall 10) or it faults. Neither
+             *          throws: they stop the loop by zeroing the budget and
+             *          set the status to Halted or Faulted. A faulting
+             *          instruction does not retire and leaves the program
+             *          counter pointing at it. A stopped CPU does not run
+             *          until clear_fault() or reset() is called.
+             *
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            uint64_t run(uint64_t budget);
+
+            /**
+             * @brief Runs the CPU until the predicate holds
+             *
+             * @details Like run(), but checks the predicate before every
+             *          instruction and stops as soon as it returns true.
+             *
+             * @param[i] predicate Called with the CPU, returns true to stop
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            template <typename Predicate>
+            uint64_t run_until(Predicate&& predicate, uint64_t budget) {
+                  if (status != Status::Running) return 0;
+
+                  remaining = budget;
+                  while (remaining != 0 && !predicate(static_cast<const CPU&>(*this))) {
+                        remaining--;
+                        step();
+                  }
+                  return retired(budget);
+            }
+
+            /**
+             * @brief Runs the CPU, reporting every instruction
+             *
+             * @details Like run(), but calls the observer after every
+             *          instruction that retires (see mips::Profiler).
+             *
+             * @param[i] observer Called with the address of the instruction
+             *                    and the address of the next one
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            template <typename Observer>
+            uint64_t run_observed(Observer&& observer, uint64_t budget) {
+                  if (status != Status::Running) return 0;
+
+                  remaining = budget;
+                  while (remaining != 0) {
+                        remaining--;
+                        const address_t from = pc;
+                        step();
+                        if (status != Status::Faulted) observer(from, static_cast<address_t>(pc));
+                  }
+                  return retired(budget);
+            }
+
+            /**
+             * @brief Runs the CPU, showing every instruction to an inspector
+             *
+             * @details Like run(), but steps with step(inspector).
+             *
+             * @param[i] inspector Called with the CPU and each instruction
+             *                     before it executes
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            template <typename Inspector>
+            uint64_t run_inspected(Inspector&& inspector, uint64_t budget) {
+                  if (status != Status::Running) return 0;
+
+                  remaining = budget;
+                  while (remaining != 0) {
+                        remaining--;
+                        step(inspector);
+                  }
+                  return retired(budget);
+            }
+
+            /** Status accessors */
+            Status get_status() const { return status; }
+            word_t get_exit_code() const { return exit_code; }
+            FaultCause get_fault_cause() const { return fault_cause; }
+            address_t get_fault_pc() const { return fault_pc; }
+            address_t get_fault_address() const { return fault_address; }     /** Bad address of an AccessViolation */
+
+            /**
+             * @brief Gets a description of the last fault
+             *
+             * @return The fault message
+             */
+            std::string get_fault_message() const;
+
+            /** @brief Clears a fault or halt so the CPU can run again */
+            void clear_fault();
+
+            /**
+             * @brief Sets the handler of syscall instructions
+             *
+             * @details Defaults to StandardSyscalls::standard(). The handler
+             *          must outlive the CPU.
+             *
+             * @param[i] handler The syscall handler
+             */
+            void set_syscall_handler(SyscallHandler* handler) { syscalls = handler; }
+
+            /** @brief Gets the handler of syscall instructions */
+            SyscallHandler* get_syscall_handler() const { return syscalls; }
+
             /**
              * @brief Gets the state of the CPU
              *
@@ -51,82 +255,126 @@ namespace mips
              */
             std::string state();
 
+            /** Register accessors */
+            register_t get_pc() const { return pc; }
+            register_t get_hi() const { return hi; }
+            register_t get_lo() const { return lo; }
+            register_t get_register(byte_t index) const { return registers[index]; }
+            void set_register(byte_t index, register_t value) { registers[index] = value; }
+
+            /**
+             * @brief Copies the registers of another CPU
+             *
+             * @details Copies the program counter, hi, lo and the general
+             *          purpose registers. Caches are left untouched.
+             *
+             * @param[i] other The CPU to copy from
+             */
+            void copy_registers(const CPU& other);
+
+            /** @brief Saves the registers */
+            CPUState save_state() const;
+
+            /**
+             * @brief Loads saved registers
+             *
+             * @details Also clears any fault or halt, so the CPU can run.
+             *
+             * @param[i] state The saved registers
+             */
+            void load_state(const CPUState& state);
+
       private:
+            friend class ThreadedEngine;
+            friend class JitEngine;
+
+            /** Instruction semantics, defined in handlers.hpp */
+            struct Handlers;
+
             /**
-             * @brief Fetches the next instruction from memory
+             * @brief Fetches the instruction at the given address
              *
-             * @details This function fetches the next instruction from memory
-             *          and increments the program counter.
+             * @details This function reads the instruction at the given
+             *          address and marks its page as code, so writes to it
+             *          invalidate the decoded instruction cache.
              * 
-             * @return The next instruction
+             * @param[i] address The address of the instruction
+             * @return The instruction
+             * @throw mips::AccessViolation If the address is not executable
              */
-            instruction_t fetch();
+            instruction_t fetch(address_t address);
 
             /**
              * @brief Decodes the instruction
              *
-             * @details This function decodes the instruction and returns the
-             *          opcode.
+             * @details This function extracts the instruction fields,
+             *          looks the operation up in the decoding tables built
+             *          from mips::INSTRUCTIONS and picks the matching handler.
              * 
              * @param[i] instruction The instruction to decode
-             * 
-             * @return The opcode
+             * @param[o] decoded The decoded instruction (Invalid if the
+             *                   instruction is not supported)
              */
-            opcode_t decode(instruction_t instruction);
+            void decode(instruction_t instruction, DecodedInstruction& decoded);
 
             /**
-             * @brief Executes the instruction
+             * @brief Executes a decoded instruction
              *
-             * @details This function executes the instruction.
-             * 
-             * @param[i] instruction The instruction to execute
-             * @param[i] opcode The opcode of the instruction
+             * @param[i] decoded The instruction to execute
              */
-            void execute(instruction_t instruction, opcode_t opcode);
+            void execute(const DecodedInstruction& decoded) { decoded.handler(*this, decoded); }
 
             /**
-             * @brief Executes the R-type instruction
+             * @brief Raises a guest fault
              *
-             * @details This function executes the R-type instruction.
-             * 
-             * @param[i] instruction The instruction to execute
+             * @details Stops run() at the next loop check by zeroing the
+             *          remaining budget.
+             *
+             * @param[i] cause The reason for the fault
+             * @param[i] address The address of the faulting instruction
              */
-            void execute_r(instruction_t instruction);
+            void raise_fault(FaultCause cause, address_t address);
 
             /**
-             * @brief Executes the I-type instruction
+             * @brief Raises a guest fault for an access violation
              *
-             * @details This function executes the I-type instruction.
-             * 
-             * @param[i] instruction The instruction to execute
+             * @param[i] violation The violation thrown by the memory
+             * @param[i] address The address of the faulting instruction
              */
-            void execute_i(instruction_t instruction);
+            void raise_access_violation(const mips::AccessViolation& violation, address_t address);
 
             /**
-             * @brief Executes the J-type instruction
+             * @brief Halts the CPU (program exit)
              *
-             * @details This function executes the J-type instruction.
-             * 
-             * @param[i] instruction The instruction to execute
+             * @param[i] code The exit code
              */
-            void execute_j(instruction_t instruction);
+            void halt(word_t code);
 
             /**
-             * @brief Executes a syscall
-             * 
-             * @details This function does not take any arguments because the
-             *          syscall number is stored in $v0.
+             * @brief Counts the instructions retired by a run
+             *
+             * @param[i] budget The budget the run started with
+             * @return The number of instructions executed
              */
-            void execute_syscall();
+            uint64_t retired(uint64_t budget) const {
+                  switch (status) {
+                        case Status::Running: return budget - remaining;
+                        case Status::Halted:  return budget - remaining_at_stop;
+                        default:              return budget - remaining_at_stop - 1;
+                  }
+            }
+
+            /** @brief Invalidates every entry of the decoded instruction cache */
+            void flush_decode_cache();
 
             /**
-             * @brief Gets the syscall code
-             * 
-             * @details This function gets the syscall code from $v0.
+             * @brief Executes a syscall
              * 
-             * @return The syscall code
+             * @details This function does not take any arguments because the
+             *          syscall number is stored in $v0. The syscall handler
+             *          does the work; the CPU halts or faults if it asks to.
              */
-            byte_t get_syscall_code() { return registers[2]; }
+            void execute_syscall();
 
             /* Registers */
             register_t pc;             /* Program counter */
@@ -140,6 +388,22 @@ namespace mips
             [[maybe_unused]] bool zero;                  /* Zero flag */
             [[maybe_unused]] bool negative;              /* Negative flag */
 
+            /* Run loop */
+            uint64_t remaining = 0;             /* Budget left in the current run */
+            uint64_t remaining_at_stop = 0;     /* Budget left when the CPU halted or faulted */
+            Status status;
+            FaultCause fault_cause;
+            address_t fault_pc;
+            address_t fault_address;
+            word_t exit_code;
+
+            /* Syscall handler */
+            SyscallHandler* syscalls = &StandardSyscalls::standard();
+
+            /* Decoded instruction cache */
+            std::vector<DecodedInstruction> decode_cache;
+            word_t decode_cache_version;     /* Memory code version the cache matches */
+
             /* Pointer to the memory */
             Memory* memory;
       };
@@ -0,0 +1,291 @@
+/**
+ * @file    debugger.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ debugger.
+ *          The debugger drives an emulator forwards and backwards in time.
+ *          Going back restores the closest earlier checkpoint and replays
+ *          forward from it, feeding the program the same input it read the
+ *          first time from a log of syscall reads.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_DEBUGGER_HPP
+#define MIPS_DEBUGGER_HPP
+
+/** C++ Includes */
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "emulator.hpp"
+#include "syscall.hpp"
+
+namespace mips
+{
+      /** Instructions between checkpoints when a debugging session starts */
+      constexpr uint64_t CHECKPOINT_INTERVAL = 1 << 16;
+
+      /** Checkpoints kept before the history is thinned out */
+      constexpr size_t MAX_CHECKPOINTS = 1024;
+
+      /** Default cap on the memory held by checkpoints */
+      constexpr size_t CHECKPOINT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+      /** Checkpoints may take at most 1 / CHECKPOINT_OVERHEAD of the run time */
+      constexpr uint64_t CHECKPOINT_OVERHEAD = 10;
+
+      /**
+       * @brief IO that logs its input so it can be replayed
+       *
+       * @details Reads past the end of the log go to the wrapped IO and are
+       *          appended to the log; reads before its end are answered from
+       *          it. Lines are stored as a tag, a varint length and the
+       *          bytes, characters as a tag and the byte.
+       */
+      class ReplayIO : public IO
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] io The IO to record (must outlive this one)
+             */
+            ReplayIO(IO* io) : io(io) {}
+            ~ReplayIO() {}
+
+            void write(std::string_view data) override;
+            bool read_line(std::string& line) override;
+            int read_char() override;
+            void flush() override { io->flush(); }
+
+            /** @brief Returns the position of the next read in the log */
+            size_t get_cursor() const { return cursor; }
+
+            /**
+             * @brief Moves the next read to a position of the log
+             *
+             * @param[i] position A value returned by get_cursor()
+             */
+            void seek(size_t position) { cursor = position; }
+
+            /** @brief Drops (true) or forwards (false) program output */
+            void set_muted(bool muted) { this->muted = muted; }
+
+            /** @brief Returns the size of the log in bytes */
+            size_t size() const { return log.size(); }
+
+      private:
+            IO* io;
+            std::string log;
+            size_t cursor = 0;
+            bool muted = false;
+      };
+
+      /**
+       * @brief Reversible debugger
+       *
+       * @details Positions count the instructions retired since the session
+       *          started. While running forward past the furthest position
+       *          reached so far, a checkpoint (emulator snapshot plus replay
+       *          log cursor) is taken every interval instructions. Snapshots
+       *          share pages copy-on-write, so a checkpoint only costs the
+       *          pages written since the previous one.
+       *
+       *          The interval doubles whenever taking a checkpoint costs more
+       *          than 1 / CHECKPOINT_OVERHEAD of the time spent running, and
+       *          whenever the history outgrows MAX_CHECKPOINTS or its memory
+       *          limit, in which case every other checkpoint is dropped. The
+       *          first one is always kept, so any position stays reachable
+       *          with one restore and a replay of at most about one interval.
+       *
+       *          Re-executed instructions read their input from the log and
+       *          their output is dropped, since it was already written.
+       */
+      class Debugger
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @details Installs the standard syscalls over a ReplayIO of the
+             *          given IO and takes the first checkpoint. The emulator
+             *          gets the standard handler back on destruction.
+             *
+             * @param[io] emulator The emulator, holding a freshly loaded program
+             * @param[i] io The program input and output
+             * @param[i] memory_limit Cap on the memory held by checkpoints
+             */
+            Debugger(Emulator& emulator, IO* io, size_t memory_limit = CHECKPOINT_MEMORY_LIMIT);
+            ~Debugger();
+
+            Debugger(const Debugger&) = delete;
+            Debugger& operator=(const Debugger&) = delete;
+
+            /**
+             * @brief Executes instructions
+             *
+             * @param[i] instructions The number of instructions to execute
+             * @return The outcome of the run
+             */
+            RunResult step(uint64_t instructions = 1);
+
+            /**
+             * @brief Runs until a breakpoint is reached or the program stops
+             *
+             * @return The outcome of the run (Stopped at a breakpoint)
+             */
+            RunResult resume();
+
+            /**
+             * @brief Goes back a number of instructions
+             *
+             * @param[i] instructions The number of instructions to undo
+             * @return false if the start of the program was reached first
+             */
+            bool reverse_step(uint64_t instructions = 1);
+
+            /**
+             * @brief Goes back to the last time a breakpoint was reached
+             *
+             * @return false if no breakpoint was reached (the debugger is
+             *         then at the start of the program)
+             */
+            bool reverse_resume();
+
+            /**
+             * @brief Moves to a position
+             *
+             * @details Positions past the furthest one reached run the program
+             *          forward as step() does, so they may not be reached if it
+             *          stops first.
+             *
+             * @param[i] target The position
+             */
+            void seek(uint64_t target);
+
+            /** Breakpoints */
+            void add_breakpoint(address_t address) { breakpoints.insert(address); }
+            void remove_breakpoint(address_t address) { breakpoints.erase(address); }
+            const std::set<address_t>& get_breakpoints() const { return breakpoints; }
+
+            /** History accessors */
+            uint64_t get_position() const { return position; }
+            uint64_t get_interval() const { return interval; }
+            size_t get_checkpoint_count() const { return checkpoints.size(); }
+            size_t get_history_bytes() const { return history_pages * PAGE_SIZE; }
+
+            /**
+             * @brief Runs the command line interface
+             *
+             * @details Reads commands until "quit" or the end of the input.
+             *          An empty line repeats the previous command.
+             *
+             * @param[i] input The command input
+             * @param[o] output Where to write the command output
+             */
+            void cli(std::istream& input, std::ostream& output);
+
+      private:
+            /** Saved state at a position */
+            struct Checkpoint {
+                  uint64_t position;
+                  Snapshot snapshot;
+                  size_t cursor;          /** Replay log cursor */
+            };
+
+            /**
+             * @brief Executes instructions, taking checkpoints on the way
+             *
+             * @param[i] instructions The maximum number of instructions to execute
+             * @param[i] stop_at_breakpoints Whether to stop before a breakpoint
+             * @return The outcome of the run
+             */
+            RunResult advance(uint64_t instructions, bool stop_at_breakpoints);
+
+            /** @brief Takes a checkpoint at the current position */
+            void checkpoint();
+
+            /**
+             * @brief Restores a checkpoint
+             *
+             * @param[i] saved The checkpoint
+             */
+            void restore(const Checkpoint& saved);
+
+            /**
+             * @brief Returns the last checkpoint at or before a position
+             *
+             * @param[i] target The position
+             * @return The index of the checkpoint
+             */
+            size_t checkpoint_before(uint64_t target) const;
+
+            /** @brief Drops every other checkpoint and doubles the interval */
+            void thin();
+
+            /**
+             * @brief Executes one command line
+             *
+             * @param[i] line The command
+             * @param[o] output Where to write the command output
+             * @return false if the command asks to quit
+             */
+            bool execute(const std::string& line, std::ostream& output);
+
+            /**
+             * @brief Writes where the program is
+             *
+             * @param[o] output Where to write
+             */
+            void report(std::ostream& output);
+
+            Emulator& emulator;
+            ReplayIO io;
+
+            std::vector<Checkpoint> checkpoints;
+            std::set<address_t> breakpoints;
+
+            uint64_t position = 0;        /** Instructions retired since the start */
+            uint64_t frontier = 0;        /** Furthest position reached */
+            uint64_t interval = CHECKPOINT_INTERVAL;
+
+            /** Checkpoint memory accounting (in pages) */
+            size_t page_limit;
+            size_t history_pages = 0;
+            size_t page_copies = 0;       /** Memory::get_page_copies() at the last checkpoint or restore */
+
+            /** Checkpoint cost accounting (nanoseconds) */
+            uint64_t run_time = 0;        /** Spent running since the last checkpoint */
+      };
+} // namespace mips
+
+#endif // MIPS_DEBUGGER_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
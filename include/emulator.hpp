@@ -18,22 +18,215 @@
 #include "common.hpp"
 #include "cpu.hpp"
 #include "memory.hpp"
+#include "profiler.hpp"
+#include "threaded.hpp"
+#include "jit.hpp"
+#include "syscall.hpp"
 
 namespace mips
 {
+      /**
+       * @brief Execution engines
+       *
+       * @details Interpreter steps the CPU one instruction at a time.
+       *          Threaded runs translated basic blocks (see threaded.hpp).
+       *          Jit runs native x86-64 translations (see jit.hpp).
+       *          Lockstep runs the interpreter and the threaded engine on
+       *          separate copies of the machine and compares the registers
+       *          after every instruction, failing on the first divergence.
+       *          LockstepJit does the same against the JIT, comparing after
+       *          every native block.
+       */
+      enum class Engine { Interpreter, Threaded, Lockstep, Jit, LockstepJit };
+
+      /** Number of instructions run() executes between checks of the guest status */
+      constexpr uint64_t RUN_SLICE = 1 << 20;
+
+      /** Why a run returned */
+      enum class RunStatus {
+            Completed,  /** The instruction budget was exhausted */
+            Stopped,    /** The run_until() predicate returned true */
+            Halted,     /** The program exited (see get_exit_code()) */
+            Faulted     /** The program faulted (see CPU::get_fault_message()) */
+      };
+
+      /**
+       * @brief Saved state of an emulator
+       *
+       * @details Memory pages are shared copy-on-write between the snapshot
+       *          and every emulator restored or forked from it.
+       */
+      struct Snapshot {
+            CPUState cpu;
+            std::shared_ptr<const Memory::Snapshot> memory;
+      };
+
+      /** Outcome of a run */
+      struct RunResult {
+            RunStatus status;
+            uint64_t executed;      /** Number of instructions executed */
+      };
+
       class Emulator
       {
       public:
-            Emulator();
+            /**
+             * @brief Constructor
+             *
+             * @param[i] backend The memory backend to use
+             * @param[i] engine The execution engine to use
+             */
+            Emulator(MemoryBackend backend = MemoryBackend::Paged, Engine engine = Engine::Interpreter);
+
+            /**
+             * @brief Forks an emulator from a snapshot
+             *
+             * @details The new emulator uses the Paged backend and shares
+             *          every page of the snapshot copy-on-write, so it costs
+             *          one page directory copy rather than a fresh address
+             *          space. Syscalls start on the standard handler.
+             *
+             * @param[i] snapshot The snapshot to start from
+             * @param[i] engine The execution engine to use
+             */
+            Emulator(const Snapshot& snapshot, Engine engine = Engine::Interpreter);
             ~Emulator();
 
+            Emulator(const Emulator&) = delete;
+            Emulator& operator=(const Emulator&) = delete;
+
+            /**
+             * @brief Takes a snapshot of the emulator
+             *
+             * @details Saves the registers and shares the memory pages (see
+             *          Memory::snapshot()). Cost is independent of the memory
+             *          size with the Paged backend.
+             *
+             * @return The snapshot
+             */
+            Snapshot snapshot() const;
+
+            /**
+             * @brief Restores a snapshot
+             *
+             * @details Clears any fault or halt. Translated and decoded code
+             *          is dropped through the memory code version.
+             *
+             * @param[i] snapshot The snapshot
+             */
+            void restore(const Snapshot& snapshot);
+
             /**
              * @brief Runs the emulator
              *
-             * @throw std::runtime_error If the program fails to run
+             * @details Runs the program in slices of RUN_SLICE instructions
+             *          until it exits or faults.
+             *
+             * @throw mips::RuntimeException If the program faults
              */
             void run();
 
+            /**
+             * @brief Runs the emulator for a number of instructions
+             *
+             * @details Guest faults do not throw, they end the run with a
+             *          Faulted status.
+             *
+             * @param[i] instructions The maximum number of instructions to execute
+             * @return The outcome of the run
+             * @throw mips::RuntimeException If the engines diverge (lockstep modes)
+             */
+            RunResult run_for(uint64_t instructions);
+
+            /**
+             * @brief Runs the emulator until the predicate holds
+             *
+             * @details The predicate is called with the CPU before every
+             *          instruction. The interpreter checks it from its own run
+             *          loop; the other engines are driven one instruction at a
+             *          time.
+             *
+             * @param[i] predicate Called with the CPU, returns true to stop
+             * @param[i] limit The maximum number of instructions to execute
+             * @return The outcome of the run
+             * @throw mips::RuntimeException If the engines diverge (lockstep modes)
+             */
+            template <typename Predicate>
+            RunResult run_until(Predicate predicate, uint64_t limit = UINT64_MAX) {
+                  uint64_t executed = 0;
+                  if (engine == Engine::Interpreter) {
+                        executed = cpu->run_until(predicate, limit);
+                  }
+                  else {
+                        while (executed < limit && cpu->get_status() == Status::Running && !predicate(static_cast<const CPU&>(*cpu))) {
+                              executed += run_for(1).executed;
+                        }
+                  }
+
+                  return make_result(executed, executed < limit ? RunStatus::Stopped : RunStatus::Completed);
+            }
+
+            /**
+             * @brief Runs the program under the profiler
+             *
+             * @details Runs until the program exits or faults, like run(),
+             *          but always on the interpreter, reporting every
+             *          instruction to the profiler. Faults end the run
+             *          without throwing, so the profile can still be written.
+             *
+             * @param[io] profiler The profiler
+             * @return The outcome of the run
+             */
+            RunResult profile(Profiler& profiler);
+
+            /**
+             * @brief Runs the program under an inspector
+             *
+             * @details Like profile(), on the interpreter and without
+             *          throwing on faults, but showing every instruction to
+             *          the inspector before it executes (see
+             *          CPU::run_inspected(), CacheHierarchy and PipelineModel).
+             *
+             * @param[io] inspector Called with the CPU and each instruction
+             * @return The outcome of the run
+             */
+            template <typename Inspector>
+            RunResult inspect(Inspector&& inspector) {
+                  RunResult result;
+                  do {
+                        result = make_result(cpu->run_inspected(inspector, RUN_SLICE), RunStatus::Completed);
+                  } while (result.status == RunStatus::Completed);
+
+                  cpu->get_syscall_handler()->flush();
+                  return result;
+            }
+
+            /** @brief Gets the CPU (the reference one in lockstep modes) */
+            const CPU& get_cpu() const { return *cpu; }
+
+            /** @brief Gets the memory (the reference one in lockstep modes) */
+            Memory& get_memory() { return *memory; }
+
+            /** @brief Gets the exit code of a halted program */
+            word_t get_exit_code() const { return cpu->get_exit_code(); }
+
+            /** @brief Gets a description of the last fault */
+            std::string get_fault_message() const { return cpu->get_fault_message(); }
+
+            /**
+             * @brief Runs the standard syscalls on the given IO
+             *
+             * @param[i] io The syscall IO (must outlive the emulator)
+             */
+            void set_io(IO* io);
+
+            /**
+             * @brief Sets the handler of syscall instructions
+             *
+             * @param[i] handler The syscall handler (must outlive the emulator)
+             */
+            void set_syscall_handler(SyscallHandler* handler) { cpu->set_syscall_handler(handler); }
+
             /**
              * @brief Loads the binary file and holds the emulator
              *
@@ -41,7 +234,9 @@ namespace mips
              *          used for initializing the emulator in debug mode.
              *
              * @param[i] filename The filename
-             * @throw std::runtime_error If the program fails to load
+             * @throw mips::FileException If the file cannot be read or is not
+             *        a MIPS binary
+             * @throw std::runtime_error If a section does not fit in its segment
              */
             void prepare_and_hold(std::string filename);
 
@@ -49,8 +244,10 @@ namespace mips
              * @brief Steps the emulator
              *
              * @details Used for stepping through the emulator in debug mode.
+             *
+             * @return The outcome of the step
              */
-            void step();
+            RunResult step();
 
             /**
              * @brief Gets the state of the emulator
@@ -71,14 +268,69 @@ namespace mips
              *          the emulator is ready to be debugged (after loading the
              *          binary file) after calling prepare_and_hold().
              * 
-             *          Check the documentation for the list of available debug
-             *          commands.
+             *          Program input and output go through the standard
+             *          streams. Check the documentation for the list of
+             *          available debug commands (see also debugger.hpp).
              */
             void cli();
 
       private:
-            CPU *cpu;
-            Memory *memory;
+            /** @brief Creates the CPUs and the execution engine over the memories */
+            void create_engine();
+
+            /**
+             * @brief Builds the result of a run from the CPU status
+             *
+             * @param[i] executed The number of instructions executed
+             * @param[i] running The status to report if the CPU is still running
+             * @return The result
+             */
+            RunResult make_result(uint64_t executed, RunStatus running) const {
+                  switch (cpu->get_status()) {
+                        case Status::Halted:  return { RunStatus::Halted, executed };
+                        case Status::Faulted: return { RunStatus::Faulted, executed };
+                        default:              return { running, executed };
+                  }
+            }
+
+            /**
+             * @brief Executes one step of a lockstep engine
+             *
+             * @details Lockstep executes one instruction, LockstepJit up to
+             *          one native block.
+             *
+             * @param[i] limit The maximum number of instructions to execute
+             * @return The number of instructions executed
+             * @throw mips::RuntimeException If the engines diverge
+             */
+            uint64_t advance(uint64_t limit);
+
+            /**
+             * @brief Compares the interpreter and shadow engine registers
+             *
+             * @param[i] pc The address of the instruction just executed
+             * @throw mips::RuntimeException If the registers differ
+             */
+            void check_lockstep(address_t pc);
+
+            /**
+             * @brief Copies the effects of the syscall the interpreter just
+             *        ran to the shadow machine
+             */
+            void mirror_syscall();
+
+            Engine engine;
+            CPU *cpu = nullptr;
+            Memory *memory = nullptr;
+            ThreadedEngine *threaded = nullptr;
+            JitEngine *jit = nullptr;
+
+            /** Standard syscalls installed by set_io() */
+            StandardSyscalls *syscalls = nullptr;
+
+            /** Machine driven by the threaded engine or JIT in lockstep mode */
+            CPU *shadow_cpu = nullptr;
+            Memory *shadow_memory = nullptr;
       };
 } // namespace mips
 
@@ -16,6 +16,9 @@
 #include <exception>
 #include <string>
 
+/** Local Includes */
+#include "common.hpp"
+
 namespace mips
 {
       /**
@@ -57,6 +60,35 @@ namespace mips
             SyntaxException(std::string message) : Exception(message) {}
       };
 
+      /** Kinds of memory access */
+      enum class AccessKind : byte_t { Read, Write, Execute };
+
+      /**
+       * @brief MIPS++ access violation class
+       *
+       * @details Thrown by the memory when the guest touches an address
+       *          outside its segments or without the permission the access
+       *          needs. The execution engines turn it into a guest fault.
+       */
+      class AccessViolation : public Exception
+      {
+      public:
+            AccessViolation(address_t address, AccessKind kind)
+                  : Exception(describe(address, kind)), address(address), kind(kind) {}
+
+            address_t get_address() const { return address; }
+            AccessKind get_kind() const { return kind; }
+
+      private:
+            static std::string describe(address_t address, AccessKind kind) {
+                  const char* verb = kind == AccessKind::Read ? "reading" : kind == AccessKind::Write ? "writing" : "executing";
+                  return std::string("Access violation ") + verb + " address " + std::to_string(address);
+            }
+
+            address_t address;
+            AccessKind kind;
+      };
+
       /**
        * @brief MIPS++ file exception class
        *
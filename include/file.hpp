@@ -0,0 +1,81 @@
+/**
+ * @file    file.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ read-only file mapping.
+ *          Files are mapped into memory instead of being copied, so their
+ *          contents can be handed out as string views.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_FILE_HPP
+#define MIPS_FILE_HPP
+
+/** C++ Includes */
+#include <string>
+#include <string_view>
+
+/** Local Includes */
+#include "common.hpp"
+
+namespace mips
+{
+      /**
+       * @brief Read-only view of a whole file
+       *
+       * @details Maps the file with mmap where available and reads it into a
+       *          buffer elsewhere. The contents stay valid for the lifetime
+       *          of the object.
+       */
+      class MappedFile
+      {
+      public:
+            /**
+             * @brief Maps a file
+             *
+             * @param[i] filename The file
+             * @throw mips::FileException If the file cannot be opened or mapped
+             */
+            MappedFile(const std::string& filename);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            /** @brief Returns the contents of the file */
+            std::string_view contents() const { return std::string_view(data, size); }
+
+      private:
+            const char* data = nullptr;
+            size_t size = 0;
+            bool mapped = false;    /** Whether data points at a mapping (or at buffer) */
+            std::string buffer;
+      };
+} // namespace mips
+
+#endif // MIPS_FILE_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
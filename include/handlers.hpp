@@ -0,0 +1,377 @@
+/**
+ * @file    handlers.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the semantics of every instruction
+ *          supported by the MIPS++ CPU.
+ *
+ *          Each handler executes one decoded instruction. They are kept
+ *          in a header so every execution engine can inline them.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_HANDLERS_HPP
+#define MIPS_HANDLERS_HPP
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+
+namespace mips
+{
+      /**
+       * @brief Instruction handlers
+       *
+       * @details The program counter already points to the next instruction
+       *          when a handler runs, so branch offsets are relative to it.
+       *
+       *          Faults (overflow, misaligned accesses, break) leave the
+       *          destination register untouched.
+       */
+      struct CPU::Handlers
+      {
+            /**
+             * @brief Writes a general purpose register
+             *
+             * @details $zero is hardwired: the write always lands and is
+             *          undone, which is cheaper than checking the index.
+             */
+            static void set(CPU& cpu, byte_t index, register_t value) {
+                  cpu.registers[index] = value;
+                  cpu.registers[0] = 0;
+            }
+
+            /** @brief Checks if a signed 32 bit result does not fit */
+            static bool overflows(int64_t result) {
+                  return result != static_cast<int32_t>(result);
+            }
+
+            /** @brief Computes the address of a load or store */
+            static address_t effective_address(const CPU& cpu, const DecodedInstruction& d) {
+                  return cpu.registers[d.rs] + d.immediate;
+            }
+
+            /** @brief Raises an address error if the address is not a multiple of size */
+            static bool misaligned(CPU& cpu, const DecodedInstruction& d, address_t address, address_t size) {
+                  if ((address & (size - 1)) == 0) return false;
+                  cpu.raise_fault(FaultCause::AddressError, d.pc);
+                  return true;
+            }
+
+            /** R-type */
+            static void op_add(CPU& cpu, const DecodedInstruction& d) {
+                  int64_t result = static_cast<int64_t>(static_cast<int32_t>(cpu.registers[d.rs])) + static_cast<int32_t>(cpu.registers[d.rt]);
+                  if (overflows(result)) return cpu.raise_fault(FaultCause::Overflow, d.pc);
+                  set(cpu, d.rd, static_cast<register_t>(result));
+            }
+
+            static void op_addu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] + cpu.registers[d.rt]);
+            }
+
+            static void op_sub(CPU& cpu, const DecodedInstruction& d) {
+                  int64_t result = static_cast<int64_t>(static_cast<int32_t>(cpu.registers[d.rs])) - static_cast<int32_t>(cpu.registers[d.rt]);
+                  if (overflows(result)) return cpu.raise_fault(FaultCause::Overflow, d.pc);
+                  set(cpu, d.rd, static_cast<register_t>(result));
+            }
+
+            static void op_subu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] - cpu.registers[d.rt]);
+            }
+
+            static void op_and(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] & cpu.registers[d.rt]);
+            }
+
+            static void op_or(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] | cpu.registers[d.rt]);
+            }
+
+            static void op_xor(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] ^ cpu.registers[d.rt]);
+            }
+
+            static void op_nor(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, ~(cpu.registers[d.rs] | cpu.registers[d.rt]));
+            }
+
+            static void op_slt(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, static_cast<int32_t>(cpu.registers[d.rs]) < static_cast<int32_t>(cpu.registers[d.rt]));
+            }
+
+            static void op_sltu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rs] < cpu.registers[d.rt]);
+            }
+
+            static void op_sll(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rt] << d.shamt);
+            }
+
+            static void op_srl(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rt] >> d.shamt);
+            }
+
+            static void op_sra(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, static_cast<register_t>(static_cast<int32_t>(cpu.registers[d.rt]) >> d.shamt));
+            }
+
+            static void op_sllv(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rt] << (cpu.registers[d.rs] & 0x1F));
+            }
+
+            static void op_srlv(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.registers[d.rt] >> (cpu.registers[d.rs] & 0x1F));
+            }
+
+            static void op_srav(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, static_cast<register_t>(static_cast<int32_t>(cpu.registers[d.rt]) >> (cpu.registers[d.rs] & 0x1F)));
+            }
+
+            static void op_mult(CPU& cpu, const DecodedInstruction& d) {
+                  int64_t product = static_cast<int64_t>(static_cast<int32_t>(cpu.registers[d.rs])) * static_cast<int32_t>(cpu.registers[d.rt]);
+                  cpu.hi = static_cast<register_t>(static_cast<uint64_t>(product) >> 32);
+                  cpu.lo = static_cast<register_t>(product);
+            }
+
+            static void op_multu(CPU& cpu, const DecodedInstruction& d) {
+                  uint64_t product = static_cast<uint64_t>(cpu.registers[d.rs]) * cpu.registers[d.rt];
+                  cpu.hi = static_cast<register_t>(product >> 32);
+                  cpu.lo = static_cast<register_t>(product);
+            }
+
+            /** Division by zero leaves hi and lo unchanged (the result is unpredictable on hardware) */
+            static void op_div(CPU& cpu, const DecodedInstruction& d) {
+                  int32_t dividend = static_cast<int32_t>(cpu.registers[d.rs]);
+                  int32_t divisor = static_cast<int32_t>(cpu.registers[d.rt]);
+                  if (divisor == 0) return;
+                  if (dividend == INT32_MIN && divisor == -1) {
+                        cpu.lo = static_cast<register_t>(dividend);
+                        cpu.hi = 0;
+                        return;
+                  }
+                  cpu.lo = static_cast<register_t>(dividend / divisor);
+                  cpu.hi = static_cast<register_t>(dividend % divisor);
+            }
+
+            static void op_divu(CPU& cpu, const DecodedInstruction& d) {
+                  register_t divisor = cpu.registers[d.rt];
+                  if (divisor == 0) return;
+                  cpu.lo = cpu.registers[d.rs] / divisor;
+                  cpu.hi = cpu.registers[d.rs] % divisor;
+            }
+
+            static void op_mfhi(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.hi);
+            }
+
+            static void op_mflo(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rd, cpu.lo);
+            }
+
+            static void op_mthi(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.hi = cpu.registers[d.rs];
+            }
+
+            static void op_mtlo(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.lo = cpu.registers[d.rs];
+            }
+
+            static void op_jr(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.pc = cpu.registers[d.rs];
+            }
+
+            static void op_jalr(CPU& cpu, const DecodedInstruction& d) {
+                  register_t target = cpu.registers[d.rs];
+                  set(cpu, d.rd, cpu.pc);
+                  cpu.pc = target;
+            }
+
+            static void op_syscall(CPU& cpu, const DecodedInstruction&) {
+                  cpu.execute_syscall();
+            }
+
+            static void op_break(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.raise_fault(FaultCause::Breakpoint, d.pc);
+            }
+
+            /** I-type */
+            static void op_lb(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, static_cast<register_t>(static_cast<int8_t>(cpu.memory->read_byte(effective_address(cpu, d)))));
+            }
+
+            static void op_lbu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.memory->read_byte(effective_address(cpu, d)));
+            }
+
+            static void op_lh(CPU& cpu, const DecodedInstruction& d) {
+                  address_t address = effective_address(cpu, d);
+                  if (misaligned(cpu, d, address, sizeof(halfword_t))) return;
+                  set(cpu, d.rt, static_cast<register_t>(static_cast<int16_t>(cpu.memory->read_halfword(address))));
+            }
+
+            static void op_lhu(CPU& cpu, const DecodedInstruction& d) {
+                  address_t address = effective_address(cpu, d);
+                  if (misaligned(cpu, d, address, sizeof(halfword_t))) return;
+                  set(cpu, d.rt, cpu.memory->read_halfword(address));
+            }
+
+            static void op_lw(CPU& cpu, const DecodedInstruction& d) {
+                  address_t address = effective_address(cpu, d);
+                  if (misaligned(cpu, d, address, sizeof(word_t))) return;
+                  set(cpu, d.rt, cpu.memory->read_word(address));
+            }
+
+            static void op_sb(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.memory->write_byte(static_cast<byte_t>(cpu.registers[d.rt]), effective_address(cpu, d));
+            }
+
+            static void op_sh(CPU& cpu, const DecodedInstruction& d) {
+                  address_t address = effective_address(cpu, d);
+                  if (misaligned(cpu, d, address, sizeof(halfword_t))) return;
+                  cpu.memory->write_halfword(static_cast<halfword_t>(cpu.registers[d.rt]), address);
+            }
+
+            static void op_sw(CPU& cpu, const DecodedInstruction& d) {
+                  address_t address = effective_address(cpu, d);
+                  if (misaligned(cpu, d, address, sizeof(word_t))) return;
+                  cpu.memory->write_word(cpu.registers[d.rt], address);
+            }
+
+            static void op_addi(CPU& cpu, const DecodedInstruction& d) {
+                  int64_t result = static_cast<int64_t>(static_cast<int32_t>(cpu.registers[d.rs])) + static_cast<int32_t>(d.immediate);
+                  if (overflows(result)) return cpu.raise_fault(FaultCause::Overflow, d.pc);
+                  set(cpu, d.rt, static_cast<register_t>(result));
+            }
+
+            static void op_addiu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.registers[d.rs] + d.immediate);
+            }
+
+            static void op_slti(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, static_cast<int32_t>(cpu.registers[d.rs]) < static_cast<int32_t>(d.immediate));
+            }
+
+            /** The immediate is sign extended, then compared as unsigned */
+            static void op_sltiu(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.registers[d.rs] < d.immediate);
+            }
+
+            static void op_lui(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, d.immediate << 16);
+            }
+
+            static void op_andi(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.registers[d.rs] & d.immediate);
+            }
+
+            static void op_ori(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.registers[d.rs] | d.immediate);
+            }
+
+            static void op_xori(CPU& cpu, const DecodedInstruction& d) {
+                  set(cpu, d.rt, cpu.registers[d.rs] ^ d.immediate);
+            }
+
+            static void op_beq(CPU& cpu, const DecodedInstruction& d) {
+                  if (cpu.registers[d.rs] == cpu.registers[d.rt]) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_bne(CPU& cpu, const DecodedInstruction& d) {
+                  if (cpu.registers[d.rs] != cpu.registers[d.rt]) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_blez(CPU& cpu, const DecodedInstruction& d) {
+                  if (static_cast<int32_t>(cpu.registers[d.rs]) <= 0) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_bgtz(CPU& cpu, const DecodedInstruction& d) {
+                  if (static_cast<int32_t>(cpu.registers[d.rs]) > 0) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_bltz(CPU& cpu, const DecodedInstruction& d) {
+                  if (static_cast<int32_t>(cpu.registers[d.rs]) < 0) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_bgez(CPU& cpu, const DecodedInstruction& d) {
+                  if (static_cast<int32_t>(cpu.registers[d.rs]) >= 0) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            /** The link register is written even if the branch is not taken */
+            static void op_bltzal(CPU& cpu, const DecodedInstruction& d) {
+                  bool taken = static_cast<int32_t>(cpu.registers[d.rs]) < 0;
+                  cpu.registers[31] = cpu.pc;
+                  if (taken) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            static void op_bgezal(CPU& cpu, const DecodedInstruction& d) {
+                  bool taken = static_cast<int32_t>(cpu.registers[d.rs]) >= 0;
+                  cpu.registers[31] = cpu.pc;
+                  if (taken) {
+                        cpu.pc += d.immediate << 2;
+                  }
+            }
+
+            /** J-type: the target replaces the low 28 bits of the program counter */
+            static void op_j(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.pc = (cpu.pc & JUMP_REGION_MASK) | d.immediate;
+            }
+
+            static void op_jal(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.registers[31] = cpu.pc;
+                  cpu.pc = (cpu.pc & JUMP_REGION_MASK) | d.immediate;
+            }
+
+            /** Invalid */
+            static void op_invalid(CPU& cpu, const DecodedInstruction& d) {
+                  cpu.raise_fault(FaultCause::InvalidInstruction, d.pc);
+            }
+
+            /** Handlers indexed by operation */
+            static constexpr DecodedInstruction::handler_t table[] = {
+            #define MIPS_OPERATION_HANDLER(operation, handler) handler,
+                  MIPS_OPERATIONS(MIPS_OPERATION_HANDLER)
+            #undef MIPS_OPERATION_HANDLER
+            };
+      };
+} // namespace mips
+
+#endif // MIPS_HANDLERS_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
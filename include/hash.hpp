@@ -0,0 +1,151 @@
+/**
+ * @file    hash.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ compile time perfect hash.
+ *          It maps a fixed set of keys (mnemonics, directives) to their
+ *          index with one hash, one table load and one comparison.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_HASH_HPP
+#define MIPS_HASH_HPP
+
+/** C++ Includes */
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/** Local Includes */
+#include "common.hpp"
+
+namespace mips
+{
+      /**
+       * @brief Hashes a string (seeded FNV-1a)
+       *
+       * @param[i] text The string
+       * @param[i] seed The seed
+       * @return The hash
+       */
+      constexpr uint32_t hash_string(std::string_view text, uint32_t seed) {
+            uint32_t hash = 2166136261u ^ seed;
+            for (char c : text) {
+                  hash ^= static_cast<byte_t>(c);
+                  hash *= 16777619u;
+            }
+            return hash;
+      }
+
+      /**
+       * @brief Returns the table size used for a number of keys
+       *
+       * @details The smallest power of two with room for eight slots per
+       *          key, which keeps the seed search short.
+       */
+      constexpr size_t perfect_hash_slots(size_t keys) {
+            size_t slots = 1;
+            while (slots < keys * 8) slots <<= 1;
+            return slots;
+      }
+
+      /**
+       * @brief Perfect hash over a fixed set of keys
+       *
+       * @details Built by the compiler: the constructor tries seeds until
+       *          every key lands on its own slot. A set of keys with no
+       *          collision-free seed fails to compile.
+       *
+       * @tparam N The number of keys
+       * @tparam Slots The table size (a power of two)
+       */
+      template <size_t N, size_t Slots = perfect_hash_slots(N)>
+      class PerfectHash
+      {
+      public:
+            static_assert(N < UINT16_MAX, "too many keys");
+            static_assert((Slots & (Slots - 1)) == 0, "the table size must be a power of two");
+
+            /** Index returned for keys outside of the set */
+            static constexpr size_t NOT_FOUND = N;
+
+            /**
+             * @brief Builds the hash over the names of a table
+             *
+             * @param[i] entries The table (anything with a name member)
+             */
+            template <typename Entry>
+            constexpr PerfectHash(const std::array<Entry, N>& entries) {
+                  for (size_t i = 0; i < N; i++) keys[i] = entries[i].name;
+                  build();
+            }
+
+            /**
+             * @brief Builds the hash over a list of keys
+             *
+             * @param[i] names The keys
+             */
+            constexpr PerfectHash(const std::array<std::string_view, N>& names) {
+                  for (size_t i = 0; i < N; i++) keys[i] = names[i];
+                  build();
+            }
+
+            /**
+             * @brief Looks a key up
+             *
+             * @param[i] key The key
+             * @return Its index in the table, or NOT_FOUND
+             */
+            constexpr size_t find(std::string_view key) const {
+                  size_t index = slots[hash_string(key, seed) & (Slots - 1)];
+                  return index != N && keys[index] == key ? index : NOT_FOUND;
+            }
+
+      private:
+            /** @brief Searches a seed that maps every key to its own slot */
+            constexpr void build() {
+                  for (seed = 1; seed != 0; seed++) {
+                        bool collision = false;
+                        for (size_t slot = 0; slot < Slots; slot++) slots[slot] = N;
+
+                        for (size_t i = 0; i < N && !collision; i++) {
+                              uint16_t& slot = slots[hash_string(keys[i], seed) & (Slots - 1)];
+                              if (slot != N) collision = true;
+                              else slot = static_cast<uint16_t>(i);
+                        }
+                        if (!collision) return;
+                  }
+            }
+
+            std::array<std::string_view, N> keys = {};
+            std::array<uint16_t, Slots> slots = {};
+            uint32_t seed = 0;
+      };
+} // namespace mips
+
+#endif // MIPS_HASH_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
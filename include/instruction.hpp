@@ -13,17 +13,25 @@
 #ifndef MIPS_INSTRUCTIONS_HPP
 #define MIPS_INSTRUCTIONS_HPP
 
+/** C++ Includes */
+#include <array>
+#include <string>
+#include <string_view>
+
 /** Local Includes */
 #include "common.hpp"
 
 namespace mips
 {
       /** Instruction types */
-      enum InstructionType { R, I, J };
+      enum class InstructionType : byte_t { R, I, J };
 
       /** R-Type Indicator */
       constexpr opcode_t R_TYPE = 0x00;
 
+      /** REGIMM Indicator (branches on the sign of rs, selected by the rt field) */
+      constexpr opcode_t REGIMM = 0x01;
+
       /** Instruction masks */
       /**
        * These are useful for extracting the fields from an instruction
@@ -38,6 +46,9 @@ namespace mips
       constexpr word_t IMMEDIATE_MASK = 0x0000FFFF;
       constexpr word_t ADDRESS_MASK = 0x03FFFFFF;
 
+      /** Bits of the program counter a jump keeps (the 256MB region it jumps within) */
+      constexpr word_t JUMP_REGION_MASK = 0xF0000000;
+
       /** Instruction shifts */
       constexpr word_t OPCODE_SHIFT = 26;
       constexpr word_t RS_SHIFT = 21;
@@ -48,6 +59,180 @@ namespace mips
       constexpr word_t IMMEDIATE_SHIFT = 0;
       constexpr word_t ADDRESS_SHIFT = 0;
 
+      /**
+       * @brief Operations understood by the CPU
+       *
+       * @details X(operation, handler). Expands into mips::Operation, the
+       *          CPU handler table and the threaded engine's dispatch labels,
+       *          so the three can not get out of order.
+       */
+      #define MIPS_OPERATIONS(X) \
+            /** R-type */ \
+            X(Add, op_add) X(Addu, op_addu) X(Sub, op_sub) X(Subu, op_subu) \
+            X(And, op_and) X(Or, op_or) X(Xor, op_xor) X(Nor, op_nor) X(Slt, op_slt) X(Sltu, op_sltu) \
+            X(Sll, op_sll) X(Srl, op_srl) X(Sra, op_sra) X(Sllv, op_sllv) X(Srlv, op_srlv) X(Srav, op_srav) \
+            X(Mult, op_mult) X(Multu, op_multu) X(Div, op_div) X(Divu, op_divu) \
+            X(Mfhi, op_mfhi) X(Mflo, op_mflo) X(Mthi, op_mthi) X(Mtlo, op_mtlo) \
+            X(Jr, op_jr) X(Jalr, op_jalr) X(Syscall, op_syscall) X(Break, op_break) \
+            /** I-type */ \
+            X(Lb, op_lb) X(Lbu, op_lbu) X(Lh, op_lh) X(Lhu, op_lhu) X(Lw, op_lw) \
+            X(Sb, op_sb) X(Sh, op_sh) X(Sw, op_sw) \
+            X(Addi, op_addi) X(Addiu, op_addiu) X(Slti, op_slti) X(Sltiu, op_sltiu) \
+            X(Lui, op_lui) X(Andi, op_andi) X(Ori, op_ori) X(Xori, op_xori) \
+            X(Beq, op_beq) X(Bne, op_bne) X(Blez, op_blez) X(Bgtz, op_bgtz) \
+            X(Bltz, op_bltz) X(Bgez, op_bgez) X(Bltzal, op_bltzal) X(Bgezal, op_bgezal) \
+            /** J-type */ \
+            X(J, op_j) X(Jal, op_jal) \
+            /** Anything the CPU does not execute (raises a fault) */ \
+            X(Invalid, op_invalid)
+
+      /** Operations understood by the CPU */
+      enum class Operation : byte_t {
+      #define MIPS_OPERATION_ENUM(operation, handler) operation,
+            MIPS_OPERATIONS(MIPS_OPERATION_ENUM)
+      #undef MIPS_OPERATION_ENUM
+            /** Number of operations */
+            Count
+      };
+
+      /** Assembly operand syntax of an instruction */
+      enum class Syntax : byte_t {
+            None,             /** syscall */
+            RdRsRt,           /** add $rd, $rs, $rt */
+            RdRtShamt,        /** sll $rd, $rt, shamt */
+            RdRtRs,           /** sllv $rd, $rt, $rs */
+            RsRt,             /** mult $rs, $rt */
+            Rs,               /** jr $rs */
+            Rd,               /** mfhi $rd */
+            RdRs,             /** jalr $rd, $rs */
+            RtRsImmediate,    /** addi $rt, $rs, immediate */
+            RtImmediate,      /** lui $rt, immediate */
+            RtOffsetRs,       /** lw $rt, offset($rs) */
+            RsRtLabel,        /** beq $rs, $rt, label */
+            RsLabel,          /** bgtz $rs, label */
+            Target            /** j label */
+      };
+
+      /** Description of an instruction */
+      struct InstructionInfo {
+            std::string_view name;  /** The mnemonic */
+            InstructionType type;
+            opcode_t opcode;
+            byte_t funct;           /** The funct field (R-type) or the rt field (REGIMM) */
+            Syntax syntax;          /** Assembly operands */
+            Operation op;           /** What the CPU executes */
+            bool zero_extend;       /** The immediate is zero extended (logical operations) */
+      };
+
+      /**
+       * @brief The instruction set
+       *
+       * @details The single description of every instruction: the
+       *          assembler, the CPU decoder and the disassembler are all
+       *          generated from it.
+       */
+      constexpr std::array<InstructionInfo, 56> INSTRUCTIONS = {{
+            /** R-type */
+            {"add",     InstructionType::R, R_TYPE, 0x20, Syntax::RdRsRt,        Operation::Add,     false},
+            {"addu",    InstructionType::R, R_TYPE, 0x21, Syntax::RdRsRt,        Operation::Addu,    false},
+            {"and",     InstructionType::R, R_TYPE, 0x24, Syntax::RdRsRt,        Operation::And,     false},
+            {"break",   InstructionType::R, R_TYPE, 0x0D, Syntax::None,          Operation::Break,   false},
+            {"div",     InstructionType::R, R_TYPE, 0x1A, Syntax::RsRt,          Operation::Div,     false},
+            {"divu",    InstructionType::R, R_TYPE, 0x1B, Syntax::RsRt,          Operation::Divu,    false},
+            {"jalr",    InstructionType::R, R_TYPE, 0x09, Syntax::RdRs,          Operation::Jalr,    false},
+            {"jr",      InstructionType::R, R_TYPE, 0x08, Syntax::Rs,            Operation::Jr,      false},
+            {"mfhi",    InstructionType::R, R_TYPE, 0x10, Syntax::Rd,            Operation::Mfhi,    false},
+            {"mflo",    InstructionType::R, R_TYPE, 0x12, Syntax::Rd,            Operation::Mflo,    false},
+            {"mthi",    InstructionType::R, R_TYPE, 0x11, Syntax::Rs,            Operation::Mthi,    false},
+            {"mtlo",    InstructionType::R, R_TYPE, 0x13, Syntax::Rs,            Operation::Mtlo,    false},
+            {"mult",    InstructionType::R, R_TYPE, 0x18, Syntax::RsRt,          Operation::Mult,    false},
+            {"multu",   InstructionType::R, R_TYPE, 0x19, Syntax::RsRt,          Operation::Multu,   false},
+            {"nor",     InstructionType::R, R_TYPE, 0x27, Syntax::RdRsRt,        Operation::Nor,     false},
+            {"or",      InstructionType::R, R_TYPE, 0x25, Syntax::RdRsRt,        Operation::Or,      false},
+            {"sll",     InstructionType::R, R_TYPE, 0x00, Syntax::RdRtShamt,     Operation::Sll,     false},
+            {"sllv",    InstructionType::R, R_TYPE, 0x04, Syntax::RdRtRs,        Operation::Sllv,    false},
+            {"slt",     InstructionType::R, R_TYPE, 0x2A, Syntax::RdRsRt,        Operation::Slt,     false},
+            {"sltu",    InstructionType::R, R_TYPE, 0x2B, Syntax::RdRsRt,        Operation::Sltu,    false},
+            {"sra",     InstructionType::R, R_TYPE, 0x03, Syntax::RdRtShamt,     Operation::Sra,     false},
+            {"srav",    InstructionType::R, R_TYPE, 0x07, Syntax::RdRtRs,        Operation::Srav,    false},
+            {"srl",     InstructionType::R, R_TYPE, 0x02, Syntax::RdRtShamt,     Operation::Srl,     false},
+            {"srlv",    InstructionType::R, R_TYPE, 0x06, Syntax::RdRtRs,        Operation::Srlv,    false},
+            {"sub",     InstructionType::R, R_TYPE, 0x22, Syntax::RdRsRt,        Operation::Sub,     false},
+            {"subu",    InstructionType::R, R_TYPE, 0x23, Syntax::RdRsRt,        Operation::Subu,    false},
+            {"syscall", InstructionType::R, R_TYPE, 0x0C, Syntax::None,          Operation::Syscall, false},
+            {"xor",     InstructionType::R, R_TYPE, 0x26, Syntax::RdRsRt,        Operation::Xor,     false},
+            /** REGIMM */
+            {"bltz",    InstructionType::I, REGIMM, 0x00, Syntax::RsLabel,       Operation::Bltz,    false},
+            {"bgez",    InstructionType::I, REGIMM, 0x01, Syntax::RsLabel,       Operation::Bgez,    false},
+            {"bltzal",  InstructionType::I, REGIMM, 0x10, Syntax::RsLabel,       Operation::Bltzal,  false},
+            {"bgezal",  InstructionType::I, REGIMM, 0x11, Syntax::RsLabel,       Operation::Bgezal,  false},
+            /** I-type */
+            {"addi",    InstructionType::I, 0x08,   0x00, Syntax::RtRsImmediate, Operation::Addi,    false},
+            {"addiu",   InstructionType::I, 0x09,   0x00, Syntax::RtRsImmediate, Operation::Addiu,   false},
+            {"andi",    InstructionType::I, 0x0C,   0x00, Syntax::RtRsImmediate, Operation::Andi,    true},
+            {"beq",     InstructionType::I, 0x04,   0x00, Syntax::RsRtLabel,     Operation::Beq,     false},
+            {"bgtz",    InstructionType::I, 0x07,   0x00, Syntax::RsLabel,       Operation::Bgtz,    false},
+            {"blez",    InstructionType::I, 0x06,   0x00, Syntax::RsLabel,       Operation::Blez,    false},
+            {"bne",     InstructionType::I, 0x05,   0x00, Syntax::RsRtLabel,     Operation::Bne,     false},
+            {"lb",      InstructionType::I, 0x20,   0x00, Syntax::RtOffsetRs,    Operation::Lb,      false},
+            {"lbu",     InstructionType::I, 0x24,   0x00, Syntax::RtOffsetRs,    Operation::Lbu,     false},
+            {"lh",      InstructionType::I, 0x21,   0x00, Syntax::RtOffsetRs,    Operation::Lh,      false},
+            {"lhu",     InstructionType::I, 0x25,   0x00, Syntax::RtOffsetRs,    Operation::Lhu,     false},
+            {"lui",     InstructionType::I, 0x0F,   0x00, Syntax::RtImmediate,   Operation::Lui,     true},
+            {"lw",      InstructionType::I, 0x23,   0x00, Syntax::RtOffsetRs,    Operation::Lw,      false},
+            {"lwc1",    InstructionType::I, 0x31,   0x00, Syntax::RtOffsetRs,    Operation::Invalid, false},
+            {"ori",     InstructionType::I, 0x0D,   0x00, Syntax::RtRsImmediate, Operation::Ori,     true},
+            {"sb",      InstructionType::I, 0x28,   0x00, Syntax::RtOffsetRs,    Operation::Sb,      false},
+            {"sh",      InstructionType::I, 0x29,   0x00, Syntax::RtOffsetRs,    Operation::Sh,      false},
+            {"slti",    InstructionType::I, 0x0A,   0x00, Syntax::RtRsImmediate, Operation::Slti,    false},
+            {"sltiu",   InstructionType::I, 0x0B,   0x00, Syntax::RtRsImmediate, Operation::Sltiu,   false},
+            {"sw",      InstructionType::I, 0x2B,   0x00, Syntax::RtOffsetRs,    Operation::Sw,      false},
+            {"swc1",    InstructionType::I, 0x39,   0x00, Syntax::RtOffsetRs,    Operation::Invalid, false},
+            {"xori",    InstructionType::I, 0x0E,   0x00, Syntax::RtRsImmediate, Operation::Xori,    true},
+            /** J-type */
+            {"j",       InstructionType::J, 0x02,   0x00, Syntax::Target,        Operation::J,       false},
+            {"jal",     InstructionType::J, 0x03,   0x00, Syntax::Target,        Operation::Jal,     false}
+      }};
+
+      /**
+       * @brief Decoding tables, from encoding fields to INSTRUCTIONS indices
+       *
+       * @details Encodings that are not in the table map to NONE.
+       */
+      struct DecodeTable {
+            static constexpr byte_t NONE = 0xFF;
+            std::array<byte_t, 64> primary;     /** By opcode (I and J types) */
+            std::array<byte_t, 64> special;     /** R-type, by funct */
+            std::array<byte_t, 32> regimm;      /** REGIMM, by rt */
+      };
+
+      /**
+       * @brief Builds the decoding tables of INSTRUCTIONS
+       *
+       * @details Evaluated by the compiler. Two instructions with the same
+       *          encoding fail to compile.
+       *
+       * @return DecodeTable
+       */
+      constexpr DecodeTable make_decode_table() {
+            DecodeTable table = {};
+            for (byte_t& slot : table.primary) slot = DecodeTable::NONE;
+            for (byte_t& slot : table.special) slot = DecodeTable::NONE;
+            for (byte_t& slot : table.regimm) slot = DecodeTable::NONE;
+
+            for (size_t i = 0; i < INSTRUCTIONS.size(); i++) {
+                  const InstructionInfo& info = INSTRUCTIONS[i];
+                  byte_t& slot = info.opcode == R_TYPE ? table.special[info.funct]
+                               : info.opcode == REGIMM ? table.regimm[info.funct]
+                               : table.primary[info.opcode];
+                  if (slot != DecodeTable::NONE) throw "Two instructions share an encoding";
+                  slot = static_cast<byte_t>(i);
+            }
+            return table;
+      }
+
+      constexpr DecodeTable DECODE_TABLE = make_decode_table();
+
       /** Syscall id */
       constexpr word_t SYSCALL = 0x0C;
 
@@ -61,21 +246,6 @@ namespace mips
             return static_cast<opcode_t>((instruction & OPCODE_MASK) >> OPCODE_SHIFT);
       }
 
-      /**
-       * @brief Get the instruction type of an opcode
-       * 
-       * @param[i] opcode 
-       * @return InstructionType 
-       */
-      /*InstructionType get_instruction_type(opcode_t opcode) {
-            switch (opcode) {
-                  case 0x00: return InstructionType::R;
-                  case 0x02: return InstructionType::J;
-                  case 0x03: return InstructionType::J;
-                  default: return InstructionType::I;
-            }
-      }*/
-
       /**
        * @brief Get the rs field of an instruction
        * 
@@ -146,6 +316,32 @@ namespace mips
             return (instruction & ADDRESS_MASK) >> ADDRESS_SHIFT;
       }
 
+      /**
+       * @brief Finds the description of an instruction
+       * 
+       * @param[i] instruction 
+       * @return The entry of INSTRUCTIONS, or nullptr for unknown encodings
+       */
+      inline const InstructionInfo* find_instruction(instruction_t instruction) {
+            opcode_t opcode = get_opcode(instruction);
+            byte_t index = opcode == R_TYPE ? DECODE_TABLE.special[get_funct(instruction)]
+                         : opcode == REGIMM ? DECODE_TABLE.regimm[get_rt(instruction)]
+                         : DECODE_TABLE.primary[opcode];
+            return index != DecodeTable::NONE ? &INSTRUCTIONS[index] : nullptr;
+      }
+
+      /**
+       * @brief Disassembles an instruction
+       * 
+       * @details Registers are printed by number. Branch and jump targets
+       *          are printed as absolute addresses.
+       * 
+       * @param[i] instruction The instruction
+       * @param[i] pc The address of the instruction
+       * @return The assembly (".word" for unknown encodings)
+       */
+      std::string disassemble(instruction_t instruction, address_t pc);
+
       /**
        * @brief Create a r instruction
        * 
@@ -0,0 +1,198 @@
+/**
+ * @file    jit.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ JIT engine.
+ *          The engine translates basic blocks of the program into native
+ *          x86-64 code and chains them together, falling back to the CPU
+ *          interpreter for syscalls and anything it cannot translate.
+ *
+ *          Generated code works directly on the CPU register file:
+ *
+ *            rbx  -> CPU registers ($0 - $31)
+ *            r14  -> Runtime (shared with the memory helpers)
+ *            r15  -> Remaining instruction budget
+ *            eax  -> Next program counter when leaving generated code
+ *
+ *          On other hosts the engine simply drives the interpreter.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_JIT_HPP
+#define MIPS_JIT_HPP
+
+/** C++ Includes */
+#include <exception>
+#include <unordered_map>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define MIPS_HAS_JIT 1
+#else
+#define MIPS_HAS_JIT 0
+#endif
+
+namespace mips
+{
+      /** Size of the executable code arena (flushed when full) */
+      constexpr size_t JIT_ARENA_SIZE = 16 * 1024 * 1024;
+
+      /** Maximum number of instructions translated into a single native block */
+      constexpr size_t JIT_MAX_BLOCK_LENGTH = 128;
+
+      /**
+       * @brief JIT execution engine
+       *
+       * @details Blocks end after a branch or jump, before an instruction
+       *          the JIT does not translate (syscalls, breaks, multiplication
+       *          and division, sub-word memory accesses and invalid
+       *          instructions), or after JIT_MAX_BLOCK_LENGTH instructions.
+       *          Instructions that raise a guest fault (overflow, misaligned
+       *          access) leave native code and are rerun by the interpreter.
+       *          Block exits are patched into direct jumps once their target
+       *          is translated, so hot code only returns to the dispatcher
+       *          for syscalls, faults and when the budget runs out.
+       *
+       *          Every block checks the budget on entry and leaves without
+       *          executing anything if it would overshoot, so run() is exact
+       *          to the instruction.
+       *
+       *          Writes to code pages flush the whole arena.
+       */
+      class JitEngine
+      {
+      public:
+            JitEngine(CPU* cpu, Memory* memory);
+            ~JitEngine();
+
+            JitEngine(const JitEngine&) = delete;
+            JitEngine& operator=(const JitEngine&) = delete;
+
+            /**
+             * @brief Runs the CPU
+             *
+             * @details Executes instructions until the budget is exhausted,
+             *          in native code where possible and through the CPU
+             *          interpreter otherwise. Guest faults stop the run as in
+             *          CPU::run(). If an instruction throws, the
+             *          program counter is left pointing at it and the
+             *          exception propagates.
+             *
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            uint64_t run(uint64_t budget);
+
+            /**
+             * @brief Runs the CPU in native code only
+             *
+             * @details Like run(), but returns as soon as the next instruction
+             *          would need the interpreter (or its block does not fit
+             *          in the remaining budget).
+             *
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            uint64_t run_native(uint64_t budget);
+
+            /** @brief Drops every translated block */
+            void flush();
+
+            /** State shared with generated code */
+            struct Runtime {
+                  /** Values of fault */
+                  static constexpr byte_t EXCEPTION = 1;    /** A helper's access threw (see exception) */
+                  static constexpr byte_t INTERPRET = 2;    /** The last instruction must be rerun by the interpreter */
+
+                  uint64_t remaining;     /** Budget left when generated code returns */
+                  byte_t fault;           /** Why generated code returned early (0 if it did not) */
+                  JitEngine* engine;
+            };
+
+      private:
+            /** A translated block (code is null when it needs the interpreter) */
+            struct Block {
+                  byte_t* code;
+                  size_t length;
+            };
+
+            /**
+             * @brief Returns the block starting at the given address
+             *
+             * @param[i] pc The address of the block
+             * @return The block
+             */
+            Block& lookup(address_t pc);
+
+            /**
+             * @brief Translates the block starting at the given address
+             *
+             * @param[i] pc The address of the block
+             * @return The block
+             */
+            Block& translate(address_t pc);
+
+            /**
+             * @brief Chains a block exit to its target
+             *
+             * @details Patches the exit into a direct jump if the target is
+             *          already translated, or remembers it until it is.
+             *
+             * @param[i] exit The patchable exit stub
+             * @param[i] target The address the exit leaves to
+             */
+            void link(byte_t* exit, address_t target);
+
+            /** Memory helpers called from generated code */
+            static word_t read_word(Runtime* runtime, address_t address);
+            static word_t write_word(Runtime* runtime, address_t address, word_t value);
+
+            std::unordered_map<address_t, Block> blocks;
+            std::unordered_map<address_t, std::vector<byte_t*>> pending_links;
+            word_t code_version;
+
+            /** Executable arena */
+            byte_t* arena = nullptr;
+            byte_t* cursor = nullptr;
+            byte_t* code_start = nullptr;   /** First byte after the entry/exit trampolines */
+            byte_t* epilogue = nullptr;
+
+            Runtime runtime;
+            std::exception_ptr exception;
+
+            CPU* cpu;
+            Memory* memory;
+      };
+} // namespace mips
+
+#endif // MIPS_JIT_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,111 @@
+/**
+ * @file    lexer.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ assembly lexer.
+ *          The lexer walks a source buffer once and hands out tokens as
+ *          views into it, so lexing never allocates.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_LEXER_HPP
+#define MIPS_LEXER_HPP
+
+/** C++ Includes */
+#include <string_view>
+
+/** Local Includes */
+#include "common.hpp"
+
+namespace mips
+{
+      /** Kinds of tokens */
+      enum class TokenKind : byte_t {
+            Identifier,       /** Mnemonic or symbol (letters, digits, '_' and '.') */
+            Label,            /** Identifier followed by ':' (the text excludes the colon) */
+            Directive,        /** '.' followed by an identifier (the text includes the dot) */
+            Register,         /** '$' followed by a name or number (the text includes the '$') */
+            Number,           /** Decimal or 0x hexadecimal integer, optionally signed */
+            String,           /** Double quoted literal (the text includes the quotes) */
+            Comma,
+            LeftParen,
+            RightParen,
+            EndOfLine,
+            EndOfFile,
+            Invalid           /** Any other character */
+      };
+
+      /** A token, viewing the source it was read from */
+      struct Token {
+            TokenKind kind;
+            std::string_view text;
+      };
+
+      /**
+       * @brief Assembly lexer
+       *
+       * @details Skips blanks and '#' comments. Every newline yields an
+       *          EndOfLine token, so the parser sees statement boundaries
+       *          without tracking lines itself.
+       */
+      class Lexer
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] source The source (must outlive the lexer and its tokens)
+             * @param[i] first_line The line number of the first line of the source
+             */
+            Lexer(std::string_view source, size_t first_line = 1) : cursor(source.data()), end(source.data() + source.size()), line(first_line) {}
+
+            /** @brief Reads the next token */
+            Token next();
+
+            /** @brief Returns the line of the last token read (1 based) */
+            size_t get_line() const { return line; }
+
+      private:
+            const char* cursor;
+            const char* end;
+            size_t line;
+            bool line_ended = false;      /** The last token was an EndOfLine */
+      };
+
+      /**
+       * @brief Parses an integer token
+       *
+       * @param[i] text Decimal or 0x hexadecimal digits, optionally signed
+       * @param[o] value The value
+       * @return false if the text is not an integer or its magnitude does
+       *         not fit in 32 bits
+       */
+      bool parse_integer(std::string_view text, int64_t& value);
+} // namespace mips
+
+#endif // MIPS_LEXER_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
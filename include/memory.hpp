@@ -42,7 +42,10 @@
 #define MIPS_MEMORY_HPP
 
 /** C++ Includes */
+#include <array>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 /** Local Includes */
@@ -57,25 +60,325 @@ namespace mips
       constexpr int DATA_OFFSET  = 0x10000000;     // Start of the data segment (data segment grows up)
       constexpr int STACK_OFFSET = 0x7FFFFFFF;     // End of the stack segment (stack grows down)
 
+      /** Layout of a loaded program (see Memory::map_standard_layout()) */
+      constexpr address_t HEAP_LIMIT = 0x40000000;       // End of the data segment and heap
+      constexpr word_t STACK_SIZE = 8 * 1024 * 1024;     // 8MB below STACK_OFFSET
+      constexpr address_t GLOBAL_POINTER = 0x10008000;   // Initial $gp
+      constexpr address_t STACK_POINTER  = 0x7FFFEFFC;   // Initial $sp
+
+      /** Segment permissions */
+      constexpr byte_t PERMISSION_READ    = 1 << 0;
+      constexpr byte_t PERMISSION_WRITE   = 1 << 1;
+      constexpr byte_t PERMISSION_EXECUTE = 1 << 2;
+      constexpr byte_t PERMISSION_ALL     = PERMISSION_READ | PERMISSION_WRITE | PERMISSION_EXECUTE;
+
+      /** A mapped segment of the address space */
+      struct MemoryRegion {
+            address_t start;        /** Page aligned */
+            uint64_t size;          /** Whole pages */
+            byte_t permissions;     /** PERMISSION_* flags */
+      };
+
+      /** Paging */
+      /**
+       * The address space is split into 4 KiB pages, indexed through a two
+       * level page table (1024 directory entries of 1024 pages each). Pages
+       * are only allocated the first time they are written to, reads from
+       * untouched pages are served by a shared zero page.
+       */
+      constexpr word_t PAGE_SHIFT      = 12;
+      constexpr word_t PAGE_SIZE       = 1 << PAGE_SHIFT;             // 4KB
+      constexpr word_t PAGE_MASK       = PAGE_SIZE - 1;
+      constexpr word_t PAGE_TABLE_BITS = 10;
+      constexpr word_t PAGE_TABLE_SIZE = 1 << PAGE_TABLE_BITS;        // Pages per table
+      constexpr word_t DIRECTORY_SHIFT = PAGE_SHIFT + PAGE_TABLE_BITS;
+
+      /** Software TLB */
+      /**
+       * Direct mapped by page number. Every load and store looks its page up
+       * here first; only misses walk the page directory.
+       */
+      constexpr size_t TLB_SIZE = 256;
+
+      /** TLB hit and miss counts (loads and stores) */
+      struct TlbStats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+      };
+
+      /**
+       * @brief Memory backends
+       *
+       * @details Paged reserves nothing up front and allocates pages on first
+       *          write. Mapped reserves the whole 32-bit address space with an
+       *          anonymous mapping and lets the kernel zero-fill pages on
+       *          demand, so accesses are a plain base + offset. MappedHuge
+       *          additionally asks the kernel to back the mapping with huge
+       *          pages.
+       */
+      enum class MemoryBackend { Paged, Mapped, MappedHuge };
+
       class Memory
       {
+      private:
+            using Page = std::array<byte_t, PAGE_SIZE>;
+            using PageTable = std::array<std::shared_ptr<Page>, PAGE_TABLE_SIZE>;
+            using Directory = std::array<std::shared_ptr<PageTable>, PAGE_TABLE_SIZE>;
+
       public:
-            Memory();
-            ~Memory() {}
+            /**
+             * @brief Saved memory contents
+             *
+             * @details Shares its pages and page tables with the memory it
+             *          was taken from and with every memory restored or
+             *          created from it. Shared pages are never written: the
+             *          writer copies the page (and its table) first.
+             */
+            class Snapshot
+            {
+            public:
+                  /** @brief Returns the number of pages held by the snapshot */
+                  size_t pages() const { return page_count; }
+
+                  /**
+                   * @brief Counts the pages held by a set of snapshots
+                   *
+                   * @details Pages shared between snapshots are counted once,
+                   *          so this is the host memory the set keeps alive.
+                   *
+                   * @param[i] snapshots The snapshots
+                   * @return The number of distinct pages
+                   */
+                  static size_t distinct_pages(const std::vector<const Snapshot*>& snapshots);
+
+            private:
+                  friend class Memory;
+
+                  Directory directory;
+                  size_t page_count = 0;
+                  std::vector<MemoryRegion> segments;
+            };
+
+            Memory(MemoryBackend backend = MemoryBackend::Paged);
+
+            /**
+             * @brief Creates a memory from a snapshot
+             *
+             * @details Uses the Paged backend and shares every page of the
+             *          snapshot, so it costs one page directory copy.
+             *
+             * @param[i] snapshot The snapshot
+             */
+            Memory(const Snapshot& snapshot);
+            ~Memory();
+
+            Memory(const Memory&) = delete;
+            Memory& operator=(const Memory&) = delete;
+
+            /** @brief Returns the backend in use */
+            MemoryBackend get_backend() const { return backend; }
+
+            /** @brief Releases every page, leaving the memory zeroed */
+            void clear();
+
+            /** @brief Returns the number of pages currently backed by host memory */
+            size_t resident_pages() const;
+
+            /**
+             * @brief Returns the number of pages copied on write
+             *
+             * @details Counts since the memory was created (Paged backend
+             *          only). The difference between two calls is the memory
+             *          a snapshot taken at the first one costs by the second.
+             */
+            size_t get_page_copies() const { return page_copies; }
+
+            /**
+             * @brief Takes a snapshot of the memory
+             *
+             * @details With the Paged backend the snapshot shares every page
+             *          copy-on-write and costs one page directory copy; later
+             *          writes copy only the pages they touch. The mapped
+             *          backends copy their resident pages instead.
+             *
+             * @return The snapshot
+             */
+            std::shared_ptr<const Snapshot> snapshot() const;
+
+            /**
+             * @brief Restores the contents saved in a snapshot
+             *
+             * @details With the Paged backend this shares the snapshot pages
+             *          again, dropping the pages written since. The mapped
+             *          backends copy the snapshot pages in. Bumps the code
+             *          version.
+             *
+             * @param[i] snapshot The snapshot
+             */
+            void restore(const Snapshot& snapshot);
+
+            /**
+             * @brief Marks the page holding the given address as code
+             *
+             * @details Called by the CPU when it caches a decoded instruction.
+             *          The next write landing on a marked page clears the mark
+             *          and bumps the code version, telling the CPU its cached
+             *          decodes are stale.
+             *
+             * @param[i] address The address
+             */
+            void mark_code_page(address_t address);
+
+            /**
+             * @brief Maps a segment
+             *
+             * @details Until the first segment is mapped the whole address
+             *          space is readable, writable and executable. After it,
+             *          accesses outside every segment, or without the
+             *          permission they need, throw mips::AccessViolation.
+             *          The range is widened to whole pages. Permissions are
+             *          checked when a page enters the TLB, so hits pay
+             *          nothing for them. Bumps the code version, so code
+             *          decoded under the old permissions is dropped.
+             *
+             * @param[i] start The first address
+             * @param[i] size The size in bytes
+             * @param[i] permissions PERMISSION_* flags
+             */
+            void map_segment(address_t start, uint64_t size, byte_t permissions);
+
+            /**
+             * @brief Maps the standard program layout
+             *
+             * @details Text is read-only and executable, data (with the heap
+             *          above it, up to HEAP_LIMIT) and the STACK_SIZE bytes
+             *          below STACK_OFFSET are read-write. Everything else,
+             *          including page zero, is unmapped.
+             *
+             * @param[i] text_size The size of the text segment
+             */
+            void map_standard_layout(word_t text_size);
+
+            /** @brief Drops every segment, making the address space flat again */
+            void unmap_segments();
+
+            /** @brief Returns the mapped segments */
+            const std::vector<MemoryRegion>& get_segments() const { return segments; }
+
+            /**
+             * @brief Returns the size of the executable segment at TEXT_OFFSET
+             *
+             * @details 0 if the standard layout is not mapped. Models sizing
+             *          per instruction tables use it.
+             */
+            uint64_t get_text_size() const;
+
+            /**
+             * @brief Returns the permissions at the given address
+             *
+             * @param[i] address The address
+             * @return PERMISSION_* flags (0 if unmapped)
+             */
+            byte_t permissions_at(address_t address) const;
+
+            /**
+             * @brief Reads an instruction
+             *
+             * @details Checks the address is executable and marks its page
+             *          as code (see mark_code_page()).
+             *
+             * @param[i] address The address of the instruction
+             * @return The instruction
+             * @throw mips::AccessViolation If the address is not executable
+             */
+            word_t fetch_word(address_t address);
+
+            /** @brief Returns the code version, bumped on writes to code pages */
+            word_t get_code_version() const { return code_version; }
+
+            /** @brief Returns the TLB hit and miss counts since creation or the last reset */
+            TlbStats get_tlb_stats() const { return { tlb_hits, tlb_misses }; }
+
+            /** @brief Zeroes the TLB hit and miss counts */
+            void reset_tlb_stats() { tlb_hits = tlb_misses = 0; }
 
             /** Read functions */
-            byte_t read_byte(address_t address);
-            halfword_t read_halfword(address_t address);
-            word_t read_word(address_t address);
+            byte_t read_byte(address_t address) {
+                  const byte_t* bytes = lookup_read(address, sizeof(byte_t));
+                  return bytes != nullptr ? *bytes : read_byte_slow(address);
+            }
+
+            halfword_t read_halfword(address_t address) {
+                  const byte_t* bytes = lookup_read(address, sizeof(halfword_t));
+                  return bytes != nullptr ? load_halfword(bytes) : read_halfword_slow(address);
+            }
+
+            word_t read_word(address_t address) {
+                  const byte_t* bytes = lookup_read(address, sizeof(word_t));
+                  return bytes != nullptr ? load_word(bytes) : read_word_slow(address);
+            }
 
             /** Write functions */
-            void write_byte(byte_t value, address_t address);
-            void write_halfword(halfword_t value, address_t address);
-            void write_word(word_t value, address_t address);
+            void write_byte(byte_t value, address_t address) {
+                  byte_t* bytes = lookup_write(address, sizeof(byte_t));
+                  if (bytes != nullptr) *bytes = value;
+                  else write_byte_slow(value, address);
+            }
+
+            void write_halfword(halfword_t value, address_t address) {
+                  byte_t* bytes = lookup_write(address, sizeof(halfword_t));
+                  if (bytes != nullptr) store_halfword(bytes, value);
+                  else write_halfword_slow(value, address);
+            }
+
+            void write_word(word_t value, address_t address) {
+                  byte_t* bytes = lookup_write(address, sizeof(word_t));
+                  if (bytes != nullptr) store_word(bytes, value);
+                  else write_word_slow(value, address);
+            }
+
+            /**
+             * @brief Copies a range of memory out
+             *
+             * @param[i] address The first address
+             * @param[o] bytes Where to copy to (size bytes)
+             * @param[i] size The number of bytes
+             */
+            void read_block(address_t address, byte_t* bytes, size_t size);
 
-            /** Load functions */
-            void load_text_section(std::ifstream& file, word_t offset, word_t size);
-            void load_data_section(std::ifstream& file, word_t offset, word_t size);
+            /**
+             * @brief Copies a range of bytes into memory
+             *
+             * @details Bumps the code version if the range covers a code page.
+             *
+             * @param[i] bytes The bytes to copy
+             * @param[i] size The number of bytes
+             * @param[i] address The first address
+             */
+            void write_block(const byte_t* bytes, size_t size, address_t address);
+
+            /**
+             * @brief Loads a text section
+             *
+             * @details Copies the bytes straight into guest pages, one page
+             *          at a time. Meant to run before the layout is mapped.
+             *
+             * @param[i] bytes The section bytes
+             * @param[i] offset The offset of the section from TEXT_OFFSET
+             * @param[i] size The number of bytes
+             * @throw std::runtime_error If the section runs into the data segment
+             */
+            void load_text_section(const byte_t* bytes, word_t offset, word_t size);
+
+            /**
+             * @brief Loads a data section
+             *
+             * @param[i] bytes The section bytes
+             * @param[i] offset The offset of the section from DATA_OFFSET
+             * @param[i] size The number of bytes
+             * @throw std::runtime_error If the section runs past HEAP_LIMIT
+             */
+            void load_data_section(const byte_t* bytes, word_t offset, word_t size);
 
             /** Read string */
             std::string read_string(address_t address);
@@ -100,18 +403,190 @@ namespace mips
 
       private:
             /**
-             * @brief Checks if the address is valid
+             * @brief A TLB entry
+             *
+             * @details The entry holds one tag per kind of access it allows:
+             *          the address of its page, or INVALID_TAG. Looking up
+             *          masks the address with the access size too, so
+             *          misaligned accesses (including every access that
+             *          straddles two pages) miss, and a hit is a single
+             *          compare.
+             *
+             *          Reads are allowed on every page. Writes are only
+             *          allowed once the page is privately owned and while it
+             *          is not a code page, so stores never check for either.
+             */
+            struct TlbEntry {
+                  address_t read_tag;
+                  address_t write_tag;
+                  byte_t* page;           /** Host address of the page */
+            };
+
+            /**
+             * Tag that never matches: every page offset bit is set, while a
+             * masked address keeps at most the two lowest ones
+             */
+            static constexpr address_t INVALID_TAG = PAGE_MASK;
+
+            /**
+             * @brief Returns the host address of a load, if the TLB hits
+             *
+             * @param[i] address The address
+             * @param[i] size The access size (a power of two up to 4)
+             * @return The host address, or null on a miss
+             */
+            const byte_t* lookup_read(address_t address, address_t size) {
+                  const TlbEntry& entry = tlb[(address >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+                  if (entry.read_tag != (address & (~PAGE_MASK | (size - 1)))) return nullptr;
+                  tlb_hits++;
+                  return entry.page + (address & PAGE_MASK);
+            }
+
+            /**
+             * @brief Returns the host address of a store, if the TLB hits
+             *
+             * @param[i] address The address
+             * @param[i] size The access size (a power of two up to 4)
+             * @return The host address, or null on a miss
+             */
+            byte_t* lookup_write(address_t address, address_t size) {
+                  const TlbEntry& entry = tlb[(address >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+                  if (entry.write_tag != (address & (~PAGE_MASK | (size - 1)))) return nullptr;
+                  tlb_hits++;
+                  return entry.page + (address & PAGE_MASK);
+            }
+
+            /**
+             * @brief Walks the page directory and refills the TLB entry
              *
-             * @param[i] address The address to check
-             * @return true/false
+             * @details Writing fills also note the write (code version) and
+             *          make the page private first.
+             *
+             * @param[i] address The address
+             * @param[i] write Whether the page is about to be written
+             * @return The host address of the page
+             * @throw mips::AccessViolation If the segment does not allow the access
+             */
+            byte_t* fill(address_t address, bool write);
+
+            /** @brief Invalidates every TLB entry */
+            void flush_tlb() const;
+
+            /** Slow paths (TLB misses and page straddling accesses) */
+            byte_t read_byte_slow(address_t address);
+            halfword_t read_halfword_slow(address_t address);
+            word_t read_word_slow(address_t address);
+            void write_byte_slow(byte_t value, address_t address);
+            void write_halfword_slow(halfword_t value, address_t address);
+            void write_word_slow(word_t value, address_t address);
+
+            /**
+             * Guest memory is big endian. Halfwords and words are moved with
+             * a single host load or store, byte swapped on little endian
+             * hosts.
              */
-            bool check_address(address_t address);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            static word_t swap_word(word_t value) { return value; }
+            static halfword_t swap_halfword(halfword_t value) { return value; }
+#elif defined(__GNUC__)
+            static word_t swap_word(word_t value) { return __builtin_bswap32(value); }
+            static halfword_t swap_halfword(halfword_t value) { return __builtin_bswap16(value); }
+#else
+            static word_t swap_word(word_t value) {
+                  return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+            }
+            static halfword_t swap_halfword(halfword_t value) {
+                  return static_cast<halfword_t>((value >> 8) | (value << 8));
+            }
+#endif
+
+            static word_t load_word(const byte_t* bytes) {
+                  word_t value;
+                  std::memcpy(&value, bytes, sizeof(value));
+                  return swap_word(value);
+            }
+
+            static halfword_t load_halfword(const byte_t* bytes) {
+                  halfword_t value;
+                  std::memcpy(&value, bytes, sizeof(value));
+                  return swap_halfword(value);
+            }
+
+            static void store_word(byte_t* bytes, word_t value) {
+                  value = swap_word(value);
+                  std::memcpy(bytes, &value, sizeof(value));
+            }
+
+            static void store_halfword(byte_t* bytes, halfword_t value) {
+                  value = swap_halfword(value);
+                  std::memcpy(bytes, &value, sizeof(value));
+            }
+
+            /**
+             * @brief Returns the page holding the given address for reading
+             *
+             * @details Never allocates, untouched pages resolve to the shared
+             *          zero page.
+             *
+             * @param[i] address The address
+             * @return Pointer to the first byte of the page
+             */
+            const byte_t* page_for_read(address_t address) const;
+
+            /**
+             * @brief Returns the page holding the given address for writing
+             *
+             * @details Allocates (zeroed) the page and its page table on first
+             *          use, and copies them first if they are shared with a
+             *          snapshot.
+             *
+             * @param[i] address The address
+             * @return Pointer to the first byte of the page
+             */
+            byte_t* page_for_write(address_t address);
+
+            /** @brief Checks if the address lies on a code page */
+            bool is_code_page(address_t address) const {
+                  if (code_pages.empty()) return false;
+                  return code_pages[address >> (PAGE_SHIFT + 6)] & (uint64_t(1) << ((address >> PAGE_SHIFT) & 63));
+            }
+
+            /**
+             * @brief Bumps the code version if the address lies on a code page
+             *
+             * @param[i] address The written address
+             */
+            void note_write(address_t address) {
+                  if (code_pages.empty()) return;
+                  uint64_t& bits = code_pages[address >> (PAGE_SHIFT + 6)];
+                  uint64_t bit = uint64_t(1) << ((address >> PAGE_SHIFT) & 63);
+                  if (bits & bit) {
+                        bits &= ~bit;
+                        code_version++;
+                  }
+            }
+
+            MemoryBackend backend;
+
+            /** Page directory (Paged backend) */
+            Directory directory;
+            size_t page_count = 0;
+            size_t page_copies = 0;
+
+            /** Base of the address space reservation (Mapped backends) */
+            byte_t* base = nullptr;
+
+            /** Software TLB (mutable: taking a snapshot revokes write access) */
+            mutable std::array<TlbEntry, TLB_SIZE> tlb;
+            uint64_t tlb_hits = 0;
+            uint64_t tlb_misses = 0;
+
+            /** Segments (none: the address space is flat) */
+            std::vector<MemoryRegion> segments;
 
-            /** @brief Zeroes the memory */
-            void zero_memory();
-            
-            /** Memory array */
-            std::vector<byte_t> memory = std::vector<byte_t>(MAX_MEMORY);
+            /** Code page bitmap (one bit per page, allocated on first use) */
+            std::vector<uint64_t> code_pages;
+            word_t code_version = 0;
       };
 } // namespace mipspp
 
@@ -15,6 +15,8 @@
 
 /** C++ Includes */
 #include <string>
+#include <string_view>
+#include <vector>
 
 /** Local Includes */
 #include "common.hpp"
@@ -22,7 +24,8 @@
 
 namespace mips
 {
-      constexpr int MIPS_VERSION = 1;
+      constexpr int MIPS_VERSION = 2;           // Version written by save_mips_binary()
+      constexpr int MIPS_VERSION_1 = 1;         // Text and data only, still loadable
       constexpr int MIPS_HEADER_SIZE_BYTES = 8;
 
       /** The file header is used to describe the binary file. */
@@ -34,7 +37,7 @@ namespace mips
             byte_t padding[1];      // Padding
       };
 
-      /** The section header is used to describe the sections of the binary file. */
+      /** The section header is used to describe the sections of the binary file (v1). */
       struct MIPS_section_header {
             byte_t segment;         // 0 = text, 1 = data
             byte_t padding[3];      // Padding
@@ -42,24 +45,124 @@ namespace mips
             word_t size;            // Size
       };
 
+      /**
+       * Version 2 layout:
+       *
+       *    file header | shnum section headers | section bytes...
+       *
+       * Every section header gives the file offset and size of its bytes, so
+       * sections can be read in any order (or skipped) without scanning the
+       * file. Multi-byte fields are in the byte order given by the file
+       * header; instruction and data bytes are big endian, as in memory.
+       */
+      enum class SectionType : byte_t {
+            Text,             /** Loaded at the section address */
+            Data,             /** Loaded at the section address */
+            Symbols,          /** MIPS_symbol entries */
+            Strings,          /** Symbol names, referenced by offset */
+            Relocations,      /** MIPS_relocation entries */
+            Lines             /** MIPS_line entries, sorted by address */
+      };
+
+      /** Section header (v2) */
+      struct MIPS_section_header_v2 {
+            byte_t type;            // SectionType
+            byte_t padding[3];      // Padding
+            address_t address;      // Load address (text and data)
+            uint64_t offset;        // File offset of the section bytes
+            uint64_t size;          // Size in bytes
+      };
+
+      /** Symbol table entry (v2) */
+      struct MIPS_symbol {
+            word_t name;            // Offset of the name in the string section
+            word_t name_size;       // Size of the name
+            address_t address;      // Address
+            word_t line;            // Line it is defined on
+            byte_t segment;         // 0 = text, 1 = data
+            byte_t padding[3];      // Padding
+      };
+
+      /** Relocation entry (v2), one per symbol reference patched by the assembler */
+      struct MIPS_relocation {
+            word_t offset;          // Offset of the patched word in its segment
+            word_t symbol;          // Index of the referenced symbol
+            byte_t kind;            // 0 = branch offset, 1 = jump target, 2 = full word
+            byte_t segment;         // 0 = text, 1 = data
+            byte_t padding[2];      // Padding
+      };
+
+      /** Line map entry (v2) */
+      struct MIPS_line {
+            address_t address;      // Address of the instruction
+            word_t line;            // Source line
+      };
+
+      /** A symbol read back from a binary */
+      struct ObjectSymbol {
+            std::string name;
+            address_t address;
+            byte_t segment;
+            word_t line;
+      };
+
+      /** Symbols, relocations and line map of a binary (empty for v1 files) */
+      struct MIPS_debug_info {
+            std::vector<ObjectSymbol> symbols;
+            std::vector<MIPS_relocation> relocations;
+            std::vector<MIPS_line> lines;
+      };
+
       /**
        * @brief Loads a MIPS binary file into memory
        * 
+       * @details Maps the file and hands it to load_mips_image().
+       * 
        * @param[i] filename 
        * @param[i] memory 
-       * @throw std::runtime_error If the file is not found
-       * @throw std::runtime_error If the file is not a valid MIPS binary file
+       * @throw mips::FileException If the file cannot be opened or is not a
+       *        valid MIPS binary file
        */
       void load_mips_binary(std::string filename, Memory* memory);
 
+      /**
+       * @brief Loads a MIPS binary image into memory
+       * 
+       * @details Sections are copied straight from the image into guest
+       *          pages, then the standard layout is mapped over them (see
+       *          Memory::map_standard_layout()), so text ends up read-only.
+       * 
+       * @param[i] image The contents of a MIPS binary file
+       * @param[i] memory 
+       * @throw mips::FileException If the image is not a valid MIPS binary
+       * @throw std::runtime_error If a section does not fit in its segment
+       */
+      void load_mips_image(std::string_view image, Memory* memory);
+
+      /**
+       * @brief Reads the symbols, relocations and line map of a binary image
+       * 
+       * @param[i] image The contents of a MIPS binary file
+       * @return The debug info (empty for v1 files)
+       * @throw mips::FileException If the image is not a valid MIPS binary
+       */
+      MIPS_debug_info read_mips_debug_info(std::string_view image);
+
       /**
        * @brief Saves a MIPS binary file
        * 
+       * @details Writes a v2 file: text, data (if not empty), then the
+       *          symbol, string, relocation and line sections (if there are
+       *          any symbols or lines). The file is assembled in one buffer
+       *          and written with a single call.
+       * 
        * @param[i] filename
-       * @param[i] binary
-       * @throw std::runtime_error If the file fails to open
+       * @param[i] text The text segment
+       * @param[i] data The data segment
+       * @param[i] info The symbols, relocations and line map
+       * @throw mips::FileException If the file cannot be written
        */
-      void save_mips_binary(std::string filename, std::vector<byte_t> binary);
+      void save_mips_binary(std::string filename, const std::vector<byte_t>& text, const std::vector<byte_t>& data = {}, const MIPS_debug_info& info = {});
 
       /**
        * @brief Dumps the MIPS binary file
@@ -0,0 +1,183 @@
+/**
+ * @file    pipeline.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ pipeline timing model.
+ *          The model estimates how many cycles the program would take on
+ *          the classic five-stage pipeline (IF, ID, EX, MEM, WB) with full
+ *          forwarding, from the stream of instructions the interpreter
+ *          executes. It does not simulate the stages cycle by cycle.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_PIPELINE_HPP
+#define MIPS_PIPELINE_HPP
+
+/** C++ Includes */
+#include <array>
+#include <iostream>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "instruction.hpp"
+
+namespace mips
+{
+      /** Latencies and penalties of the modelled pipeline, in cycles */
+      struct PipelineConfig {
+            word_t load_use = 1;          /** Stall of an instruction reading the result of the load before it */
+            word_t taken_branch = 2;      /** Branches resolve in EX and are predicted not taken */
+            word_t jump = 1;              /** j and jal resolve in ID */
+            word_t register_jump = 2;     /** jr and jalr resolve in EX */
+            word_t multiply = 12;         /** Cycles until mult's HI and LO can be read */
+            word_t divide = 35;           /** Cycles until div's HI and LO can be read */
+      };
+
+      /** Classes of instructions in the timing report */
+      enum class InstructionClass : byte_t { Alu, Load, Store, Branch, Jump, MultiplyDivide, Other, Count };
+
+      /**
+       * @brief Five-stage pipeline timing model
+       *
+       * @details Used as the inspector of CPU::run_inspected(). Every
+       *          instruction takes a cycle, plus:
+       *
+       *          - load-use stalls, charged to the instruction that reads
+       *            the loaded register;
+       *          - HI/LO stalls, charged to the mfhi or mflo that reads
+       *            them before mult or div is done;
+       *          - control penalties, charged to the taken branch or jump.
+       *            Whether a branch was taken is only known when the next
+       *            instruction arrives.
+       *
+       *          Plus four cycles to fill the pipeline. Per instruction,
+       *          the work is a table lookup and a few comparisons.
+       */
+      class PipelineModel
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] config The latencies and penalties
+             */
+            PipelineModel(const PipelineConfig& config = PipelineConfig());
+
+            /**
+             * @brief Accounts an instruction
+             *
+             * @param[i] cpu The CPU, before the instruction executes
+             * @param[i] decoded The instruction
+             */
+            void operator()(const CPU& cpu, const DecodedInstruction& decoded) {
+                  (void) cpu;
+                  const Timing& timing = timings[static_cast<size_t>(decoded.op)];
+                  ClassStats& stats = classes[static_cast<size_t>(timing.kind)];
+                  stats.instructions++;
+                  cycle++;
+
+                  /**
+                   * Branchless: whether a branch was taken is as hard to
+                   * predict for the host as it is for the modelled pipeline
+                   */
+                  const bool taken = pending_penalty != 0 && decoded.pc != fallthrough;
+                  ClassStats& transfer = classes[static_cast<size_t>(pending_kind)];
+                  transfer.taken += taken;
+                  transfer.control_cycles += taken * pending_penalty;
+                  cycle += taken * pending_penalty;
+
+                  const bool stalled = loaded != 0 && ((timing.reads_rs & (decoded.rs == loaded)) | (timing.reads_rt & (decoded.rt == loaded)));
+                  stats.load_use_cycles += stalled * config.load_use;
+                  cycle += stalled * config.load_use;
+
+                  if (timing.reads_hilo && cycle < hilo_ready) {
+                        stats.hilo_cycles += hilo_ready - cycle;
+                        cycle = hilo_ready;
+                  }
+                  if (timing.writes_hilo != 0) hilo_ready = cycle + timing.writes_hilo;
+
+                  loaded = timing.load ? decoded.rt : 0;
+                  pending_penalty = timing.penalty;
+                  pending_kind = timing.kind;
+                  fallthrough = decoded.pc + sizeof(instruction_t);
+            }
+
+            /**
+             * @brief Returns the modelled cycles
+             *
+             * @details Includes the cycles to fill the pipeline once some
+             *          instruction was accounted.
+             */
+            uint64_t get_cycles() const;
+
+            /** @brief Returns the number of instructions accounted */
+            uint64_t get_instructions() const;
+
+            /**
+             * @brief Writes the cycles, CPI and stall breakdown per class
+             *
+             * @param[o] output The stream
+             */
+            void write_report(std::ostream& output) const;
+
+      private:
+            /** What an operation does to the pipeline */
+            struct Timing {
+                  InstructionClass kind;
+                  bool reads_rs;
+                  bool reads_rt;
+                  bool load;              /** Writes rt in MEM */
+                  bool reads_hilo;
+                  word_t writes_hilo;     /** Cycles until HI and LO are ready, 0 if untouched */
+                  word_t penalty;         /** Cycles lost when the transfer is taken */
+            };
+
+            /** Counters of one class */
+            struct ClassStats {
+                  uint64_t instructions = 0;
+                  uint64_t taken = 0;
+                  uint64_t load_use_cycles = 0;
+                  uint64_t hilo_cycles = 0;
+                  uint64_t control_cycles = 0;
+            };
+
+            PipelineConfig config;
+            std::array<Timing, static_cast<size_t>(Operation::Count)> timings;
+            std::array<ClassStats, static_cast<size_t>(InstructionClass::Count)> classes;
+
+            uint64_t cycle = 0;                 /** Issue cycle of the last instruction */
+            uint64_t hilo_ready = 0;            /** Cycle HI and LO can be read at */
+            byte_t loaded = 0;                  /** Register the previous instruction loaded, 0 if none */
+            word_t pending_penalty = 0;         /** Penalty of the previous instruction if taken */
+            InstructionClass pending_kind = InstructionClass::Other;
+            address_t fallthrough = 0;          /** Address after the previous instruction */
+      };
+} // namespace mips
+
+#endif // MIPS_PIPELINE_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
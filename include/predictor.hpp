@@ -0,0 +1,389 @@
+/**
+ * @file    predictor.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ branch prediction models.
+ *          Static, bimodal, gshare and tournament direction predictors,
+ *          a branch target buffer and a return address stack are simulated
+ *          over the branches and jumps of the interpreted program.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_PREDICTOR_HPP
+#define MIPS_PREDICTOR_HPP
+
+/** C++ Includes */
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "instruction.hpp"
+#include "memory.hpp"
+
+namespace mips
+{
+      /** Direction predictor table sizes (log2 of the number of counters) */
+      constexpr size_t PREDICTOR_TABLE_BITS = 12;
+
+      /** Global history bits of gshare */
+      constexpr size_t PREDICTOR_HISTORY_BITS = 12;
+
+      /** Branch target buffer entries (direct mapped) */
+      constexpr size_t BTB_ENTRIES = 512;
+
+      /** Return address stack depth (the oldest entry is overwritten when full) */
+      constexpr size_t RAS_DEPTH = 16;
+
+      /**
+       * @brief Two-bit saturating counter table
+       *
+       * @details 0 and 1 predict not taken, 2 and 3 taken. Counters start
+       *          weakly not taken.
+       */
+      class CounterTable
+      {
+      public:
+            CounterTable() { counters.fill(1); }
+
+            bool taken(size_t index) const { return counters[index & MASK] >= 2; }
+
+            void update(size_t index, bool taken) {
+                  byte_t& counter = counters[index & MASK];
+                  if (taken && counter < 3) counter++;
+                  else if (!taken && counter > 0) counter--;
+            }
+
+      private:
+            static constexpr size_t MASK = (size_t(1) << PREDICTOR_TABLE_BITS) - 1;
+            std::array<byte_t, size_t(1) << PREDICTOR_TABLE_BITS> counters;
+      };
+
+      /**
+       * Direction predictors
+       *
+       * A predictor is a policy: predict(pc, target) guesses whether the
+       * conditional branch at pc is taken, and update(pc, taken) teaches
+       * it the outcome. BranchModel takes it as a template parameter so
+       * both calls inline into the interpreter loop.
+       */
+
+      /** Backward taken, forward not taken */
+      struct StaticPredictor
+      {
+            static constexpr const char* NAME = "static";
+
+            bool predict(address_t pc, address_t target) const { return target <= pc; }
+            void update(address_t, bool) {}
+      };
+
+      /** A two-bit counter per branch, indexed by address */
+      struct BimodalPredictor
+      {
+            static constexpr const char* NAME = "bimodal";
+
+            bool predict(address_t pc, address_t) const { return counters.taken(pc >> 2); }
+            void update(address_t pc, bool taken) { counters.update(pc >> 2, taken); }
+
+            CounterTable counters;
+      };
+
+      /** Two-bit counters indexed by address xor global history */
+      struct GsharePredictor
+      {
+            static constexpr const char* NAME = "gshare";
+
+            bool predict(address_t pc, address_t) const { return counters.taken(index(pc)); }
+            void update(address_t pc, bool taken) {
+                  counters.update(index(pc), taken);
+                  history = ((history << 1) | taken) & ((size_t(1) << PREDICTOR_HISTORY_BITS) - 1);
+            }
+
+            size_t index(address_t pc) const { return (pc >> 2) ^ history; }
+
+            CounterTable counters;
+            size_t history = 0;
+      };
+
+      /** Bimodal and gshare, with a two-bit chooser per branch */
+      struct TournamentPredictor
+      {
+            static constexpr const char* NAME = "tournament";
+
+            bool predict(address_t pc, address_t target) const {
+                  return chooser.taken(pc >> 2) ? global.predict(pc, target) : local.predict(pc, target);
+            }
+
+            /** The chooser moves towards whichever component was right when they disagree */
+            void update(address_t pc, bool taken) {
+                  const bool by_local = local.predict(pc, 0);
+                  const bool by_global = global.predict(pc, 0);
+                  if (by_local != by_global) chooser.update(pc >> 2, by_global == taken);
+                  local.update(pc, taken);
+                  global.update(pc, taken);
+            }
+
+            BimodalPredictor local;
+            GsharePredictor global;
+            CounterTable chooser;
+      };
+
+      /** Direction predictors selectable at run time */
+      enum class PredictorKind : byte_t { Static, Bimodal, Gshare, Tournament };
+
+      /**
+       * @brief Parses a predictor name
+       *
+       * @param[i] name static, bimodal, gshare or tournament
+       * @return The predictor
+       * @throw mips::Exception If the name is unknown
+       */
+      PredictorKind parse_predictor(const std::string& name);
+
+      /**
+       * @brief Branch prediction counters and report
+       *
+       * @details The part of BranchModel that does not depend on the
+       *          predictor. Per instruction counters are sized from
+       *          Memory::get_text_size(), one entry per instruction.
+       *          A transfer is mispredicted when fetch would have gone the
+       *          wrong way: a wrong direction, a taken transfer the BTB
+       *          had no (or a stale) target for, or a return the RAS got
+       *          wrong.
+       */
+      class BranchStats
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] memory The memory of the simulated program (sizes the
+             *                  per instruction counters)
+             * @param[i] predictor The name of the direction predictor
+             */
+            BranchStats(Memory* memory, const char* predictor);
+
+            /**
+             * @brief Writes the totals and the branches mispredicted the most
+             *
+             * @param[o] output The stream
+             */
+            void write_report(std::ostream& output) const;
+
+      protected:
+            /** Counters of one instruction */
+            struct PcStats {
+                  uint64_t executed = 0;
+                  uint64_t taken = 0;
+                  uint64_t mispredicted = 0;
+            };
+
+            /** Counters of one class of transfers */
+            struct KindStats {
+                  uint64_t executed = 0;
+                  uint64_t mispredicted = 0;
+            };
+
+            /**
+             * @brief Returns the counters of an instruction
+             *
+             * @param[i] pc The address of the instruction
+             */
+            PcStats& at(address_t pc) {
+                  const address_t index = (pc - TEXT_OFFSET) >> 2;
+                  return index < per_pc.size() ? per_pc[index] : outside;
+            }
+
+            KindStats conditional;        /** Direction mispredictions */
+            KindStats targets;            /** Taken transfers the BTB missed */
+            KindStats returns;            /** jr $ra the RAS missed */
+
+      private:
+            Memory* memory;
+            const char* predictor;
+            std::vector<PcStats> per_pc;
+            PcStats outside;              /** Transfers outside the text segment */
+      };
+
+      /**
+       * @brief Branch prediction model
+       *
+       * @details Used as the inspector of CPU::run_inspected(). Outcomes are
+       *          computed from the registers before the transfer executes.
+       *          Conditional branches ask the Predictor for a direction.
+       *          Taken transfers other than returns ask the BTB for a target.
+       *          Calls (jal, jalr and taken bltzal/bgezal) push a return
+       *          address that jr $ra pops.
+       *
+       * @tparam Predictor StaticPredictor, BimodalPredictor, GsharePredictor
+       *                   or TournamentPredictor
+       */
+      template <typename Predictor>
+      class BranchModel : public BranchStats
+      {
+      public:
+            BranchModel(Memory* memory) : BranchStats(memory, Predictor::NAME) {
+                  btb_tags.fill(UINT32_MAX);
+                  btb_targets.fill(0);
+                  ras.fill(0);
+            }
+
+            /**
+             * @brief Predicts and resolves an instruction, if it transfers control
+             *
+             * @param[i] cpu The CPU, before the instruction executes
+             * @param[i] decoded The instruction
+             */
+            void operator()(const CPU& cpu, const DecodedInstruction& decoded) {
+                  const register_t rs = cpu.get_register(decoded.rs);
+                  const int32_t signed_rs = static_cast<int32_t>(rs);
+                  const address_t next = decoded.pc + sizeof(instruction_t);
+
+                  switch (decoded.op) {
+                        case Operation::Beq: branch(decoded, rs == cpu.get_register(decoded.rt), false); break;
+                        case Operation::Bne: branch(decoded, rs != cpu.get_register(decoded.rt), false); break;
+                        case Operation::Blez: branch(decoded, signed_rs <= 0, false); break;
+                        case Operation::Bgtz: branch(decoded, signed_rs > 0, false); break;
+                        case Operation::Bltz: branch(decoded, signed_rs < 0, false); break;
+                        case Operation::Bgez: branch(decoded, signed_rs >= 0, false); break;
+                        case Operation::Bltzal: branch(decoded, signed_rs < 0, true); break;
+                        case Operation::Bgezal: branch(decoded, signed_rs >= 0, true); break;
+                        case Operation::J: jump(decoded.pc, (next & JUMP_REGION_MASK) | decoded.immediate, false); break;
+                        case Operation::Jal: jump(decoded.pc, (next & JUMP_REGION_MASK) | decoded.immediate, true); break;
+                        case Operation::Jalr: jump(decoded.pc, rs, true); break;
+                        case Operation::Jr:
+                              if (decoded.rs == 31) ret(decoded.pc, rs);
+                              else jump(decoded.pc, rs, false);
+                              break;
+                        default:
+                              break;
+                  }
+            }
+
+      private:
+            /**
+             * @brief Resolves a conditional branch
+             *
+             * @param[i] decoded The branch
+             * @param[i] taken Whether it is taken
+             * @param[i] link Whether it links (a call when taken)
+             */
+            void branch(const DecodedInstruction& decoded, bool taken, bool link) {
+                  const address_t target = decoded.pc + sizeof(instruction_t) + (decoded.immediate << 2);
+                  const bool predicted = predictor.predict(decoded.pc, target);
+                  predictor.update(decoded.pc, taken);
+
+                  PcStats& stats = at(decoded.pc);
+                  stats.executed++;
+                  stats.taken += taken;
+                  conditional.executed++;
+                  conditional.mispredicted += predicted != taken;
+
+                  /** A taken branch also needs its target from the BTB */
+                  bool missed = predicted != taken;
+                  if (taken) {
+                        const bool hit = lookup(decoded.pc, target);
+                        missed |= !hit;
+                        if (link) push(decoded.pc + sizeof(instruction_t));
+                  }
+                  stats.mispredicted += missed;
+            }
+
+            /**
+             * @brief Resolves an unconditional jump
+             *
+             * @param[i] pc The address of the jump
+             * @param[i] target Where it goes
+             * @param[i] link Whether it is a call
+             */
+            void jump(address_t pc, address_t target, bool link) {
+                  PcStats& stats = at(pc);
+                  stats.executed++;
+                  stats.taken++;
+                  stats.mispredicted += !lookup(pc, target);
+                  if (link) push(pc + sizeof(instruction_t));
+            }
+
+            /**
+             * @brief Resolves a return
+             *
+             * @param[i] pc The address of the jr $ra
+             * @param[i] target Where it goes
+             */
+            void ret(address_t pc, address_t target) {
+                  top = (top - 1) & (RAS_DEPTH - 1);
+                  const bool missed = ras[top] != target;
+
+                  PcStats& stats = at(pc);
+                  stats.executed++;
+                  stats.taken++;
+                  stats.mispredicted += missed;
+                  returns.executed++;
+                  returns.mispredicted += missed;
+            }
+
+            /**
+             * @brief Looks a taken transfer up in the BTB, then records its target
+             *
+             * @param[i] pc The address of the transfer
+             * @param[i] target Where it went
+             * @return true if the BTB held the right target
+             */
+            bool lookup(address_t pc, address_t target) {
+                  const size_t index = (pc >> 2) & (BTB_ENTRIES - 1);
+                  const bool hit = btb_tags[index] == pc && btb_targets[index] == target;
+                  btb_tags[index] = pc;
+                  btb_targets[index] = target;
+
+                  targets.executed++;
+                  targets.mispredicted += !hit;
+                  return hit;
+            }
+
+            /**
+             * @brief Pushes a return address
+             *
+             * @param[i] address The address after the call
+             */
+            void push(address_t address) {
+                  ras[top] = address;
+                  top = (top + 1) & (RAS_DEPTH - 1);
+            }
+
+            Predictor predictor;
+            std::array<address_t, BTB_ENTRIES> btb_tags;
+            std::array<address_t, BTB_ENTRIES> btb_targets;
+            std::array<address_t, RAS_DEPTH> ras;
+            size_t top = 0;
+      };
+} // namespace mips
+
+#endif // MIPS_PREDICTOR_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,199 @@
+/**
+ * @file    profiler.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ guest profiler.
+ *          The profiler counts the instructions a program executes per
+ *          address, per basic block and per branch outcome, and tracks its
+ *          calls to attribute them to call stacks.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_PROFILER_HPP
+#define MIPS_PROFILER_HPP
+
+/** C++ Includes */
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "memory.hpp"
+#include "obj.hpp"
+
+namespace mips
+{
+      /** Number of entries in each table of the hot-spot report */
+      constexpr size_t PROFILE_REPORT_LIMIT = 20;
+
+      /**
+       * @brief Guest profiler
+       *
+       * @details Counters live in flat arrays indexed by
+       *          (pc - TEXT_OFFSET) >> 2, sized to the text segment, so
+       *          recording an instruction is a couple of increments.
+       *          Instructions outside the text segment are only counted.
+       *
+       *          Control transfers are classified when their address is
+       *          first executed. Their targets count as basic block
+       *          entries. Calls (jal, jalr and the linking branches) push a
+       *          frame and jr $ra pops one. Every instruction is
+       *          attributed to the call stack it ran under.
+       */
+      class Profiler
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @details Sizes the counters to the executable segment at
+             *          TEXT_OFFSET (see Memory::map_standard_layout()).
+             *
+             * @param[i] memory The memory of the profiled program
+             * @param[i] entry The address execution starts at
+             */
+            Profiler(Memory* memory, address_t entry = TEXT_OFFSET);
+
+            /**
+             * @brief Sets the symbols and line map used in the reports
+             *
+             * @param[i] info The debug info of the program (see read_mips_debug_info())
+             */
+            void set_debug_info(MIPS_debug_info info);
+
+            /**
+             * @brief Records an executed instruction
+             *
+             * @param[i] from The address of the instruction
+             * @param[i] to The address of the next instruction
+             */
+            void record(address_t from, address_t to) {
+                  const address_t index = (from - TEXT_OFFSET) >> 2;
+                  if (index >= counts.size()) {
+                        outside++;
+                        return;
+                  }
+
+                  samples[frame]++;
+                  if (counts[index]++ == 0) kinds[index] = classify(from);
+                  if (kinds[index] != Kind::Plain) transfer(index, from, to);
+            }
+
+            /** @brief Returns the number of instructions recorded */
+            uint64_t get_total() const;
+
+            /**
+             * @brief Writes the hot-spot report
+             *
+             * @details The hottest instructions, basic blocks and branches,
+             *          PROFILE_REPORT_LIMIT of each, with their symbols and
+             *          source lines.
+             *
+             * @param[o] output The stream
+             */
+            void write_report(std::ostream& output);
+
+            /**
+             * @brief Writes the folded call stacks
+             *
+             * @details One "caller;callee;... count" line per call stack,
+             *          as consumed by flamegraph.pl and compatible tools.
+             *
+             * @param[o] output The stream
+             */
+            void write_folded(std::ostream& output) const;
+
+      private:
+            /** Classes of instructions */
+            enum class Kind : byte_t {
+                  Plain,      /** Falls through to the next instruction */
+                  Branch,     /** Conditional branch */
+                  Jump,       /** j and jr (other than jr $ra) */
+                  Call,       /** jal, jalr, bltzal and bgezal */
+                  Return      /** jr $ra */
+            };
+
+            /** A call stack frame */
+            struct Frame {
+                  uint32_t parent;
+                  address_t function;
+            };
+
+            /**
+             * @brief Classifies the instruction at the given address
+             *
+             * @param[i] address The address
+             * @return The class
+             */
+            Kind classify(address_t address);
+
+            /**
+             * @brief Records a control transfer
+             *
+             * @param[i] index The counter index of the instruction
+             * @param[i] from The address of the instruction
+             * @param[i] to The address of the next instruction
+             */
+            void transfer(address_t index, address_t from, address_t to);
+
+            /**
+             * @brief Names an address
+             *
+             * @param[i] address The address
+             * @return "symbol", "symbol+0x10" or the address in hex
+             */
+            std::string symbolize(address_t address) const;
+
+            /**
+             * @brief Finds the source line of an instruction
+             *
+             * @param[i] address The address
+             * @return The line, or 0 if unknown
+             */
+            word_t line_of(address_t address) const;
+
+            Memory* memory;
+            std::vector<uint64_t> counts;       /** Executions per instruction */
+            std::vector<uint64_t> taken;        /** Taken transfers per instruction */
+            std::vector<uint64_t> entries;      /** Block entries per instruction */
+            std::vector<Kind> kinds;            /** Classes, valid once counted */
+            uint64_t outside = 0;               /** Instructions outside the text segment */
+
+            std::vector<Frame> frames;                            /** Call tree (0 is the entry) */
+            std::vector<uint64_t> samples;                        /** Instructions per frame */
+            std::unordered_map<uint64_t, uint32_t> children;      /** (parent, function) to frame */
+            uint32_t frame = 0;                                   /** The current frame */
+
+            std::vector<ObjectSymbol> symbols;  /** Text symbols, by address */
+            std::vector<MIPS_line> lines;       /** Line map, by address */
+      };
+} // namespace mips
+
+#endif // MIPS_PROFILER_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
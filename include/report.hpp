@@ -0,0 +1,55 @@
+/**
+ * @file    report.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the formatting helpers shared by the
+ *          MIPS++ reports (profiler, cache, branch prediction).
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_REPORT_HPP
+#define MIPS_REPORT_HPP
+
+/** Local Includes */
+#include "common.hpp"
+
+namespace mips
+{
+      /**
+       * @brief Returns count as a percentage of total
+       *
+       * @param[i] count The share
+       * @param[i] total The total, the result is 0 if it is 0
+       * @return The percentage
+       */
+      inline double percent(uint64_t count, uint64_t total) {
+            return total == 0 ? 0.0 : 100.0 * count / total;
+      }
+} // namespace mips
+
+#endif // MIPS_REPORT_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
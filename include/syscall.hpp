@@ -0,0 +1,231 @@
+/**
+ * @file    syscall.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ syscall layer.
+ *          Syscalls go through a SyscallHandler, which the CPU calls with
+ *          the syscall code in $v0. The standard handler implements the
+ *          SPIM/MARS services on top of an IO object, so programs can talk
+ *          to the terminal, to in-memory buffers or to anything else.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_SYSCALL_HPP
+#define MIPS_SYSCALL_HPP
+
+/** C++ Includes */
+#include <iostream>
+#include <string>
+#include <string_view>
+
+/** Local Includes */
+#include "common.hpp"
+
+namespace mips
+{
+      class CPU;
+      class Memory;
+
+      /** Size of the output buffer of a StreamIO */
+      constexpr size_t IO_BUFFER_SIZE = 64 * 1024;
+
+      /** Value returned by IO::read_char() at the end of the input */
+      constexpr int IO_EOF = -1;
+
+      /**
+       * @brief Syscall input and output
+       */
+      class IO
+      {
+      public:
+            virtual ~IO() {}
+
+            /**
+             * @brief Writes program output
+             *
+             * @param[i] data The bytes to write
+             */
+            virtual void write(std::string_view data) = 0;
+
+            /**
+             * @brief Reads a line of input
+             *
+             * @param[o] line The line, without its newline
+             * @return false at the end of the input
+             */
+            virtual bool read_line(std::string& line) = 0;
+
+            /**
+             * @brief Reads a character of input
+             *
+             * @return The character, or IO_EOF at the end of the input
+             */
+            virtual int read_char() = 0;
+
+            /** @brief Pushes buffered output to its destination */
+            virtual void flush() {}
+      };
+
+      /**
+       * @brief IO over standard streams
+       *
+       * @details Output is buffered and written in IO_BUFFER_SIZE chunks, so
+       *          print-heavy programs do not pay for a stream call per
+       *          character. The buffer is flushed before every read (so
+       *          prompts show up before the program blocks), on flush() and
+       *          on destruction.
+       */
+      class StreamIO : public IO
+      {
+      public:
+            StreamIO(std::istream& input, std::ostream& output);
+            ~StreamIO();
+
+            void write(std::string_view data) override;
+            bool read_line(std::string& line) override;
+            int read_char() override;
+            void flush() override;
+
+      private:
+            std::istream& input;
+            std::ostream& output;
+            std::string buffer;
+      };
+
+      /**
+       * @brief IO over in-memory buffers
+       *
+       * @details Reads come from a preloaded input string, writes are
+       *          collected in memory.
+       */
+      class BufferIO : public IO
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] input The whole input of the program
+             */
+            BufferIO(std::string input = "");
+            ~BufferIO() {}
+
+            void write(std::string_view data) override;
+            bool read_line(std::string& line) override;
+            int read_char() override;
+
+            /** @brief Gets everything written so far */
+            const std::string& get_output() const { return output; }
+
+      private:
+            std::string input;
+            size_t position = 0;    /** Next input character */
+            std::string output;
+      };
+
+      /** Outcome of a syscall */
+      enum class SyscallResult {
+            Continue,   /** Resume at the next instruction */
+            Halt,       /** Stop the program, exit code in $a0 */
+            Invalid     /** Unknown syscall code (raises a fault) */
+      };
+
+      /**
+       * @brief Syscall handler
+       *
+       * @details Called by the CPU for every syscall instruction, with the
+       *          program counter already past it.
+       */
+      class SyscallHandler
+      {
+      public:
+            virtual ~SyscallHandler() {}
+
+            /**
+             * @brief Executes the syscall selected by $v0
+             *
+             * @param[io] cpu The calling CPU
+             * @param[io] memory The CPU memory
+             * @return What the CPU should do next
+             */
+            virtual SyscallResult execute(CPU& cpu, Memory& memory) = 0;
+
+            /** @brief Pushes buffered output to its destination */
+            virtual void flush() {}
+
+            /**
+             * @brief Returns the guest memory the last syscall wrote
+             *
+             * @details Lockstep only runs syscalls on the reference machine
+             *          and copies this range to the shadow one.
+             *
+             * @param[o] address The first address written
+             * @return The number of bytes written
+             */
+            virtual size_t last_write(address_t& address) const { (void) address; return 0; }
+      };
+
+      /**
+       * @brief SPIM/MARS syscall services
+       *
+       * @details Supports print_int (1), print_string (4), read_int (5),
+       *          read_string (8), exit (10), print_char (11) and
+       *          read_char (12).
+       */
+      class StandardSyscalls : public SyscallHandler
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] io The IO the services use (must outlive the handler)
+             */
+            StandardSyscalls(IO* io) : io(io) {}
+            ~StandardSyscalls() {}
+
+            SyscallResult execute(CPU& cpu, Memory& memory) override;
+            void flush() override { io->flush(); }
+            size_t last_write(address_t& address) const override { address = written_address; return written_size; }
+
+            /**
+             * @brief Gets the handler every CPU starts with
+             *
+             * @details Talks to std::cin and std::cout. Not meant to be shared
+             *          by CPUs running on different threads.
+             *
+             * @return The handler
+             */
+            static StandardSyscalls& standard();
+
+      private:
+            IO* io;
+            address_t written_address = 0;
+            size_t written_size = 0;
+      };
+} // namespace mips
+
+#endif // MIPS_SYSCALL_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
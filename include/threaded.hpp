@@ -0,0 +1,149 @@
+/**
+ * @file    threaded.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ threaded-code engine.
+ *          The engine translates each basic block of the program into an
+ *          array of pre-decoded operations and jumps straight from one
+ *          operation to the next, instead of going through the CPU decoder
+ *          for every instruction.
+ *
+ *          On GCC and Clang the dispatch uses computed gotos (labels as
+ *          values), elsewhere it falls back to a switch.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_THREADED_HPP
+#define MIPS_THREADED_HPP
+
+/** C++ Includes */
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+
+#if defined(__GNUC__)
+#define MIPS_COMPUTED_GOTO 1
+#else
+#define MIPS_COMPUTED_GOTO 0
+#endif
+
+namespace mips
+{
+      /** Maximum number of instructions translated into a single block */
+      constexpr size_t MAX_BLOCK_LENGTH = 128;
+
+      /**
+       * @brief Threaded-code execution engine
+       *
+       * @details Drives a CPU through translated basic blocks. A block ends
+       *          after a branch, jump, syscall or invalid instruction, or
+       *          after MAX_BLOCK_LENGTH instructions.
+       *          Blocks remember their last two successors so hot loops go
+       *          from block to block without a lookup.
+       *
+       *          Blocks are dropped whenever the program writes to a page it
+       *          was decoded from.
+       */
+      class ThreadedEngine
+      {
+      public:
+            ThreadedEngine(CPU* cpu, Memory* memory);
+            ~ThreadedEngine() {}
+
+            /**
+             * @brief Runs the CPU
+             *
+             * @details Executes instructions until the budget is exhausted or
+             *          the program faults (see CPU::run()). If an instruction
+             *          throws, the program counter is left pointing at it and
+             *          the exception propagates.
+             *
+             * @param[i] budget The maximum number of instructions to execute
+             * @return The number of instructions executed
+             */
+            uint64_t run(uint64_t budget);
+
+            /** @brief Drops every translated block */
+            void flush();
+
+      private:
+            /** A translated instruction */
+            struct ThreadedOp {
+                  const void* label;            /** Dispatch target (computed goto) */
+                  byte_t kind;                  /** Operation or one of the pseudo operations below */
+                  DecodedInstruction decoded;   /** The decoded instruction */
+            };
+
+            /** Pseudo operations */
+            static constexpr byte_t BLOCK_END = static_cast<byte_t>(Operation::Count);
+            static constexpr byte_t BUDGET_EXIT = BLOCK_END + 1;
+
+            /** A translated basic block */
+            struct Block {
+                  std::vector<ThreadedOp> ops;  /** Instructions, followed by a BLOCK_END */
+                  size_t length;                /** Number of instructions */
+                  address_t successor_pc[2];    /** Last successors seen */
+                  Block* successor[2];
+            };
+
+            /**
+             * @brief Returns the block starting at the given address
+             *
+             * @details Checks the successors of the previous block first,
+             *          then the block map, translating on a miss.
+             *
+             * @param[i] previous The block executed last (may be null)
+             * @param[i] pc The address of the block
+             * @param[i] labels The dispatch labels (null without computed goto)
+             * @return The block
+             */
+            Block* next_block(Block* previous, address_t pc, const void* const* labels);
+
+            /**
+             * @brief Translates the basic block starting at the given address
+             *
+             * @param[i] pc The address of the block
+             * @param[i] labels The dispatch labels (null without computed goto)
+             * @return The block
+             */
+            Block* translate(address_t pc, const void* const* labels);
+
+            std::unordered_map<address_t, std::unique_ptr<Block>> blocks;
+            word_t code_version;    /** Memory code version the blocks match */
+
+            CPU* cpu;
+            Memory* memory;
+      };
+} // namespace mips
+
+#endif // MIPS_THREADED_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,393 @@
+/**
+ * @file    trace.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   This header file contains the MIPS++ execution trace recorder.
+ *          The recorder writes the retired instructions of a program, with
+ *          their register writes and memory accesses, in a compact binary
+ *          format. Records are staged in a lock-free ring buffer that a
+ *          background thread drains to the trace file.
+ *
+ * @date    2026-10-16
+ *
+ * @copyright Copyright (c) 2023 JoaoAJMatos
+ */
+
+#ifndef MIPS_TRACE_HPP
+#define MIPS_TRACE_HPP
+
+/** C++ Includes */
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Local Includes */
+#include "common.hpp"
+#include "cpu.hpp"
+#include "instruction.hpp"
+
+namespace mips
+{
+      /**
+       * Trace format
+       *
+       * A trace starts with the 4 bytes "MTRC" and a version byte, followed
+       * by one record per retired instruction. A record is a flags byte and
+       * the fields its flags select, in this order:
+       *
+       *   TRACE_JUMP      varint(zigzag(pc - (previous pc + 4)))
+       *   TRACE_REGISTER  register number (1 byte), varint(zigzag(value - previous value))
+       *   TRACE_HILO      varint(zigzag(hi - previous hi)), varint(zigzag(lo - previous lo))
+       *   TRACE_LOAD or
+       *   TRACE_STORE     varint(zigzag(address - previous address))
+       *   TRACE_STORE     varint(stored value)
+       *
+       * Loads and stores access 1 << ((flags & TRACE_SIZE) >> TRACE_SIZE_SHIFT)
+       * bytes. The "previous" values start at zero, so the first record
+       * holds the full entry point. Varints are little endian base 128,
+       * and zigzag maps small negative deltas to small numbers.
+       *
+       * Memory written by syscalls is not traced.
+       */
+
+      constexpr char TRACE_MAGIC[4] = { 'M', 'T', 'R', 'C' };
+      constexpr byte_t TRACE_VERSION = 1;
+
+      /** Record flags */
+      constexpr byte_t TRACE_JUMP = 0x01;       /** Not the instruction after the previous one */
+      constexpr byte_t TRACE_REGISTER = 0x02;   /** Wrote a general purpose register */
+      constexpr byte_t TRACE_HILO = 0x04;       /** Wrote HI and LO */
+      constexpr byte_t TRACE_LOAD = 0x08;
+      constexpr byte_t TRACE_STORE = 0x10;
+      constexpr byte_t TRACE_SIZE = 0x60;       /** log2 of the access size */
+      constexpr byte_t TRACE_SIZE_SHIFT = 5;
+
+      /** Bytes of records staged before they are handed to the writer thread */
+      constexpr size_t TRACE_CHUNK = 64 * 1024;
+
+      /** Capacity of the ring between the recorder and the writer thread */
+      constexpr size_t TRACE_RING_SIZE = 16 * 1024 * 1024;
+
+      /** Longest record: flags, jump, register, HI/LO, address and value */
+      constexpr size_t TRACE_MAX_RECORD = 1 + 5 + 6 + 10 + 5 + 5;
+
+      /**
+       * @brief Lock-free single producer, single consumer byte ring
+       *
+       * @details head counts the bytes ever pushed and tail the bytes ever
+       *          popped; each is written by one side only and published
+       *          with release / acquire ordering.
+       */
+      class TraceRing
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] capacity The capacity in bytes (a power of two)
+             */
+            TraceRing(size_t capacity) : buffer(capacity) {}
+
+            /**
+             * @brief Copies as many bytes as fit into the ring (producer)
+             *
+             * @param[i] data The bytes
+             * @param[i] size The number of bytes
+             * @return The number of bytes copied
+             */
+            size_t push(const byte_t* data, size_t size);
+
+            /**
+             * @brief Copies as many bytes as are available out of the ring (consumer)
+             *
+             * @param[o] data The destination
+             * @param[i] size The room in the destination
+             * @return The number of bytes copied
+             */
+            size_t pop(byte_t* data, size_t size);
+
+      private:
+            std::vector<byte_t> buffer;
+            alignas(64) std::atomic<uint64_t> head { 0 };
+            alignas(64) std::atomic<uint64_t> tail { 0 };
+      };
+
+      /**
+       * @brief Writes bytes to a file from a background thread
+       *
+       * @details write() blocks only while the ring is full.
+       */
+      class TraceWriter
+      {
+      public:
+            /**
+             * @brief Opens the file and starts the writer thread
+             *
+             * @param[i] filename The file
+             * @throw mips::FileException If the file can not be opened
+             */
+            TraceWriter(const std::string& filename);
+
+            /** @brief Drains the ring and stops the thread, if close() was not called */
+            ~TraceWriter();
+
+            /**
+             * @brief Hands bytes to the writer thread
+             *
+             * @param[i] data The bytes
+             * @param[i] size The number of bytes
+             */
+            void write(const byte_t* data, size_t size);
+
+            /**
+             * @brief Drains the ring, stops the thread and closes the file
+             *
+             * @throw mips::FileException If writing the file failed
+             */
+            void close();
+
+      private:
+            /** @brief Writer thread: moves the ring to the file until closed */
+            void drain();
+
+            std::ofstream file;
+            TraceRing ring;
+            std::atomic<bool> done { false };
+            std::thread thread;
+      };
+
+      /**
+       * @brief Execution trace recorder
+       *
+       * @details Used as the inspector of CPU::run_inspected(). The inspector
+       *          runs before an instruction executes, so the record of an
+       *          instruction is completed when the next one arrives (or by
+       *          finish()), once its register write is visible. Records are
+       *          staged in a chunk that goes to the writer as a whole.
+       */
+      class TraceRecorder
+      {
+      public:
+            /**
+             * @brief Constructor
+             *
+             * @param[i] filename The trace file
+             * @throw mips::FileException If the file can not be opened
+             */
+            TraceRecorder(const std::string& filename);
+
+            /**
+             * @brief Records the previous instruction and stages this one
+             *
+             * @param[i] cpu The CPU, before the instruction executes
+             * @param[i] decoded The instruction
+             */
+            void operator()(const CPU& cpu, const DecodedInstruction& decoded) {
+                  if (pending) record(cpu);
+
+                  const Effects& effects = operations[static_cast<size_t>(decoded.op)];
+                  flags = effects.flags;
+                  if (decoded.pc != next_pc) flags |= TRACE_JUMP;
+                  pc = decoded.pc;
+                  destination = effects.destination == Field::Rd ? decoded.rd
+                              : effects.destination == Field::Rt ? decoded.rt
+                              : effects.register_number;
+                  if (destination == 0) flags &= ~TRACE_REGISTER;
+                  if (flags & (TRACE_LOAD | TRACE_STORE)) {
+                        address = cpu.get_register(decoded.rs) + decoded.immediate;
+                        value = cpu.get_register(decoded.rt) & effects.value_mask;
+                  }
+                  pending = true;
+            }
+
+            /**
+             * @brief Records the last instruction, unless it faulted, and
+             *        closes the trace
+             *
+             * @param[i] cpu The CPU after the run
+             * @throw mips::FileException If writing the trace failed
+             */
+            void finish(const CPU& cpu);
+
+            /** @brief Returns the number of instructions recorded */
+            uint64_t get_records() const { return records; }
+
+            /** @brief Returns the size of the trace in bytes */
+            uint64_t get_bytes() const { return bytes; }
+
+      private:
+            /** Where an operation's destination register comes from */
+            enum class Field : byte_t { None, Rd, Rt, Fixed };
+
+            /** What an operation changes */
+            struct Effects {
+                  byte_t flags;                 /** TRACE_REGISTER, TRACE_HILO, TRACE_LOAD, TRACE_STORE and TRACE_SIZE */
+                  Field destination;
+                  byte_t register_number;       /** The destination if Fixed */
+                  word_t value_mask;            /** The bytes a store writes */
+            };
+
+            /**
+             * @brief Appends the staged instruction to the chunk
+             *
+             * @param[i] cpu The CPU after the instruction executed
+             */
+            void record(const CPU& cpu) {
+                  byte_t* start = cursor;
+                  *cursor++ = flags;
+                  if (flags & TRACE_JUMP) put(pc - next_pc);
+                  if (flags & TRACE_REGISTER) {
+                        const register_t written = cpu.get_register(destination);
+                        *cursor++ = destination;
+                        put(written - registers[destination]);
+                        registers[destination] = written;
+                  }
+                  if (flags & TRACE_HILO) {
+                        put(cpu.get_hi() - hi);
+                        put(cpu.get_lo() - lo);
+                        hi = cpu.get_hi();
+                        lo = cpu.get_lo();
+                  }
+                  if (flags & (TRACE_LOAD | TRACE_STORE)) {
+                        put(address - last_address);
+                        last_address = address;
+                  }
+                  if (flags & TRACE_STORE) put_varint(value);
+
+                  next_pc = pc + sizeof(instruction_t);
+                  records++;
+                  bytes += cursor - start;
+                  pending = false;
+                  if (cursor > chunk.data() + TRACE_CHUNK - TRACE_MAX_RECORD) flush();
+            }
+
+            /** @brief Appends a delta, zigzag encoded */
+            void put(word_t delta) {
+                  const int32_t signed_delta = static_cast<int32_t>(delta);
+                  put_varint((static_cast<word_t>(signed_delta) << 1) ^ static_cast<word_t>(signed_delta >> 31));
+            }
+
+            /** @brief Appends a varint */
+            void put_varint(word_t number) {
+                  while (number >= 0x80) {
+                        *cursor++ = static_cast<byte_t>(number) | 0x80;
+                        number >>= 7;
+                  }
+                  *cursor++ = static_cast<byte_t>(number);
+            }
+
+            /** @brief Hands the chunk to the writer */
+            void flush();
+
+            TraceWriter writer;
+            std::array<Effects, static_cast<size_t>(Operation::Count)> operations;
+            std::array<byte_t, TRACE_CHUNK> chunk;
+            byte_t* cursor;
+
+            /** The staged instruction */
+            bool pending = false;
+            byte_t flags = 0;
+            address_t pc = 0;
+            byte_t destination = 0;
+            address_t address = 0;
+            word_t value = 0;
+
+            /** Values the deltas are relative to */
+            address_t next_pc = 0;
+            std::array<register_t, 32> registers {};
+            register_t hi = 0;
+            register_t lo = 0;
+            address_t last_address = 0;
+
+            uint64_t records = 0;
+            uint64_t bytes = 0;
+      };
+
+      /** A decoded trace record */
+      struct TraceRecord {
+            byte_t flags;
+            address_t pc;
+            byte_t reg;             /** With TRACE_REGISTER */
+            register_t value;       /** Value written to reg */
+            register_t hi;          /** With TRACE_HILO */
+            register_t lo;
+            address_t address;      /** With TRACE_LOAD or TRACE_STORE */
+            word_t size;            /** Access size in bytes */
+            word_t stored;          /** With TRACE_STORE */
+      };
+
+      /**
+       * @brief Reads a trace written by TraceRecorder
+       */
+      class TraceReader
+      {
+      public:
+            /**
+             * @brief Opens a trace
+             *
+             * @param[i] filename The file
+             * @throw mips::FileException If the file can not be opened or is not a trace
+             */
+            TraceReader(const std::string& filename);
+
+            /**
+             * @brief Reads the next record
+             *
+             * @param[o] record The record
+             * @return false at the end of the trace
+             * @throw mips::FileException If the trace is truncated
+             */
+            bool next(TraceRecord& record);
+
+      private:
+            /** @brief Reads a varint */
+            word_t get_varint();
+
+            /** @brief Reads a zigzag encoded delta */
+            word_t get_delta();
+
+            std::ifstream file;
+            address_t next_pc = 0;
+            std::array<register_t, 32> registers {};
+            register_t hi = 0;
+            register_t lo = 0;
+            address_t last_address = 0;
+      };
+
+      /**
+       * @brief Writes a trace as text, one retired instruction per line
+       *
+       * @param[i] filename The trace
+       * @param[o] output The stream
+       * @throw mips::FileException If the trace can not be read
+       */
+      void dump_trace(const std::string& filename, std::ostream& output);
+} // namespace mips
+
+#endif // MIPS_TRACE_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
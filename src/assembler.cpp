@@ -3,19 +3,18 @@
 //
 
 /** C++ Includes */
-#include <fstream>
+#include <algorithm>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
-#include <cassert>
-#include <algorithm>
 #include <array>
-#include <map>
+#include <thread>
 
 /** MIPS Includes */
 #include <assembler.hpp> 
+#include <batch.hpp>
 #include <instruction.hpp>
 #include <common.hpp>
+#include <hash.hpp>
 #include <obj.hpp>
 #include <except.hpp>
 
@@ -25,20 +24,12 @@
  * @brief Throw syntax error if the number of arguments is not the expected
  *        number of arguments for the given instruction.
  */
-#define ASSERT_ARG_COUNT(count, line, instruction) if (tokens.size() != count) \
-      throw mips::SyntaxException("Invalid number of arguments in line " + std::to_string(line) + " for instruction '" + instruction + \
-      "' (expected " + std::to_string(count) + ", got " + std::to_string(tokens.size()) + ")");
+#define ASSERT_ARG_COUNT(count, line, instruction) if (this->operands.size() != count) \
+      throw mips::SyntaxException("Invalid number of arguments in line " + std::to_string(line) + " for instruction '" + std::string(instruction) + \
+      "' (expected " + std::to_string(count) + ", got " + std::to_string(this->operands.size()) + ")");
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
-#define SHOW_FIRST_PASS_BANNER()  std::cout << "===============================" << std::endl; \
-                                  std::cout << "          First pass           " << std::endl; \
-                                  std::cout << "===============================" << std::endl;
-
-#define SHOW_SECOND_PASS_BANNER() std::cout << "===============================" << std::endl; \
-                                  std::cout << "          Second pass          " << std::endl; \
-                                  std::cout << "===============================" << std::endl;
-
 #define SHOW_LABELS_BANNER()      std::cout << "===============================" << std::endl; \
                                   std::cout << "            Labels             " << std::endl; \
                                   std::cout << "===============================" << std::endl;
@@ -46,305 +37,680 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #define SHOW_LABELS() \
-      for (auto label : this->labels) { \
-            std::cout << label.name << " -> " << label.address << std::endl; \
+      for (auto symbol : this->symbols) { \
+            std::cout << symbol.first << " -> " << symbol.second.address << std::endl; \
       }
 
-#define SHOW_TOKENS() \
-      std::cout << "Tokens: " << std::endl; \
-      std::cout << "Line " << i << ": ["; \
-      for (auto token : tokens) { \
-            if (token == tokens.back()) std::cout << token; \
-            else std::cout << token << ", "; \
-      } \
-      std::cout << "]" << std::endl;
-
-#define SHOW_CURRENT_LINE() std::cout << "Line " << i << ": " << line << std::endl;
-#define SHOW_R_TYPE_INSTRUCTION() std::cout << "R-Type Instruction: " << tokens[0] << " " << tokens[1] << " " << tokens[2] << " " << tokens[3] << std::endl;
-#define SHOW_I_TYPE_INSTRUCTION() std::cout << "I-Type Instruction: " << tokens[0] << " " << tokens[1] << " " << tokens[2] << " " << tokens[3] << std::endl;
-#define SHOW_J_TYPE_INSTRUCTION() std::cout << "J-Type Instruction: " << tokens[0] << " " << tokens[1] << std::endl;
-
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /** Constants */
 constexpr int MAX_IMMEDIATE = 32767;
 constexpr int MIN_IMMEDIATE = -32768;
+constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;   /** Smallest source slice worth a thread */
 
-/** Opcode mappings */
-static std::map<std::string, mips::byte_t> r_opcode_map = {
-      {"add", 0x20}, {"addu", 0x21}, {"and", 0x24}, {"break", 0x0D},
-      {"div", 0x1A}, {"divu", 0x1B}, {"jalr", 0x09}, {"jr", 0x08},
-      {"mfhi", 0x10}, {"mflo", 0x12}, {"mthi", 0x11}, {"mtlo", 0x13},
-      {"mult", 0x18}, {"multu", 0x19}, {"nor", 0x27}, {"or", 0x25},
-      {"sll", 0x00}, {"sllv", 0x04}, {"slt", 0x2A}, {"sltu", 0x2B},
-      {"sra", 0x03}, {"srav", 0x07}, {"srl", 0x02}, {"srlv", 0x06},
-      {"sub", 0x22}, {"subu", 0x23}, {"syscall", 0x0C}, {"xor", 0x26}
-};
+/** Mnemonic lookup */
+static constexpr mips::PerfectHash<mips::INSTRUCTIONS.size()> mnemonic_hash(mips::INSTRUCTIONS);
 
-static std::map<std::string, mips::byte_t> i_opcode_map = {
-      {"addi", 0x08}, {"addiu", 0x09}, {"andi", 0x0C}, {"beq", 0x04},
-      {"bgez", 0x01}, {"bgezal", 0x01}, {"bgtz", 0x07}, {"blez", 0x06},
-      {"bltz", 0x01}, {"bltzal", 0x01}, {"bne", 0x05}, {"lb", 0x20},
-      {"lbu", 0x24}, {"lh", 0x21}, {"lhu", 0x25}, {"lui", 0x0F},
-      {"lw", 0x23}, {"lwc1", 0x31}, {"ori", 0x0D}, {"sb", 0x28},
-      {"sh", 0x29}, {"slti", 0x0A}, {"sltiu", 0x0B}, {"sw", 0x2B},
-      {"swc1", 0x39}, {"xori", 0x0E}
-};
+/** Directives */
+enum class Directive : mips::byte_t { Text, Data, Word, Half, Byte, Ascii, Asciiz, Space, Align };
 
-static std::map<std::string, mips::byte_t> j_opcode_map = {
-      {"j", 0x02},
-      {"jal", 0x03}
+static constexpr std::array<std::string_view, 9> directives = {
+      ".text", ".data", ".word", ".half", ".byte", ".ascii", ".asciiz", ".space", ".align"
 };
 
+static constexpr mips::PerfectHash<directives.size()> directive_hash(directives);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Checks if a given instruction is a R-type instruction
+ * @brief Returns the alignment of the data a directive emits
  * 
- * @param[i] instruction
- * @return true/false
+ * @param[i] directive 
+ * @return size_t 
  */
-static inline bool is_r_type_instruction(std::string instruction) {
-      return r_opcode_map.find(instruction) != r_opcode_map.end();
+static size_t directive_alignment(Directive directive) {
+      if (directive == Directive::Word) return 4;
+      if (directive == Directive::Half) return 2;
+      return 1;
 }
 
 /**
- * @brief Checks if a given instruction is a I-type instruction
+ * @brief Checks whether a line holds an instruction or directive
  * 
- * @param[i] instruction
- * @return true/false
+ * @param[i] line 
+ * @return bool 
  */
-static inline bool is_i_type_instruction(std::string instruction) {
-      return i_opcode_map.find(instruction) != i_opcode_map.end();
+static bool has_statement(std::string_view line) {
+      mips::Lexer lexer(line);
+      mips::Token token = lexer.next();
+      while (token.kind == mips::TokenKind::Label) token = lexer.next();
+      return token.kind != mips::TokenKind::EndOfLine && token.kind != mips::TokenKind::EndOfFile;
 }
 
+/** Conventional register names, by number ($fp is also $s8) */
+static constexpr std::array<std::string_view, 32> register_names = {
+      "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+      "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+      "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+      "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
 /**
- * @brief Checks if a given instruction is a J-type instruction
+ * @brief Parses a register operand
  * 
- * @param[i] instruction
- * @return true/false
+ * @param[i] operand 
+ * @param[i] line 
+ * @return mips::byte_t 
+ * @throw mips::SyntaxException If the operand is not a valid register
  */
-static inline bool is_j_type_instruction(std::string instruction) {
-      return j_opcode_map.find(instruction) != j_opcode_map.end();
+static mips::byte_t parse_register(const mips::Token& operand, size_t line) {
+      std::string_view name = operand.text.substr(1);
+      int64_t number = 0;
+
+      if (operand.kind == mips::TokenKind::Register && !name.empty()) {
+            if (name[0] >= '0' && name[0] <= '9') {
+                  if (mips::parse_integer(name, number) && number < 32) return number;
+            }
+            else {
+                  for (size_t i = 0; i < register_names.size(); i++) {
+                        if (register_names[i] == name) return i;
+                  }
+                  if (name == "s8") return 30;
+            }
+      }
+      throw mips::SyntaxException("Invalid register '" + std::string(operand.text) + "' in line " + std::to_string(line));
 }
 
 /**
- * @brief Checks if a given line contains a label
+ * @brief Parses a numeric operand
  * 
- * @param[i] instruction
- * @return true/false
+ * @param[i] operand 
+ * @param[i] line 
+ * @param[i] min The smallest accepted value
+ * @param[i] max The largest accepted value
+ * @return int64_t 
+ * @throw mips::SyntaxException If the operand is not a number in range
  */
-static inline bool is_label(std::string line) {
-      return line.find(":") != std::string::npos;
+static int64_t parse_number(const mips::Token& operand, size_t line, int64_t min, int64_t max) {
+      int64_t value = 0;
+      if (operand.kind != mips::TokenKind::Number || !mips::parse_integer(operand.text, value) || value < min || value > max) {
+            throw mips::SyntaxException("Invalid number '" + std::string(operand.text) + "' in line " + std::to_string(line));
+      }
+      return value;
 }
 
 /**
- * @brief Checks if a given line is a comment
+ * @brief Appends a string literal to a buffer
+ * 
+ * @details Supports the \n, \t, \0, \\ and \" escapes.
  * 
- * @param[i] instruction
- * @return true/false
+ * @param[i] operand The literal, quotes included
+ * @param[i] line 
+ * @param[o] bytes 
+ * @throw mips::SyntaxException If the operand is not a string literal
  */
-static inline bool is_comment(std::string line) {
-      return line.find("#") != std::string::npos;
+static void append_string(const mips::Token& operand, size_t line, std::vector<mips::byte_t>& bytes) {
+      if (operand.kind != mips::TokenKind::String) {
+            throw mips::SyntaxException("Invalid string literal in line " + std::to_string(line));
+      }
+
+      std::string_view text = operand.text.substr(1, operand.text.size() - 2);
+      for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size()) {
+                  switch (text[++i]) {
+                        case 'n': c = '\n'; break;
+                        case 't': c = '\t'; break;
+                        case '0': c = '\0'; break;
+                        default:  c = text[i]; break;
+                  }
+            }
+            bytes.push_back(c);
+      }
 }
 
 /**
- * @brief Checks if a given line is empty
+ * @brief Appends an instruction to the binary
  * 
- * @param[i] line 
- * @return true/false
+ * @details This function appends an instruction to the binary in big endian
+ * 
+ * @param instruction 
+ * @param binary 
+ */
+static void append_instruction(mips::instruction_t instruction, std::vector<mips::byte_t> &binary) {
+      /** Shift the instruction to the right to get the most significant byte */
+      binary.push_back(instruction >> 24);
+      binary.push_back(instruction >> 16);
+      binary.push_back(instruction >> 8);
+      binary.push_back(instruction);
+}
+
+/**
+ * @brief Writes a big endian word into a buffer
+ * 
+ * @param[i] value 
+ * @param[o] bytes 
  */
-static inline bool is_empty_line(std::string line) {
-      return line == "" || line == "\n";
+static void store_word(mips::word_t value, mips::byte_t* bytes) {
+      bytes[0] = value >> 24;
+      bytes[1] = value >> 16;
+      bytes[2] = value >> 8;
+      bytes[3] = value;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * @brief Checks if the given register is valid
+ * @brief Finds the segment the chunk leaves selected
  * 
- * @param[i] reg 
- * @return true/false
+ * @return std::optional<mips::Segment> 
  */
-static inline bool is_valid_register(std::string reg) {
-      return reg[0] == '$' && reg.size() == 3 && reg[1] == 't' && reg[2] >= '0' && reg[2] <= '9';
+std::optional<mips::Segment> mips::Chunk::scan_segment() const {
+      Lexer lexer(this->source, this->first_line);
+      std::optional<Segment> segment;
+      bool statement = true;
+
+      for (Token token = lexer.next(); token.kind != TokenKind::EndOfFile; token = lexer.next()) {
+            if (statement && token.kind == TokenKind::Directive) {
+                  if (token.text == ".text") segment = Segment::Text;
+                  else if (token.text == ".data") segment = Segment::Data;
+            }
+            statement = token.kind == TokenKind::EndOfLine || token.kind == TokenKind::Label;
+      }
+      return segment;
 }
 
 /**
- * @brief Checks if a given immediate value is valid
+ * @brief Assembles the chunk
  * 
- * @param[i] immediate 
- * @return true/false
+ * @param[i] start 
+ * @param[i] text_base 
+ * @param[i] data_base 
  */
-static inline bool is_valid_immediate(std::string immediate) {
-      if (immediate[0] == '-') {
-            immediate = immediate.substr(1);
+void mips::Chunk::assemble(Segment start, address_t text_base, address_t data_base) {
+      this->start = start;
+      this->segment = start;
+      this->base = { text_base, data_base };
+      this->alignment = { 1, 1 };
+      for (std::vector<byte_t>& bytes : this->bytes) bytes.clear();
+      this->labels.clear();
+      this->fixups.clear();
+      this->lines.clear();
+      this->error = nullptr;
+
+      /** About four bytes of code per line of source, a label or reference every few lines */
+      this->bytes[size_t(Segment::Text)].reserve(this->source.size() / 4);
+      this->labels.reserve(this->source.size() / 64);
+      this->fixups.reserve(this->source.size() / 32);
+      this->lines.reserve(this->source.size() / 16);
+
+      try {
+            this->parse();
       }
-      for (size_t i = 0; i < immediate.size(); i++) {
-            if (immediate[i] < '0' || immediate[i] > '9') return false;
+      catch (const SyntaxException&) {
+            this->error = std::current_exception();
       }
-      int imm = std::stoi(immediate);
-      return imm >= MIN_IMMEDIATE && imm <= MAX_IMMEDIATE;
 }
 
 /**
- * @brief Checks if the given address is valid
+ * @brief Pads the current segment to an alignment
  * 
- * @param address 
- * @return true/false
+ * @param[i] alignment 
  */
-static inline bool is_valid_address(std::string address) {
-      for (size_t i = 0; i < address.size(); i++) {
-            if (address[i] < '0' || address[i] > '9') return false;
-      }
-      return true;
+void mips::Chunk::align(size_t alignment) {
+      size_t& required = this->alignment[size_t(this->segment)];
+      if (alignment > required) required = alignment;
+
+      std::vector<byte_t>& bytes = this->current();
+      while (this->here() % alignment != 0) bytes.push_back(0);
 }
 
-/** 
- * @brief Trims a string
- * @details Removes leading and trailing spaces from a string
+/**
+ * @brief Records a label at the current address
  * 
- * @param[i/o] line 
+ * @param[i] name 
  */
-static void trim(std::string &str) {
-      str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](int ch) {
-            return !std::isspace(ch);
-      }));
-      str.erase(std::find_if(str.rbegin(), str.rend(), [](int ch) {
-            return !std::isspace(ch);
-      }).base(), str.end());
+void mips::Chunk::define_label(std::string_view name) {
+      this->labels.push_back({ name, Symbol{ this->here(), this->segment, this->line } });
 }
 
-/** 
- * @brief Tokenizes a string 
+/**
+ * @brief Records a reference to a symbol at the current address
  * 
- * @param[i] line
- * @return std::vector<std::string>
+ * @param[i] kind 
+ * @param[i] symbol 
+ */
+void mips::Chunk::add_fixup(FixupKind kind, std::string_view symbol) {
+      this->fixups.push_back({ kind, this->segment, static_cast<word_t>(this->current().size()), this->line, symbol });
+}
+
+/**
+ * @brief Reads the operands of a statement up to the end of the line
  * 
- * @example "add $t0, $t1, $t2" -> ["add", "$t0", "$t1", "$t2"]
+ * @param[io] lexer 
  */
-static std::vector<std::string> tokenize(std::string line) {
-      std::vector<std::string> tokens;
-      std::string token;
-      std::istringstream token_stream(line);
-
-      std::getline(token_stream, token, ' ');
-      trim(token);
-      tokens.push_back(token);
-
-      while (std::getline(token_stream, token, ',')) {
-            trim(token);
-            tokens.push_back(token);
+void mips::Chunk::read_operands(Lexer& lexer) {
+      this->operands.clear();
+
+      bool separated = true;
+      for (Token token = lexer.next(); token.kind != TokenKind::EndOfLine && token.kind != TokenKind::EndOfFile; token = lexer.next()) {
+            if (token.kind == TokenKind::Comma && !separated) {
+                  separated = true;
+            }
+            else if (token.kind == TokenKind::LeftParen) {
+                  /** A memory operand, offset($base) or ($base), is kept as ( $base ) after its offset */
+                  Token base = lexer.next();
+                  Token close = lexer.next();
+                  if (base.kind != TokenKind::Register || close.kind != TokenKind::RightParen) {
+                        throw SyntaxException("Invalid memory operand in line " + std::to_string(this->line));
+                  }
+                  this->operands.insert(this->operands.end(), { token, base, close });
+                  separated = false;
+            }
+            else if (token.kind != TokenKind::Comma && separated) {
+                  this->operands.push_back(token);
+                  separated = false;
+            }
+            else {
+                  throw SyntaxException("Unexpected '" + std::string(token.text) + "' in line " + std::to_string(this->line));
+            }
       }
 
-      return tokens;
+      if (separated && !this->operands.empty()) {
+            throw SyntaxException("Missing operand after ',' in line " + std::to_string(this->line));
+      }
 }
 
 /**
- * @brief Assembles a R-type instruction from the given tokens
- * 
- * @param instruction 
- * @param rd 
- * @param rs 
- * @param rt 
- * @return mips::instruction_t 
+ * @brief Assembles the source up to the first error
  */
-static mips::instruction_t assemble_r_type_instruction(std::string instruction, std::string rd, std::string rs, std::string rt) {
-      mips::byte_t opcode = r_opcode_map[instruction];
-      mips::byte_t funct = 0x0;
-      mips::byte_t rd_reg = std::stoi(rd.substr(2));
-      mips::byte_t rs_reg = std::stoi(rs.substr(2));
-      mips::byte_t rt_reg = std::stoi(rt.substr(2));
-      return mips::create_r_instruction(opcode, rs_reg, rt_reg, rd_reg, 0x0, funct);
+void mips::Chunk::parse() {
+      Lexer lexer(this->source, this->first_line);
+      std::vector<std::string_view> labels;
+
+      for (Token token = lexer.next(); token.kind != TokenKind::EndOfFile; token = lexer.next()) {
+            if (token.kind == TokenKind::EndOfLine) continue;
+            this->line = lexer.get_line();
+
+            /** Labels may share the line with an instruction or directive, or stay pending until the next one */
+            while (token.kind == TokenKind::Label) {
+                  labels.push_back(token.text);
+                  token = lexer.next();
+            }
+
+            if (token.kind == TokenKind::Directive) {
+                  size_t index = directive_hash.find(token.text);
+                  if (index == directive_hash.NOT_FOUND) {
+                        throw SyntaxException("Unknown directive '" + std::string(token.text) + "' in line " + std::to_string(this->line));
+                  }
+
+                  /** Labels point past the padding of aligned data */
+                  this->align(directive_alignment(Directive(index)));
+                  for (std::string_view label : labels) this->define_label(label);
+                  labels.clear();
+
+                  this->read_operands(lexer);
+                  this->assemble_directive(token.text);
+            }
+            else if (token.kind == TokenKind::Identifier) {
+                  for (std::string_view label : labels) this->define_label(label);
+                  labels.clear();
+
+                  this->read_operands(lexer);
+                  this->assemble_instruction(token.text);
+            }
+            else if (token.kind == TokenKind::EndOfFile) {
+                  break;
+            }
+            else if (token.kind != TokenKind::EndOfLine) {
+                  throw SyntaxException("Unexpected '" + std::string(token.text) + "' in line " + std::to_string(this->line));
+            }
+      }
+
+      /** Labels at the end of the source point past the last statement */
+      for (std::string_view label : labels) this->define_label(label);
 }
 
 /**
- * @brief Assembles a I-type instruction from the given tokens
+ * @brief Assembles one instruction
  * 
- * @param instruction 
- * @param rt 
- * @param rs 
- * @param immediate 
- * @return mips::instruction_t 
+ * @details The operands are read as described by the instruction's syntax
+ *          in mips::INSTRUCTIONS and encoded with its opcode and funct.
+ * 
+ * @param[i] name 
  */
-static mips::instruction_t assemble_i_type_instruction(std::string instruction, std::string rt, std::string rs, std::string immediate) {
-      mips::byte_t opcode = i_opcode_map[instruction];
-      mips::byte_t rt_reg = std::stoi(rt.substr(2));
-      mips::byte_t rs_reg = std::stoi(rs.substr(2));
-      mips::word_t imm = std::stoi(immediate);
-      return mips::create_i_instruction(opcode, rs_reg, rt_reg, imm);
+void mips::Chunk::assemble_instruction(std::string_view name) {
+      size_t index = mnemonic_hash.find(name);
+      if (index == mnemonic_hash.NOT_FOUND) {
+            throw SyntaxException("Unknown instruction '" + std::string(name) + "' in line " + std::to_string(this->line));
+      }
+      if (this->segment != Segment::Text) {
+            throw SyntaxException("Instruction '" + std::string(name) + "' outside of the text segment in line " + std::to_string(this->line));
+      }
+
+      const InstructionInfo& info = INSTRUCTIONS[index];
+      const size_t line = this->line;
+      byte_t rs = 0, rt = 0, rd = 0, shamt = 0;
+      word_t immediate = 0;
+
+      auto reg = [&](size_t operand) { return parse_register(this->operands[operand], line); };
+      auto constant = [&](size_t operand) -> word_t {
+            int64_t min = info.zero_extend ? 0 : MIN_IMMEDIATE;
+            int64_t max = info.zero_extend ? IMMEDIATE_MASK : MAX_IMMEDIATE;
+            return parse_number(this->operands[operand], line, min, max) & IMMEDIATE_MASK;
+      };
+      auto branch = [&](size_t operand) -> word_t {
+            const Token& target = this->operands[operand];
+            if (target.kind == TokenKind::Identifier) {
+                  this->add_fixup(FixupKind::Branch, target.text);
+                  return 0;
+            }
+            return parse_number(target, line, MIN_IMMEDIATE, MAX_IMMEDIATE) & IMMEDIATE_MASK;
+      };
+
+      switch (info.syntax) {
+            case Syntax::None:
+                  ASSERT_ARG_COUNT(0, line, name);
+                  break;
+            case Syntax::RdRsRt:
+                  ASSERT_ARG_COUNT(3, line, name);
+                  rd = reg(0); rs = reg(1); rt = reg(2);
+                  break;
+            case Syntax::RdRtShamt:
+                  ASSERT_ARG_COUNT(3, line, name);
+                  rd = reg(0); rt = reg(1);
+                  shamt = parse_number(this->operands[2], line, 0, 31);
+                  break;
+            case Syntax::RdRtRs:
+                  ASSERT_ARG_COUNT(3, line, name);
+                  rd = reg(0); rt = reg(1); rs = reg(2);
+                  break;
+            case Syntax::RsRt:
+                  ASSERT_ARG_COUNT(2, line, name);
+                  rs = reg(0); rt = reg(1);
+                  break;
+            case Syntax::Rs:
+                  ASSERT_ARG_COUNT(1, line, name);
+                  rs = reg(0);
+                  break;
+            case Syntax::Rd:
+                  ASSERT_ARG_COUNT(1, line, name);
+                  rd = reg(0);
+                  break;
+            case Syntax::RdRs:
+                  ASSERT_ARG_COUNT(2, line, name);
+                  rd = reg(0); rs = reg(1);
+                  break;
+            case Syntax::RtRsImmediate:
+                  ASSERT_ARG_COUNT(3, line, name);
+                  rt = reg(0); rs = reg(1); immediate = constant(2);
+                  break;
+            case Syntax::RtImmediate:
+                  ASSERT_ARG_COUNT(2, line, name);
+                  rt = reg(0); immediate = constant(1);
+                  break;
+            case Syntax::RtOffsetRs: {
+                  /** $rt, offset ( $base ) or $rt, ( $base ) */
+                  size_t count = this->operands.size();
+                  if ((count != 4 && count != 5) || this->operands[count - 3].kind != TokenKind::LeftParen) {
+                        throw SyntaxException("Invalid memory operand in line " + std::to_string(line) + " for instruction '" + std::string(name) + "'");
+                  }
+                  rt = reg(0); rs = reg(count - 2);
+                  if (count == 5) immediate = constant(1);
+                  break;
+            }
+            case Syntax::RsRtLabel:
+                  ASSERT_ARG_COUNT(3, line, name);
+                  rs = reg(0); rt = reg(1); immediate = branch(2);
+                  break;
+            case Syntax::RsLabel:
+                  ASSERT_ARG_COUNT(2, line, name);
+                  rs = reg(0); immediate = branch(1);
+                  break;
+            case Syntax::Target: {
+                  ASSERT_ARG_COUNT(1, line, name);
+                  const Token& target = this->operands[0];
+                  if (target.kind == TokenKind::Identifier) this->add_fixup(FixupKind::Jump, target.text);
+                  else immediate = (parse_number(target, line, 0, UINT32_MAX) >> 2) & ADDRESS_MASK;
+                  break;
+            }
+      }
+
+      instruction_t instruction = 0;
+      switch (info.type) {
+            case InstructionType::R:
+                  instruction = create_r_instruction(R_TYPE, rs, rt, rd, shamt, info.funct);
+                  break;
+            case InstructionType::I:
+                  /** REGIMM branches select the condition with the rt field */
+                  if (info.opcode == REGIMM) rt = info.funct;
+                  instruction = create_i_instruction(info.opcode, rs, rt, immediate);
+                  break;
+            case InstructionType::J:
+                  instruction = create_j_instruction(info.opcode, immediate);
+                  break;
+      }
+
+      this->lines.emplace_back(static_cast<word_t>(this->current().size()), line);
+      append_instruction(instruction, this->current());
 }
 
 /**
- * @brief Assembles a J-type instruction from the given tokens
+ * @brief Assembles one directive
  * 
- * @param instruction 
- * @param address 
- * @return mips::instruction_t 
+ * @details Supports .text, .data, .word, .half, .byte, .ascii, .asciiz,
+ *          .space and .align. Words and halves are aligned to their size.
+ * 
+ * @param[i] name 
  */
-static mips::instruction_t assemble_j_type_instruction(std::string instruction, std::string address) {
-      mips::byte_t opcode = j_opcode_map[instruction];
-      mips::word_t addr = std::stoi(address);
-      return mips::create_j_instruction(opcode, addr);
+void mips::Chunk::assemble_directive(std::string_view name) {
+      Directive directive = Directive(directive_hash.find(name));
+      std::vector<byte_t>& bytes = this->current();
+      auto expect_operands = [&](size_t count) {
+            if (this->operands.size() != count) {
+                  throw SyntaxException("Invalid number of arguments in line " + std::to_string(this->line) + " for directive '" + std::string(name) + "'");
+            }
+      };
+
+      switch (directive) {
+            case Directive::Text:
+                  expect_operands(0);
+                  this->segment = Segment::Text;
+                  break;
+            case Directive::Data:
+                  expect_operands(0);
+                  this->segment = Segment::Data;
+                  break;
+            case Directive::Word:
+                  for (const Token& operand : this->operands) {
+                        word_t word = 0;
+                        if (operand.kind == TokenKind::Identifier) this->add_fixup(FixupKind::Word, operand.text);
+                        else word = parse_number(operand, this->line, INT32_MIN, UINT32_MAX);
+
+                        bytes.resize(bytes.size() + 4);
+                        store_word(word, bytes.data() + bytes.size() - 4);
+                  }
+                  break;
+            case Directive::Half:
+                  for (const Token& operand : this->operands) {
+                        halfword_t half = parse_number(operand, this->line, INT16_MIN, UINT16_MAX);
+                        bytes.push_back(half >> 8);
+                        bytes.push_back(half);
+                  }
+                  break;
+            case Directive::Byte:
+                  for (const Token& operand : this->operands) {
+                        bytes.push_back(parse_number(operand, this->line, INT8_MIN, UINT8_MAX));
+                  }
+                  break;
+            case Directive::Ascii:
+            case Directive::Asciiz:
+                  expect_operands(1);
+                  append_string(this->operands[0], this->line, bytes);
+                  if (directive == Directive::Asciiz) bytes.push_back(0);
+                  break;
+            case Directive::Space:
+                  expect_operands(1);
+                  bytes.resize(bytes.size() + parse_number(this->operands[0], this->line, 0, UINT32_MAX));
+                  break;
+            case Directive::Align:
+                  expect_operands(1);
+                  this->align(size_t(1) << parse_number(this->operands[0], this->line, 0, PAGE_SHIFT));
+                  break;
+      }
 }
 
 /**
- * @brief Appends an instruction to the binary
- * 
- * @details This function appends an instruction to the binary in big endian
+ * @brief Patches the fixups of the chunk into the final segments
  * 
- * @param instruction 
- * @param binary 
+ * @param[i] symbols 
+ * @param[io] text 
+ * @param[io] data 
  */
-static void append_instruction(mips::instruction_t instruction, std::vector<mips::byte_t> &binary) {
-      /** Shift the instruction to the right to get the most significant byte */
-      binary.push_back(instruction >> 24);
-      binary.push_back(instruction >> 16);
-      binary.push_back(instruction >> 8);
-      binary.push_back(instruction);
+void mips::Chunk::backpatch(const std::unordered_map<std::string_view, Symbol>& symbols, std::vector<byte_t>& text, std::vector<byte_t>& data) {
+      for (const Fixup& fixup : this->fixups) {
+            auto symbol = symbols.find(fixup.symbol);
+            if (symbol == symbols.end()) {
+                  this->error = std::make_exception_ptr(SyntaxException("Undefined symbol '" + std::string(fixup.symbol) + "' in line " + std::to_string(fixup.line)));
+                  return;
+            }
+
+            address_t target = symbol->second.address;
+            byte_t* bytes = (fixup.segment == Segment::Text ? text : data).data() + fixup.offset;
+            word_t word = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+
+            switch (fixup.kind) {
+                  case FixupKind::Branch: {
+                        /** Offsets count words from the instruction after the branch */
+                        int64_t offset = (int64_t(target) - int64_t(TEXT_OFFSET + fixup.offset + 4)) / 4;
+                        if (offset < MIN_IMMEDIATE || offset > MAX_IMMEDIATE) {
+                              this->error = std::make_exception_ptr(SyntaxException("Branch to '" + std::string(fixup.symbol) + "' in line " + std::to_string(fixup.line) + " is out of range"));
+                              return;
+                        }
+                        word = (word & ~IMMEDIATE_MASK) | (offset & IMMEDIATE_MASK);
+                        break;
+                  }
+                  case FixupKind::Jump:
+                        word = (word & ~ADDRESS_MASK) | ((target >> 2) & ADDRESS_MASK);
+                        break;
+                  case FixupKind::Word:
+                        word = target;
+                        break;
+            }
+            store_word(word, bytes);
+      }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /** 
- * @brief Load the assembly file into memory
+ * @brief Maps the assembly file into memory
  * 
  * @param[i] filename
- * @throw std::runtime_error If the file is not found
  */
 void mips::Assembler::load_file(std::string filename) {
-      std::ifstream file(filename);
-      if (!file.is_open()) throw std::runtime_error("Could not open file");
+      this->file = std::make_unique<MappedFile>(filename);
+      this->source = this->file->contents();
+}
+
+/**
+ * @brief Splits the source into chunks at line boundaries
+ * 
+ * @param[i] workers 
+ */
+void mips::Assembler::split(size_t workers) {
+      size_t count = std::max<size_t>(1, std::min(workers, this->source.size() / MIN_CHUNK_SIZE));
+
+      this->chunks.clear();
+      size_t begin = 0;
+      size_t line = 1;
+      for (size_t i = 1; i <= count && begin < this->source.size(); i++) {
+            size_t end = this->source.size();
+            if (i < count) {
+                  end = this->source.find('\n', std::max(begin, this->source.size() / count * i));
+                  end = end == std::string_view::npos ? this->source.size() : end + 1;
+
+                  /** Labels bind to the next statement, so chunks end on one */
+                  size_t last = end >= 2 ? this->source.rfind('\n', end - 2) + 1 : 0;
+                  while (end < this->source.size() && !has_statement(this->source.substr(last, end - last))) {
+                        last = end;
+                        end = this->source.find('\n', end);
+                        end = end == std::string_view::npos ? this->source.size() : end + 1;
+                  }
+            }
 
-      std::string line;
-      while (std::getline(file, line)) {
-            this->file_contents.push_back(line);
+            std::string_view lines = this->source.substr(begin, end - begin);
+            this->chunks.emplace_back(lines, line);
+            line += std::count(lines.begin(), lines.end(), '\n');
+            begin = end;
       }
-      file.close();
+      if (this->chunks.empty()) this->chunks.emplace_back(this->source, 1);
 }
 
 /**
- * @brief Makes the first pass of the assembler
+ * @brief Runs a task for every chunk on the worker threads
+ * 
+ * @param[i] task 
  */
-void mips::Assembler::first_pass() {
-#if DEBUG
-      SHOW_FIRST_PASS_BANNER();
-#endif // DEBUG
+void mips::Assembler::for_each_chunk(const std::function<void(size_t)>& task) {
+      if (this->chunks.size() == 1) {
+            task(0);
+            return;
+      }
 
-      for (size_t i = 0; i < this->file_contents.size(); i++) {
-            std::string line = this->file_contents[i];
-            trim(line);
-#if DEBUG
-            SHOW_CURRENT_LINE();
-#endif // DEBUG
+      WorkStealingPool pool(this->chunks.size());
+      pool.run(this->chunks.size(), task);
+}
 
-            /** Ignore empty lines and comments */
-            if (is_empty_line(line)) continue;
-            if (is_comment(line)) continue;
+/**
+ * @brief Assembles the chunks and lays them out
+ */
+void mips::Assembler::parse() {
+      std::vector<Segment> starts(this->chunks.size(), Segment::Text);
+
+      /** Chunks are assembled in the segment their predecessors leave behind */
+      if (this->chunks.size() > 1) {
+            std::vector<std::optional<Segment>> selected(this->chunks.size());
+            this->for_each_chunk([&](size_t i) { selected[i] = this->chunks[i].scan_segment(); });
+            for (size_t i = 1; i < this->chunks.size(); i++) starts[i] = selected[i - 1].value_or(starts[i - 1]);
+      }
+      this->for_each_chunk([&](size_t i) { this->chunks[i].assemble(starts[i], TEXT_OFFSET, DATA_OFFSET); });
+
+      Segment segment = Segment::Text;
+      this->text.clear();
+      this->data.clear();
+      this->symbols.clear();
+      this->symbols.reserve(this->source.size() / 64);
+      this->text.reserve(this->source.size() / 4);
+      for (Chunk& chunk : this->chunks) {
+            std::array<std::vector<byte_t>*, 2> segments = { &this->text, &this->data };
+            std::array<address_t, 2> bases = { static_cast<address_t>(TEXT_OFFSET + this->text.size()), static_cast<address_t>(DATA_OFFSET + this->data.size()) };
+
+            /** Reassemble in place if the chunk guessed its start wrong */
+            bool misplaced = chunk.start != segment;
+            for (size_t s = 0; s < 2; s++) misplaced |= bases[s] % chunk.alignment[s] != 0;
+            if (misplaced) chunk.assemble(segment, bases[0], bases[1]);
+
+            for (const auto& label : chunk.labels) {
+                  Symbol symbol = label.second;
+                  size_t s = size_t(symbol.segment);
+                  symbol.address += bases[s] - chunk.base[s];
+
+                  auto inserted = this->symbols.emplace(label.first, symbol);
+                  if (!inserted.second) {
+                        throw SyntaxException("Label '" + std::string(label.first) + "' in line " + std::to_string(symbol.line) +
+                              " is already defined in line " + std::to_string(inserted.first->second.line));
+                  }
+            }
+            if (chunk.error) std::rethrow_exception(chunk.error);
 
-            /** Map labels */
-            if (is_label(line)) {
-                  std::string label = line.substr(0, line.find(":"));
-                  this->labels.push_back(Symbol(label, i));
+            for (Fixup& fixup : chunk.fixups) fixup.offset += segments[size_t(fixup.segment)]->size();
+            for (auto& line : chunk.lines) line.first += this->text.size();
+            for (size_t s = 0; s < 2; s++) {
+                  segments[s]->insert(segments[s]->end(), chunk.bytes[s].begin(), chunk.bytes[s].end());
+                  std::vector<byte_t>().swap(chunk.bytes[s]);
             }
+            segment = chunk.segment;
       }
 #if DEBUG
       SHOW_LABELS_BANNER();
@@ -352,83 +718,60 @@ void mips::Assembler::first_pass() {
 #endif // DEBUG
 }
 
-/** Second pass of the assembler. Assemble the binary. */
-void mips::Assembler::second_pass() {
-#if DEBUG
-      SHOW_SECOND_PASS_BANNER();
-#endif // DEBUG
-
-      for (size_t i = 0; i < this->file_contents.size(); i++) {
-            std::string line = this->file_contents[i];
-
-            /** Ignore empty lines, comments and labels */
-            if (is_empty_line(line) || is_comment(line) || is_label(line)) continue;
-
-            /** Tokenize the line */
-            std::vector<std::string> tokens = tokenize(line);
-#if DEBUG
-            SHOW_TOKENS();
-#endif // DEBUG
-            if (is_r_type_instruction(tokens[0])) {
-                  ASSERT_ARG_COUNT(4, i, tokens[0]);
-#if DEBUG
-                  SHOW_R_TYPE_INSTRUCTION();
-#endif // DEBUG
-                  /** Check if the registers are valid */
-                  if (!is_valid_register(tokens[1]) || !is_valid_register(tokens[2]) || !is_valid_register(tokens[3])) throw std::runtime_error("Invalid register");
-
-                  /** Assemble the instruction and append it to the binary */
-                  instruction_t instruction = assemble_r_type_instruction(tokens[0], tokens[1], tokens[2], tokens[3]);
-                  append_instruction(instruction, this->binary);
+/**
+ * @brief Patches every recorded reference with its symbol address
+ */
+void mips::Assembler::backpatch() {
+      this->for_each_chunk([&](size_t i) { this->chunks[i].backpatch(this->symbols, this->text, this->data); });
 
-                  this->text_size += 4;
-                  this->line++;
-                  continue;
-            }
-            else if (is_i_type_instruction(tokens[0])) {
-                  ASSERT_ARG_COUNT(4, i, tokens[0]);
-#if DEBUG
-                  SHOW_I_TYPE_INSTRUCTION();
-#endif // DEBUG
-                  /** Validate the registers and immediate */
-                  if (!is_valid_register(tokens[1]) || !is_valid_register(tokens[2])) throw std::runtime_error("Invalid register");
-                  if (!is_valid_immediate(tokens[3])) throw std::runtime_error("Invalid immediate");
+      for (const Chunk& chunk : this->chunks) {
+            if (chunk.error) std::rethrow_exception(chunk.error);
+      }
+}
 
-                  /** Assemble the instruction and append it to the binary */
-                  instruction_t instruction = assemble_i_type_instruction(tokens[0], tokens[1], tokens[2], tokens[3]);
-                  append_instruction(instruction, this->binary);
+/**
+ * @brief Gathers the symbols, relocations and line map for the binary
+ * 
+ * @return mips::MIPS_debug_info 
+ */
+mips::MIPS_debug_info mips::Assembler::collect_debug_info() const {
+      MIPS_debug_info info;
+
+      std::vector<std::pair<std::string_view, Symbol>> sorted(this->symbols.begin(), this->symbols.end());
+      std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second.address != b.second.address ? a.second.address < b.second.address : a.first < b.first;
+      });
+
+      std::unordered_map<std::string_view, word_t> indices;
+      indices.reserve(sorted.size());
+      info.symbols.reserve(sorted.size());
+      for (const auto& symbol : sorted) {
+            indices.emplace(symbol.first, static_cast<word_t>(info.symbols.size()));
+            info.symbols.push_back({ std::string(symbol.first), symbol.second.address, static_cast<byte_t>(symbol.second.segment), static_cast<word_t>(symbol.second.line) });
+      }
 
-                  this->text_size += 4;
-                  this->line++;
-                  continue;
+      for (const Chunk& chunk : this->chunks) {
+            for (const Fixup& fixup : chunk.fixups) {
+                  info.relocations.push_back({ fixup.offset, indices.at(fixup.symbol), static_cast<byte_t>(fixup.kind), static_cast<byte_t>(fixup.segment), { 0, 0 } });
             }
-            else if (is_j_type_instruction(tokens[0])) {
-                  ASSERT_ARG_COUNT(2, i, tokens[0]);
-#if DEBUG
-                  SHOW_J_TYPE_INSTRUCTION();
-#endif // DEBUG
-                  /** Check if the address is valid */
-                  if (!is_valid_address(tokens[1])) throw std::runtime_error("Invalid address");
-
-                  /** Assemble the instruction and append it to the binary */
-                  instruction_t instruction = assemble_j_type_instruction(tokens[0], tokens[1]);
-                  append_instruction(instruction, this->binary);
-
-                  this->text_size += 4;
-                  this->line++;
-                  continue;
+            for (const auto& line : chunk.lines) {
+                  info.lines.push_back({ static_cast<address_t>(TEXT_OFFSET + line.first), static_cast<word_t>(line.second) });
             }
       }
+      return info;
 }
 
 /** Assembles MIPS code into a binary file */
 void mips::Assembler::assemble(std::string filename, std::string output) {
+      size_t workers = this->threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : this->threads;
+
       this->load_file(filename);
-      this->first_pass();
-      this->second_pass();
+      this->split(workers);
+      this->parse();
+      this->backpatch();
 
       /** Use save function from obj.hpp to save */
-      mips::save_mips_binary(output, this->binary);
+      mips::save_mips_binary(output, this->text, this->data, this->collect_debug_info());
 }
 
 // MIT License
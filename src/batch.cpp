@@ -0,0 +1,338 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+/** Mips Includes */
+#include <batch.hpp>
+#include <except.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Escapes a string for a JSON document
+ *
+ * @param[i] value
+ * @return std::string
+ */
+static std::string json_escape(const std::string& value) {
+      std::string escaped;
+      escaped.reserve(value.size());
+
+      for (unsigned char c : value) {
+            switch (c) {
+                  case '"':  escaped += "\\\""; break;
+                  case '\\': escaped += "\\\\"; break;
+                  case '\n': escaped += "\\n"; break;
+                  case '\r': escaped += "\\r"; break;
+                  case '\t': escaped += "\\t"; break;
+                  default:
+                        if (c < 0x20) {
+                              char code[8];
+                              std::snprintf(code, sizeof(code), "\\u%04x", c);
+                              escaped += code;
+                        }
+                        else {
+                              escaped += static_cast<char>(c);
+                        }
+            }
+      }
+      return escaped;
+}
+
+/**
+ * @brief Quotes a string for a CSV field
+ *
+ * @param[i] value
+ * @return std::string
+ */
+static std::string csv_quote(const std::string& value) {
+      std::string quoted = "\"";
+      for (char c : value) {
+            if (c == '"') quoted += '"';
+            quoted += c;
+      }
+      return quoted + "\"";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ */
+mips::WorkStealingPool::WorkStealingPool(size_t threads) {
+      if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+      for (size_t i = 0; i < threads; i++) {
+            queues.push_back(std::make_unique<Queue>());
+      }
+}
+
+/**
+ * @brief Takes the next task of the given worker
+ *
+ * @param[i] worker
+ * @param[o] task
+ * @return true/false
+ */
+bool mips::WorkStealingPool::next_task(size_t worker, size_t& task) {
+      {
+            Queue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                  task = own.tasks.back();
+                  own.tasks.pop_back();
+                  return true;
+            }
+      }
+
+      /** Steal the oldest task of the first busy worker after us */
+      for (size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                  task = victim.tasks.front();
+                  victim.tasks.pop_front();
+                  return true;
+            }
+      }
+      return false;
+}
+
+/**
+ * @brief Runs the tasks and waits for them
+ *
+ * @details Tasks are dealt round-robin up front. No task is ever added
+ *          afterwards, so a worker that finds every queue empty is done.
+ *
+ * @param[i] count
+ * @param[i] task
+ */
+void mips::WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task) {
+      for (size_t i = 0; i < count; i++) {
+            queues[i % queues.size()]->tasks.push_front(i);
+      }
+
+      std::vector<std::thread> workers;
+      for (size_t worker = 0; worker < queues.size(); worker++) {
+            workers.emplace_back([this, worker, &task]() {
+                  size_t index;
+                  while (next_task(worker, index)) {
+                        task(index);
+                  }
+            });
+      }
+
+      for (std::thread& worker : workers) {
+            worker.join();
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Collects the binaries of a batch
+ *
+ * @param[i] source
+ * @return std::vector<std::string>
+ */
+std::vector<std::string> mips::collect_batch(const std::string& source) {
+      namespace fs = std::filesystem;
+      std::vector<std::string> paths;
+
+      std::error_code error;
+      if (fs::is_directory(source, error)) {
+            for (const fs::directory_entry& entry : fs::directory_iterator(source, error)) {
+                  if (entry.is_regular_file() && entry.path().extension() == ".mips") {
+                        paths.push_back(entry.path().string());
+                  }
+            }
+            if (error) throw FileException("Failed to read directory " + source);
+            std::sort(paths.begin(), paths.end());
+            return paths;
+      }
+
+      std::ifstream list(source);
+      if (!list.is_open()) throw FileException("Failed to open " + source);
+
+      std::string line;
+      while (std::getline(list, line)) {
+            /** Trim whitespace, skip blank lines and comments */
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#') continue;
+            size_t end = line.find_last_not_of(" \t\r");
+            paths.push_back(line.substr(begin, end - begin + 1));
+      }
+      return paths;
+}
+
+/**
+ * @brief Runs a single task
+ *
+ * @details The emulator runs in slices of BATCH_SLICE instructions, so the
+ *          budget and timeout are only checked between slices.
+ *
+ * @param[i] path
+ * @param[i] options
+ * @return TaskResult
+ */
+mips::TaskResult mips::run_task(const std::string& path, const BatchOptions& options) {
+      using clock = std::chrono::steady_clock;
+
+      TaskResult result = { path, TaskStatus::Error, 0, 0, 0.0, "", "", {} };
+      const clock::time_point start = clock::now();
+      const clock::time_point deadline = start + std::chrono::milliseconds(options.timeout_ms);
+
+      BufferIO io;
+
+      try {
+            Emulator emulator(options.backend, options.engine);
+            emulator.set_io(&io);
+            emulator.prepare_and_hold(path);
+
+            while (true) {
+                  uint64_t left = options.budget - result.instructions;
+                  if (left == 0) {
+                        result.status = TaskStatus::BudgetExceeded;
+                        break;
+                  }
+
+                  RunResult run = emulator.run_for(std::min(left, BATCH_SLICE));
+                  result.instructions += run.executed;
+
+                  if (run.status == RunStatus::Halted) {
+                        result.status = TaskStatus::Halted;
+                        result.exit_code = emulator.get_exit_code();
+                        break;
+                  }
+                  if (run.status == RunStatus::Faulted) {
+                        result.status = TaskStatus::Faulted;
+                        result.message = emulator.get_fault_message();
+                        break;
+                  }
+                  if (options.timeout_ms != 0 && clock::now() >= deadline) {
+                        result.status = TaskStatus::TimedOut;
+                        break;
+                  }
+            }
+            result.tlb = emulator.get_memory().get_tlb_stats();
+      }
+      catch (const std::exception& e) {
+            result.status = TaskStatus::Error;
+            result.message = e.what();
+      }
+
+      result.output = io.get_output();
+      result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+      return result;
+}
+
+/**
+ * @brief Runs every binary of a batch in parallel
+ *
+ * @param[i] paths
+ * @param[i] options
+ * @return std::vector<TaskResult>
+ */
+std::vector<mips::TaskResult> mips::run_batch(const std::vector<std::string>& paths, const BatchOptions& options) {
+      std::vector<TaskResult> results(paths.size());
+
+      /** Every task writes its own slot, so results need no lock */
+      WorkStealingPool pool(options.threads);
+      pool.run(paths.size(), [&](size_t index) {
+            results[index] = run_task(paths[index], options);
+      });
+      return results;
+}
+
+/**
+ * @brief Gets the name of a task status
+ *
+ * @param[i] status
+ * @return std::string
+ */
+std::string mips::to_string(TaskStatus status) {
+      switch (status) {
+            case TaskStatus::Halted:         return "halted";
+            case TaskStatus::Faulted:        return "faulted";
+            case TaskStatus::BudgetExceeded: return "budget";
+            case TaskStatus::TimedOut:       return "timeout";
+            case TaskStatus::Error:          return "error";
+      }
+      return "unknown";
+}
+
+/**
+ * @brief Writes a batch report as JSON
+ *
+ * @param[o] out
+ * @param[i] results
+ */
+void mips::write_json_report(std::ostream& out, const std::vector<TaskResult>& results) {
+      out << "[\n";
+      for (size_t i = 0; i < results.size(); i++) {
+            const TaskResult& r = results[i];
+            out << "  {"
+                << "\"path\": \"" << json_escape(r.path) << "\", "
+                << "\"status\": \"" << to_string(r.status) << "\", "
+                << "\"exit_code\": " << r.exit_code << ", "
+                << "\"instructions\": " << r.instructions << ", "
+                << "\"seconds\": " << r.seconds << ", "
+                << "\"tlb_hits\": " << r.tlb.hits << ", "
+                << "\"tlb_misses\": " << r.tlb.misses << ", "
+                << "\"output\": \"" << json_escape(r.output) << "\", "
+                << "\"message\": \"" << json_escape(r.message) << "\"}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+      }
+      out << "]\n";
+}
+
+/**
+ * @brief Writes a batch report as CSV
+ *
+ * @param[o] out
+ * @param[i] results
+ */
+void mips::write_csv_report(std::ostream& out, const std::vector<TaskResult>& results) {
+      out << "path,status,exit_code,instructions,seconds,tlb_hits,tlb_misses,output,message\n";
+      for (const TaskResult& r : results) {
+            out << csv_quote(r.path) << ','
+                << to_string(r.status) << ','
+                << r.exit_code << ','
+                << r.instructions << ','
+                << r.seconds << ','
+                << r.tlb.hits << ','
+                << r.tlb.misses << ','
+                << csv_quote(r.output) << ','
+                << csv_quote(r.message) << '\n';
+      }
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,272 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+/** Mips Includes */
+#include <cache.hpp>
+#include <except.hpp>
+#include <instruction.hpp>
+#include <report.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Number of instructions in the miss report */
+constexpr size_t CACHE_REPORT_LIMIT = 20;
+
+/**
+ * @brief Checks whether a value is a power of two
+ *
+ * @param[i] value
+ * @return bool
+ */
+static bool power_of_two(uint64_t value) {
+      return value != 0 && (value & (value - 1)) == 0;
+}
+
+/**
+ * @brief Names a replacement policy
+ *
+ * @param[i] policy
+ * @return const char*
+ */
+static const char* policy_name(mips::ReplacementPolicy policy) {
+      switch (policy) {
+            case mips::ReplacementPolicy::Lru: return "lru";
+            case mips::ReplacementPolicy::Fifo: return "fifo";
+            case mips::ReplacementPolicy::Random: return "random";
+      }
+      return "?";
+}
+
+/**
+ * @brief Parses a size such as 4096, 32k or 1m
+ *
+ * @param[i] text
+ * @return uint64_t
+ * @throw mips::Exception If the size is invalid
+ */
+static uint64_t parse_size(const std::string& text) {
+      size_t end = 0;
+      uint64_t value = 0;
+      try {
+            value = std::stoull(text, &end);
+      }
+      catch (const std::exception&) {
+            throw mips::Exception("Invalid cache size '" + text + "'");
+      }
+
+      const std::string suffix = text.substr(end);
+      if (suffix == "k" || suffix == "K") return value << 10;
+      if (suffix == "m" || suffix == "M") return value << 20;
+      if (!suffix.empty()) throw mips::Exception("Invalid cache size '" + text + "'");
+      return value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Returns the default hierarchy
+ *
+ * @return CacheHierarchyConfig
+ */
+mips::CacheHierarchyConfig mips::default_cache_config() {
+      return {
+            { "L1I", 32 << 10, 4, 64, ReplacementPolicy::Lru },
+            { "L1D", 32 << 10, 8, 64, ReplacementPolicy::Lru },
+            { "L2", 256 << 10, 8, 64, ReplacementPolicy::Lru }
+      };
+}
+
+/**
+ * @brief Parses a hierarchy description
+ *
+ * @param[i] description
+ * @return CacheHierarchyConfig
+ */
+mips::CacheHierarchyConfig mips::parse_cache_config(const std::string& description) {
+      CacheHierarchyConfig config = default_cache_config();
+      if (description == "default") return config;
+
+      std::istringstream levels(description);
+      std::string level;
+      while (std::getline(levels, level, ',')) {
+            const size_t equals = level.find('=');
+            if (equals == std::string::npos) throw Exception("Invalid cache level '" + level + "', expected level=size:ways:line:policy");
+
+            const std::string name = level.substr(0, equals);
+            CacheConfig* cache = nullptr;
+            if (name == "l1i") cache = &config.l1i;
+            else if (name == "l1d") cache = &config.l1d;
+            else if (name == "l2") cache = &config.l2;
+            else throw Exception("Unknown cache level '" + name + "', expected l1i, l1d or l2");
+
+            std::vector<std::string> fields;
+            std::istringstream values(level.substr(equals + 1));
+            std::string field;
+            while (std::getline(values, field, ':')) fields.push_back(field);
+            if (fields.size() != 4) throw Exception("Invalid cache level '" + level + "', expected level=size:ways:line:policy");
+
+            cache->size = parse_size(fields[0]);
+            cache->associativity = static_cast<word_t>(parse_size(fields[1]));
+            cache->line_size = static_cast<word_t>(parse_size(fields[2]));
+            if (fields[3] == "lru") cache->policy = ReplacementPolicy::Lru;
+            else if (fields[3] == "fifo") cache->policy = ReplacementPolicy::Fifo;
+            else if (fields[3] == "random") cache->policy = ReplacementPolicy::Random;
+            else throw Exception("Unknown replacement policy '" + fields[3] + "', expected lru, fifo or random");
+      }
+      return config;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @param[i] config
+ */
+mips::Cache::Cache(const CacheConfig& config) : config(config) {
+      if (!power_of_two(config.size) || !power_of_two(config.associativity) || !power_of_two(config.line_size)) {
+            throw Exception("Cache " + config.name + ": size, associativity and line size must be powers of two");
+      }
+      if (config.line_size < sizeof(word_t) || uint64_t(config.associativity) * config.line_size > config.size) {
+            throw Exception("Cache " + config.name + ": a set must hold at least one line of at least one word");
+      }
+
+      const uint64_t lines = config.size / config.line_size;
+      line_shift = 0;
+      while ((word_t(1) << line_shift) < config.line_size) line_shift++;
+      set_mask = static_cast<word_t>(lines / config.associativity - 1);
+
+      tags.assign(lines, INVALID_LINE);
+      stamps.assign(lines, 0);
+      dirty.assign(lines, 0);
+}
+
+/**
+ * @brief Fills a line after a miss
+ *
+ * @details Invalid ways are used first. Otherwise LRU and FIFO evict the
+ *          oldest stamp and Random a xorshift pick.
+ *
+ * @param[i] line
+ * @param[i] first
+ * @param[i] write
+ */
+void mips::Cache::fill(word_t line, size_t first, bool write) {
+      stats.misses++;
+
+      size_t victim = first;
+      for (size_t way = first; way < first + config.associativity; way++) {
+            if (tags[way] == INVALID_LINE) {
+                  victim = way;
+                  break;
+            }
+            if (config.policy != ReplacementPolicy::Random && stamps[way] < stamps[victim]) victim = way;
+      }
+
+      if (tags[victim] != INVALID_LINE) {
+            if (config.policy == ReplacementPolicy::Random) {
+                  random ^= random << 13;
+                  random ^= random >> 7;
+                  random ^= random << 17;
+                  victim = first + (random & (config.associativity - 1));
+            }
+
+            stats.evictions++;
+            if (dirty[victim]) {
+                  stats.writebacks++;
+                  writeback = tags[victim];
+            }
+      }
+
+      tags[victim] = line;
+      stamps[victim] = ++clock;
+      dirty[victim] = write;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @param[i] config
+ * @param[i] memory
+ */
+mips::CacheHierarchy::CacheHierarchy(const CacheHierarchyConfig& config, Memory* memory)
+      : l1i(config.l1i), l1d(config.l1d), l2(config.l2), memory(memory) {
+      per_pc.assign(memory->get_text_size() / sizeof(instruction_t), PcStats());
+}
+
+/**
+ * @brief Writes the statistics of every cache and the instructions that miss the most
+ *
+ * @param[o] output
+ */
+void mips::CacheHierarchy::write_report(std::ostream& output) {
+      output << std::fixed << std::setprecision(2);
+      output << "Caches:" << std::endl;
+      output << std::setw(6) << "cache" << std::setw(10) << "size" << std::setw(6) << "ways" << std::setw(6) << "line" << std::setw(8) << "policy"
+             << std::setw(14) << "accesses" << std::setw(14) << "hits" << std::setw(14) << "misses" << std::setw(8) << "miss%"
+             << std::setw(14) << "evictions" << std::setw(14) << "writebacks" << std::endl;
+      for (const Cache* cache : { &l1i, &l1d, &l2 }) {
+            const CacheConfig& config = cache->get_config();
+            const CacheStats& stats = cache->get_stats();
+            const uint64_t accesses = stats.hits + stats.misses;
+            output << std::setw(6) << config.name << std::setw(10) << config.size << std::setw(6) << config.associativity << std::setw(6) << config.line_size
+                   << std::setw(8) << policy_name(config.policy) << std::setw(14) << accesses << std::setw(14) << stats.hits << std::setw(14) << stats.misses
+                   << std::setw(8) << percent(stats.misses, accesses) << std::setw(14) << stats.evictions << std::setw(14) << stats.writebacks << std::endl;
+      }
+      output << std::endl;
+
+      auto misses = [&](size_t i) { return per_pc[i].fetch_misses + per_pc[i].data_misses; };
+      std::vector<size_t> missing;
+      for (size_t i = 0; i < per_pc.size(); i++) {
+            if (misses(i) != 0) missing.push_back(i);
+      }
+      const size_t limit = std::min(missing.size(), CACHE_REPORT_LIMIT);
+      std::partial_sort(missing.begin(), missing.begin() + limit, missing.end(), [&](size_t a, size_t b) {
+            return misses(a) != misses(b) ? misses(a) > misses(b) : a < b;
+      });
+      missing.resize(limit);
+
+      output << "Instructions by L1 misses:" << std::endl;
+      output << std::setw(14) << "fetch misses" << std::setw(14) << "data accesses" << std::setw(14) << "data misses" << std::setw(8) << "miss%"
+             << "  address     instruction" << std::endl;
+      for (size_t i : missing) {
+            const PcStats& pc = per_pc[i];
+            const address_t address = static_cast<address_t>(TEXT_OFFSET + i * sizeof(instruction_t));
+            output << std::setw(14) << pc.fetch_misses << std::setw(14) << pc.data_accesses << std::setw(14) << pc.data_misses
+                   << std::setw(8) << percent(pc.data_misses, pc.data_accesses) << "  0x" << std::hex << std::setw(8) << std::setfill('0') << address
+                   << std::dec << std::setfill(' ') << "  " << disassemble(memory->read_word(address), address) << std::endl;
+      }
+      if (outside.fetch_misses + outside.data_misses != 0) {
+            output << "(" << outside.fetch_misses + outside.data_misses << " misses outside the text segment)" << std::endl;
+      }
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -2,19 +2,17 @@
 // Created by JoaoAJMatos on 2023-10-19
 //
 
-/** C++ Includes */
-#include <iostream>
-
 /** Mips Includes */
 #include <cpu.hpp>
+#include <handlers.hpp>
 #include <instruction.hpp>
 
 /** 
  * @brief Constructor
  */
-mips::CPU::CPU(Memory* memory) {
-      reset();
+mips::CPU::CPU(Memory* memory) : decode_cache(DECODE_CACHE_SIZE) {
       this->memory = memory;
+      reset();
 }
 
 /** 
@@ -29,223 +27,268 @@ void mips::CPU::reset() {
       for (int i = 0; i < 32; i++) {
             registers[i] = 0;
       }
+      clear_fault();
+      flush_decode_cache();
 }
 
-/** 
- * @brief Steps the CPU
+/**
+ * @brief Copies the registers of another CPU
  * 
- * @details This function goes through one fetch-decode-execute cycle
+ * @param[i] other 
  */
-void mips::CPU::step() {
-      instruction_t instruction = fetch();
-      opcode_t opcode = decode(instruction);
-      execute(instruction, opcode);
+void mips::CPU::copy_registers(const CPU& other) {
+      pc = other.pc;
+      hi = other.hi;
+      lo = other.lo;
+      for (int i = 0; i < 32; i++) {
+            registers[i] = other.registers[i];
+      }
 }
 
 /**
- * @brief Gets the string representation of the CPU state
+ * @brief Saves the registers
  * 
- * @return std::string 
+ * @return CPUState 
  */
-std::string mips::CPU::state() {
-      std::string state = "PC: " + std::to_string(pc) + "\n";
-      state += "Registers:\n";
+mips::CPUState mips::CPU::save_state() const {
+      CPUState state;
+      state.pc = pc;
+      state.hi = hi;
+      state.lo = lo;
       for (int i = 0; i < 32; i++) {
-            state += "$" + std::to_string(i) + ": " + std::to_string(registers[i]) + "\n";
+            state.registers[i] = registers[i];
       }
-      state += "HI: " + std::to_string(hi) + "\n";
-      state += "LO: " + std::to_string(lo) + "\n";
       return state;
 }
 
-/** 
- * @brief Fetches instruction
+/**
+ * @brief Loads saved registers
  * 
- * @details This function fetches the next instruction from memory and increments
- *          the program counter
+ * @param[i] state 
  */
-mips::instruction_t mips::CPU::fetch() {
-      instruction_t instruction = memory->read_word(pc);
-      pc += sizeof(instruction_t);
-      return instruction;
+void mips::CPU::load_state(const CPUState& state) {
+      pc = state.pc;
+      hi = state.hi;
+      lo = state.lo;
+      for (int i = 0; i < 32; i++) {
+            registers[i] = state.registers[i];
+      }
+      clear_fault();
 }
 
 /** 
- * @brief Decodes the instruction 
+ * @brief Steps the CPU
  * 
- * @details This function decodes the instruction and returns the opcode
+ * @details This function goes through one fetch-decode-execute cycle.
+ *          Fetch and decode are skipped when the decoded instruction cache
+ *          already holds the instruction at the program counter. Mirrors
+ *          step(inspector) without the inspector; sharing the template
+ *          made the interpreter loop about a quarter slower.
  */
-mips::opcode_t mips::CPU::decode(instruction_t instruction) {
-      return get_opcode(instruction);
+void mips::CPU::step() {
+      /** A write landed on a code page since the cache was filled */
+      if (decode_cache_version != memory->get_code_version()) {
+            flush_decode_cache();
+      }
+
+      const address_t address = pc;
+      try {
+            DecodedInstruction& decoded = decode_cache[(address >> 2) & (DECODE_CACHE_SIZE - 1)];
+            if (decoded.pc != address) {
+                  decode(fetch(address), decoded);
+                  decoded.pc = address;
+            }
+
+            pc += sizeof(instruction_t);
+            execute(decoded);
+      } catch (const AccessViolation& violation) {
+            raise_access_violation(violation, address);
+      }
 }
 
-/** 
- * @brief Executes the instruction 
+/**
+ * @brief Runs the CPU
  * 
- * @details This function executes the instruction according to its opcode
- *          and instruction type.
+ * @details The loop only counts down the budget; faults zero it from inside
+ *          the handler, so the fault status is not checked per instruction.
+ * 
+ * @param[i] budget 
+ * @return uint64_t 
  */
-void mips::CPU::execute(instruction_t instruction, opcode_t opcode) {
-      switch (opcode) {
-            case R_TYPE: // R-type
-                  execute_r(instruction);
-                  break;
-            case SYSCALL: // syscall
-                  execute_syscall();
-                  break;
-            default:
-                  execute_i(instruction);
-                  execute_j(instruction);
-                  break;
+uint64_t mips::CPU::run(uint64_t budget) {
+      if (status != Status::Running) return 0;
+
+      remaining = budget;
+      while (remaining != 0) {
+            remaining--;
+            step();
       }
+      return retired(budget);
 }
 
-/** 
- * @brief Executes the R-type instruction
+/**
+ * @brief Raises a guest fault
  * 
- * @details In R-type instructions, the opcode is 0x00
- *          and the funct field determines the operation.
+ * @param[i] cause 
+ * @param[i] address 
  */
-void mips::CPU::execute_r(instruction_t instruction) {
-      /** Extract the fileds from the instruction */
-      byte_t rs = get_rs(instruction);
-      byte_t rt = get_rt(instruction);
-      byte_t rd = get_rd(instruction);
-      [[maybe_unused]] byte_t shamt = get_shamt(instruction);
-      byte_t funct = get_funct(instruction);
+void mips::CPU::raise_fault(FaultCause cause, address_t address) {
+      status = Status::Faulted;
+      fault_cause = cause;
+      fault_pc = address;
+      pc = address;
+      remaining_at_stop = remaining;
+      remaining = 0;
+}
 
-      switch (funct) {
-            case 0x20: // add
-                  registers[rd] = registers[rs] + registers[rt];
-                  break;
-            case 0x22: // sub
-                  registers[rd] = registers[rs] - registers[rt];
-                  break;
-            case 0x24: // and
-                  registers[rd] = registers[rs] & registers[rt];
-                  break;
-            case 0x25: // or
-                  registers[rd] = registers[rs] | registers[rt];
-                  break;
-            default:
-                  throw std::runtime_error("Invalid funct for R-type instruction");
-      }
+/**
+ * @brief Raises a guest fault for an access violation
+ * 
+ * @param[i] violation 
+ * @param[i] address 
+ */
+void mips::CPU::raise_access_violation(const AccessViolation& violation, address_t address) {
+      fault_address = violation.get_address();
+      raise_fault(FaultCause::AccessViolation, address);
 }
 
-/** 
- * @brief Executes the J-type instruction 
+/**
+ * @brief Halts the CPU
  * 
- * @details In J-type instructions, the opcode is 0x02 or 0x03
- *          and the address field determines the target address.
+ * @param[i] code 
  */
-void mips::CPU::execute_j(instruction_t instruction) {
-      /** Extract the fields from the instruction */
-      byte_t opcode = get_opcode(instruction);
-      address_t address = get_address(instruction);
+void mips::CPU::halt(word_t code) {
+      status = Status::Halted;
+      exit_code = code;
+      remaining_at_stop = remaining;
+      remaining = 0;
+}
 
-      switch (opcode) {
-            case 0x02: // j (jumps to the target address)
-                  pc = address;
-                  break;
-            case 0x03: // jal (jumps to the target address and stores the return address in $ra)
-                  registers[31] = pc;
-                  pc = address;
-                  break;
-            default:
-                  throw std::runtime_error("Invalid opcode for J-type instruction");
+/**
+ * @brief Clears the last fault
+ */
+void mips::CPU::clear_fault() {
+      status = Status::Running;
+      fault_cause = FaultCause::None;
+      fault_pc = 0;
+      fault_address = 0;
+      exit_code = 0;
+}
+
+/**
+ * @brief Gets a description of the last fault
+ * 
+ * @return std::string 
+ */
+std::string mips::CPU::get_fault_message() const {
+      switch (fault_cause) {
+            case FaultCause::None:
+                  return "No fault";
+            case FaultCause::InvalidInstruction:
+                  return "Invalid instruction at " + std::to_string(fault_pc);
+            case FaultCause::InvalidSyscall:
+                  return "Invalid syscall code at " + std::to_string(fault_pc);
+            case FaultCause::Overflow:
+                  return "Arithmetic overflow at " + std::to_string(fault_pc);
+            case FaultCause::AddressError:
+                  return "Misaligned memory access at " + std::to_string(fault_pc);
+            case FaultCause::Breakpoint:
+                  return "Breakpoint at " + std::to_string(fault_pc);
+            case FaultCause::AccessViolation:
+                  return "Access violation on address " + std::to_string(fault_address) + " at " + std::to_string(fault_pc);
       }
+      return "Unknown fault";
+}
+
+/**
+ * @brief Gets the string representation of the CPU state
+ * 
+ * @return std::string 
+ */
+std::string mips::CPU::state() {
+      std::string state = "PC: " + std::to_string(pc) + "\n";
+      state += "Registers:\n";
+      for (int i = 0; i < 32; i++) {
+            state += "$" + std::to_string(i) + ": " + std::to_string(registers[i]) + "\n";
+      }
+      state += "HI: " + std::to_string(hi) + "\n";
+      state += "LO: " + std::to_string(lo) + "\n";
+      return state;
 }
 
 /** 
- * @brief Executes the I-type instruction 
+ * @brief Fetches instruction
  * 
- * @details In I-type instructions, the opcode is not 0x00, 0x02 or 0x03
- *          and the immediate field determines the operation.
+ * @details This function fetches the instruction at the given address and
+ *          marks its page as code.
  */
-void mips::CPU::execute_i(instruction_t instruction) {
-      /** Extract the fields from the instruction */
-      byte_t opcode = get_opcode(instruction);
-      byte_t rs = get_rs(instruction);
-      byte_t rt = get_rt(instruction);
-      halfword_t immediate = get_immediate(instruction);
+mips::instruction_t mips::CPU::fetch(address_t address) {
+      return memory->fetch_word(address);
+}
 
-      switch (opcode) {
-            case 0x23: // lw (loads a word from memory)
-                  registers[rt] = memory->read_word(registers[rs] + immediate);
-                  break;
-            case 0x2B: // sw (stores a word in memory)
-                  memory->write_word(registers[rs] + immediate, registers[rt]);
-                  break;
-            case 0x0F: // lui (loads a word in the upper half of a register)
-                  registers[rt] = immediate << 16;
-                  break;
-            case 0x0C: // andi (bitwise and with immediate)
-                  registers[rt] = registers[rs] & immediate;
-                  break;
-            case 0x0D: // ori (bitwise or with immediate)
-                  registers[rt] = registers[rs] | immediate;
-                  break;
-            case 0x0E: // nori (bitwise nor with immediate)
-                  registers[rt] = ~(registers[rs] | immediate);
-                  break;
-            case 0x0A: // slti (set less than immediate)
-                  registers[rt] = registers[rs] < immediate;
-                  break;
-            case 0x04: // beq (branch if equal)
-                  if (registers[rs] == registers[rt]) {
-                        pc += immediate << 2;
-                  }
-                  break;
-            case 0x05: // bne (branch if not equal)
-                  if (registers[rs] != registers[rt]) {
-                        pc += immediate << 2;
-                  }
-                  break;
-            case 0x07: // bgtz (branch if greater than zero)
-                  if (registers[rs] > 0) {
-                        pc += immediate << 2;
+/** 
+ * @brief Decodes the instruction 
+ * 
+ * @details This function extracts the fields of the instruction and looks
+ *          its operation up by opcode (and funct or rt, for R-type and
+ *          REGIMM encodings). Logical operations zero extend the immediate,
+ *          the rest sign extend it. Jump targets are kept as byte offsets
+ *          within the 256MB region of the jump.
+ */
+void mips::CPU::decode(instruction_t instruction, DecodedInstruction& decoded) {
+      decoded.rs = get_rs(instruction);
+      decoded.rt = get_rt(instruction);
+      decoded.rd = get_rd(instruction);
+      decoded.shamt = get_shamt(instruction);
+      decoded.immediate = 0;
+      decoded.op = Operation::Invalid;
+
+      const InstructionInfo* info = find_instruction(instruction);
+      if (info != nullptr) {
+            decoded.op = info->op;
+            switch (info->type) {
+                  case InstructionType::R:
+                        break;
+                  case InstructionType::I: {
+                        halfword_t immediate = get_immediate(instruction);
+                        decoded.immediate = info->zero_extend ? immediate : static_cast<word_t>(static_cast<int16_t>(immediate));
+                        break;
                   }
-                  break;
-            default:
-                  throw std::runtime_error("Invalid opcode for I-type instruction");
+                  case InstructionType::J:
+                        decoded.immediate = get_address(instruction) << 2;
+                        break;
+            }
       }
+
+      decoded.handler = Handlers::table[static_cast<size_t>(decoded.op)];
+}
+
+/**
+ * @brief Invalidates the decoded instruction cache
+ * 
+ * @details Every entry is tagged with an address that can never map to its
+ *          slot, so the next lookup misses.
+ */
+void mips::CPU::flush_decode_cache() {
+      for (size_t i = 0; i < DECODE_CACHE_SIZE; i++) {
+            decode_cache[i].pc = static_cast<address_t>(((i + 1) & (DECODE_CACHE_SIZE - 1)) << 2);
+      }
+      decode_cache_version = memory->get_code_version();
 }
 
 /** 
  * @brief Executes the syscall instruction 
  */
 void mips::CPU::execute_syscall() {
-      /** Grab the syscall code from $v0 */
-      byte_t syscall_code = get_syscall_code();
-
-      switch (syscall_code) {
-            case 1: // print_int (print an integer to stdout)
-                  std::cout << registers[4];
-                  break;
-            case 4: // print_string (print a string to stdout)
-                  std::cout << memory->read_string(registers[4]);
-                  break;
-            case 5: // read_int (read an integer from stdin)
-                  std::cin >> registers[2];
-                  break;
-            case 8: // read_string (read a string from stdin)
-                  //std::cin >> memory->read_string(registers[4]);
-                  break;
-            // TODO: Add support for sbrk
-            /*case 9: // sbrk (allocate memory on the heap)
-                  registers[2] = memory->allocate(registers[4]);
-                  break; */
-            case 10: // exit (exit the program)
-                  exit(registers[4]);
+      switch (syscalls->execute(*this, *memory)) {
+            case SyscallResult::Continue:
                   break;
-            case 11: // print_char (print a character to stdout)
-                  std::cout << static_cast<char>(registers[4]);
+            case SyscallResult::Halt:
+                  halt(registers[4]);
                   break;
-            case 12: // read_char (read a character from stdin)
-                  //std::cin >> static_cast<char>(registers[2]);
+            case SyscallResult::Invalid:
+                  raise_fault(FaultCause::InvalidSyscall, pc - sizeof(instruction_t));
                   break;
-            default:
-                  throw std::runtime_error("Invalid syscall code");
       }
 }
 
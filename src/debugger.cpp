@@ -0,0 +1,543 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+/** Mips Includes */
+#include <debugger.hpp>
+#include <cpu.hpp>
+#include <instruction.hpp>
+#include <memory.hpp>
+
+/** Replay log record tags */
+static constexpr char LOG_LINE = 'L';
+static constexpr char LOG_CHAR = 'C';
+static constexpr char LOG_EOF  = 'E';
+
+/**
+ * @brief Parses a command argument (decimal, or hexadecimal with 0x)
+ *
+ * @param[i] word The argument
+ * @return uint64_t
+ */
+static uint64_t parse_argument(const std::string& word) {
+      size_t parsed = 0;
+      uint64_t value = 0;
+      try {
+            value = std::stoull(word, &parsed, 0);
+      }
+      catch (const std::exception&) {
+            parsed = 0;
+      }
+
+      if (parsed == 0 || parsed != word.size()) throw std::invalid_argument("Invalid number '" + word + "'");
+      return value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Writes program output, unless muted
+ *
+ * @param[i] data
+ */
+void mips::ReplayIO::write(std::string_view data) {
+      if (!muted) io->write(data);
+}
+
+/**
+ * @brief Reads a line from the log, or records one
+ *
+ * @param[o] line
+ * @return bool
+ */
+bool mips::ReplayIO::read_line(std::string& line) {
+      if (cursor < log.size()) {
+            if (log[cursor++] == LOG_EOF) return false;
+
+            size_t length = 0;
+            for (int shift = 0; ; shift += 7) {
+                  byte_t byte = log[cursor++];
+                  length |= size_t(byte & 0x7F) << shift;
+                  if (!(byte & 0x80)) break;
+            }
+
+            line.assign(log, cursor, length);
+            cursor += length;
+            return true;
+      }
+
+      if (!io->read_line(line)) {
+            log += LOG_EOF;
+            cursor = log.size();
+            return false;
+      }
+
+      log += LOG_LINE;
+      size_t length = line.size();
+      do {
+            byte_t byte = length & 0x7F;
+            length >>= 7;
+            log += static_cast<char>(length != 0 ? byte | 0x80 : byte);
+      } while (length != 0);
+      log += line;
+      cursor = log.size();
+      return true;
+}
+
+/**
+ * @brief Reads a character from the log, or records one
+ *
+ * @return int
+ */
+int mips::ReplayIO::read_char() {
+      if (cursor < log.size()) {
+            if (log[cursor++] == LOG_EOF) return IO_EOF;
+            return static_cast<byte_t>(log[cursor++]);
+      }
+
+      int character = io->read_char();
+      if (character == IO_EOF) {
+            log += LOG_EOF;
+      }
+      else {
+            log += LOG_CHAR;
+            log += static_cast<char>(character);
+      }
+      cursor = log.size();
+      return character;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ */
+mips::Debugger::Debugger(Emulator& emulator, IO* io, size_t memory_limit)
+      : emulator(emulator), io(io), page_limit(memory_limit / PAGE_SIZE) {
+      page_copies = emulator.get_memory().get_page_copies();
+      emulator.set_io(&this->io);
+      checkpoint();
+}
+
+/**
+ * @brief Destructor
+ */
+mips::Debugger::~Debugger() {
+      io.flush();
+      emulator.set_syscall_handler(&StandardSyscalls::standard());
+}
+
+/**
+ * @brief Executes instructions
+ *
+ * @param[i] instructions
+ * @return RunResult
+ */
+mips::RunResult mips::Debugger::step(uint64_t instructions) {
+      return advance(instructions, false);
+}
+
+/**
+ * @brief Runs until a breakpoint is reached or the program stops
+ *
+ * @details The instruction under the program counter runs first, so resuming
+ *          from a breakpoint moves past it.
+ *
+ * @return RunResult
+ */
+mips::RunResult mips::Debugger::resume() {
+      RunResult first = advance(1, false);
+      if (first.status != RunStatus::Completed) return first;
+
+      RunResult rest = advance(UINT64_MAX, true);
+      rest.executed += first.executed;
+      return rest;
+}
+
+/**
+ * @brief Goes back a number of instructions
+ *
+ * @param[i] instructions
+ * @return bool
+ */
+bool mips::Debugger::reverse_step(uint64_t instructions) {
+      bool reached = instructions <= position;
+      seek(reached ? position - instructions : 0);
+      return reached;
+}
+
+/**
+ * @brief Goes back to the last time a breakpoint was reached
+ *
+ * @details Replays the history one checkpoint interval at a time, latest
+ *          first, noting the last position at which the program counter
+ *          sat on a breakpoint.
+ *
+ * @return bool
+ */
+bool mips::Debugger::reverse_resume() {
+      uint64_t end = position;
+
+      while (end > 0) {
+            const Checkpoint& saved = checkpoints[checkpoint_before(end - 1)];
+            restore(saved);
+
+            uint64_t at = position;
+            uint64_t hit = UINT64_MAX;
+            if (!breakpoints.empty()) {
+                  io.set_muted(true);
+                  position += emulator.run_until([&](const CPU& cpu) {
+                        if (breakpoints.count(cpu.get_pc())) hit = at;
+                        at++;
+                        return false;
+                  }, end - position).executed;
+                  io.set_muted(false);
+            }
+
+            if (hit != UINT64_MAX) {
+                  seek(hit);
+                  return true;
+            }
+            end = saved.position;
+      }
+
+      seek(0);
+      return false;
+}
+
+/**
+ * @brief Moves to a position
+ *
+ * @details Starts from the closest checkpoint, or from the current position
+ *          if it is closer.
+ *
+ * @param[i] target
+ */
+void mips::Debugger::seek(uint64_t target) {
+      const Checkpoint& saved = checkpoints[checkpoint_before(target)];
+      if (target < position || saved.position > position) restore(saved);
+      advance(target - position, false);
+}
+
+/**
+ * @brief Executes instructions, taking checkpoints on the way
+ *
+ * @details Runs in chunks that end at the frontier (so output is only
+ *          muted while replaying) and at the next checkpoint.
+ *
+ * @param[i] instructions
+ * @param[i] stop_at_breakpoints
+ * @return RunResult
+ */
+mips::RunResult mips::Debugger::advance(uint64_t instructions, bool stop_at_breakpoints) {
+      RunResult result = { RunStatus::Completed, 0 };
+      uint64_t executed = 0;
+
+      while (executed < instructions) {
+            bool replaying = position < frontier;
+            uint64_t chunk = instructions - executed;
+            if (replaying) chunk = std::min(chunk, frontier - position);
+            else chunk = std::min(chunk, checkpoints.back().position + interval - position);
+
+            io.set_muted(replaying);
+            auto start = std::chrono::steady_clock::now();
+            if (stop_at_breakpoints && !breakpoints.empty()) {
+                  result = emulator.run_until([this](const CPU& cpu) {
+                        return breakpoints.count(cpu.get_pc()) != 0;
+                  }, chunk);
+            }
+            else {
+                  result = emulator.run_for(chunk);
+            }
+            io.set_muted(false);
+
+            position += result.executed;
+            executed += result.executed;
+            if (!replaying) {
+                  run_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            if (position > frontier) frontier = position;
+            if (position == frontier && position >= checkpoints.back().position + interval) checkpoint();
+            if (result.status != RunStatus::Completed) break;
+      }
+
+      result.executed = executed;
+      return result;
+}
+
+/**
+ * @brief Takes a checkpoint at the current position
+ *
+ * @details With the Paged backend a checkpoint costs the pages written
+ *          after it is taken, which stop being shared with the live memory.
+ *          The mapped backends copy every resident page.
+ */
+void mips::Debugger::checkpoint() {
+      auto start = std::chrono::steady_clock::now();
+      checkpoints.push_back({ position, emulator.snapshot(), io.get_cursor() });
+      uint64_t cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+      const Memory& memory = emulator.get_memory();
+      if (memory.get_backend() == MemoryBackend::Paged) history_pages += memory.get_page_copies() - page_copies;
+      else history_pages += checkpoints.back().snapshot.memory->pages();
+      page_copies = memory.get_page_copies();
+
+      if (checkpoints.size() > 1 && cost * CHECKPOINT_OVERHEAD > run_time) interval *= 2;
+      run_time = 0;
+
+      while (checkpoints.size() > 1 && (checkpoints.size() > MAX_CHECKPOINTS || history_pages > page_limit)) {
+            thin();
+      }
+}
+
+/**
+ * @brief Restores a checkpoint
+ *
+ * @param[i] saved
+ */
+void mips::Debugger::restore(const Checkpoint& saved) {
+      emulator.restore(saved.snapshot);
+      io.seek(saved.cursor);
+      position = saved.position;
+      page_copies = emulator.get_memory().get_page_copies();
+}
+
+/**
+ * @brief Returns the last checkpoint at or before a position
+ *
+ * @param[i] target
+ * @return size_t
+ */
+size_t mips::Debugger::checkpoint_before(uint64_t target) const {
+      auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), target,
+            [](uint64_t position, const Checkpoint& saved) { return position < saved.position; });
+      return std::distance(checkpoints.begin(), after) - 1;
+}
+
+/**
+ * @brief Drops every other checkpoint and doubles the interval
+ *
+ * @details The memory held by the history is then counted exactly, since
+ *          the pages freed depend on which ones later checkpoints share.
+ *          Pages still shared with the live memory cost nothing extra.
+ */
+void mips::Debugger::thin() {
+      std::vector<Checkpoint> kept;
+      for (size_t i = 0; i < checkpoints.size(); i += 2) {
+            kept.push_back(std::move(checkpoints[i]));
+      }
+      checkpoints = std::move(kept);
+      interval *= 2;
+
+      std::vector<const Memory::Snapshot*> snapshots;
+      for (const Checkpoint& saved : checkpoints) {
+            snapshots.push_back(saved.snapshot.memory.get());
+      }
+
+      if (emulator.get_memory().get_backend() == MemoryBackend::Paged) {
+            std::shared_ptr<const Memory::Snapshot> live = emulator.get_memory().snapshot();
+            snapshots.push_back(live.get());
+            history_pages = Memory::Snapshot::distinct_pages(snapshots) - live->pages();
+      }
+      else {
+            history_pages = Memory::Snapshot::distinct_pages(snapshots);
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Runs the command line interface
+ *
+ * @param[i] input
+ * @param[o] output
+ */
+void mips::Debugger::cli(std::istream& input, std::ostream& output) {
+      std::string line;
+      std::string previous;
+
+      report(output);
+      while (true) {
+            io.flush();
+            output << "(mips++) " << std::flush;
+            if (!std::getline(input, line)) break;
+
+            if (line.find_first_not_of(" \t") == std::string::npos) line = previous;
+            else previous = line;
+
+            try {
+                  if (!execute(line, output)) break;
+            }
+            catch (const std::exception& e) {
+                  output << "Error: " << e.what() << std::endl;
+            }
+      }
+}
+
+/**
+ * @brief Executes one command line
+ *
+ * @param[i] line
+ * @param[o] output
+ * @return bool
+ */
+bool mips::Debugger::execute(const std::string& line, std::ostream& output) {
+      std::istringstream words(line);
+      std::string command;
+      std::string argument;
+      words >> command >> argument;
+
+      auto number = [&](uint64_t fallback) -> uint64_t {
+            return argument.empty() ? fallback : parse_argument(argument);
+      };
+
+      if (command.empty()) {
+            return true;
+      }
+      else if (command == "s" || command == "step") {
+            step(number(1));
+            report(output);
+      }
+      else if (command == "c" || command == "continue") {
+            resume();
+            report(output);
+      }
+      else if (command == "rs" || command == "reverse-step") {
+            if (!reverse_step(number(1))) output << "Reached the start of the program" << std::endl;
+            report(output);
+      }
+      else if (command == "rc" || command == "reverse-continue") {
+            if (!reverse_resume()) output << "No earlier breakpoint, reached the start of the program" << std::endl;
+            report(output);
+      }
+      else if (command == "g" || command == "goto") {
+            if (argument.empty()) throw std::invalid_argument("goto needs a position");
+            seek(number(0));
+            report(output);
+      }
+      else if (command == "b" || command == "break") {
+            if (argument.empty()) {
+                  for (address_t address : breakpoints) {
+                        output << "  0x" << std::hex << std::setw(8) << std::setfill('0') << address << std::dec << std::endl;
+                  }
+            }
+            else {
+                  add_breakpoint(number(0));
+            }
+      }
+      else if (command == "d" || command == "delete") {
+            if (argument.empty()) breakpoints.clear();
+            else remove_breakpoint(number(0));
+      }
+      else if (command == "r" || command == "regs") {
+            output << emulator.state() << std::endl;
+      }
+      else if (command == "x") {
+            std::string count;
+            words >> count;
+            address_t address = number(emulator.get_cpu().get_pc());
+            uint64_t words_left = count.empty() ? 1 : parse_argument(count);
+
+            Memory& memory = emulator.get_memory();
+            for (; words_left != 0; words_left--, address += 4) {
+                  word_t word = memory.read_word(address);
+                  output << "  0x" << std::hex << std::setw(8) << std::setfill('0') << address << ": 0x"
+                         << std::setw(8) << word << std::dec << "  " << disassemble(word, address) << std::endl;
+            }
+      }
+      else if (command == "history") {
+            output << "Position " << position << " of " << frontier << ", " << checkpoints.size()
+                   << " checkpoints every " << interval << " instructions, "
+                   << get_history_bytes() / 1024 << " KiB of pages, " << io.size() << " bytes of input" << std::endl;
+      }
+      else if (command == "memory") {
+            const Memory& memory = emulator.get_memory();
+            const TlbStats tlb = memory.get_tlb_stats();
+            const uint64_t accesses = tlb.hits + tlb.misses;
+            output << memory.resident_pages() << " resident pages, TLB " << tlb.hits << " hits, " << tlb.misses << " misses";
+            if (accesses != 0) output << " (" << std::fixed << std::setprecision(2) << 100.0 * tlb.hits / accesses << std::defaultfloat << "% hit rate)";
+            output << std::endl;
+      }
+      else if (command == "h" || command == "help") {
+            output << "Commands:" << std::endl;
+            output << "  s, step [n]\t\t\tExecutes n instructions (default 1)" << std::endl;
+            output << "  c, continue\t\t\tRuns until a breakpoint or the end of the program" << std::endl;
+            output << "  rs, reverse-step [n]\t\tGoes back n instructions (default 1)" << std::endl;
+            output << "  rc, reverse-continue\t\tGoes back to the last breakpoint reached" << std::endl;
+            output << "  g, goto <position>\t\tMoves to an instruction count" << std::endl;
+            output << "  b, break [address]\t\tSets a breakpoint, or lists them" << std::endl;
+            output << "  d, delete [address]\t\tDeletes a breakpoint, or all of them" << std::endl;
+            output << "  r, regs\t\t\tPrints the registers" << std::endl;
+            output << "  x [address] [n]\t\tPrints n memory words, disassembled (default: at the pc)" << std::endl;
+            output << "  history\t\t\tPrints checkpoint statistics" << std::endl;
+            output << "  memory\t\t\tPrints resident pages and TLB statistics" << std::endl;
+            output << "  q, quit\t\t\tExits the debugger" << std::endl;
+            output << "An empty line repeats the previous command." << std::endl;
+      }
+      else if (command == "q" || command == "quit") {
+            return false;
+      }
+      else {
+            output << "Unknown command '" << command << "' (try help)" << std::endl;
+      }
+      return true;
+}
+
+/**
+ * @brief Writes where the program is
+ *
+ * @param[o] output
+ */
+void mips::Debugger::report(std::ostream& output) {
+      io.flush();
+
+      const CPU& cpu = emulator.get_cpu();
+      output << "[" << position << "] pc = 0x" << std::hex << std::setw(8) << std::setfill('0') << cpu.get_pc() << std::dec;
+      switch (cpu.get_status()) {
+            case Status::Halted:
+                  output << " (exited with code " << cpu.get_exit_code() << ")";
+                  break;
+            case Status::Faulted:
+                  output << " (" << cpu.get_fault_message() << ")";
+                  break;
+            default:
+                  if (!(emulator.get_memory().permissions_at(cpu.get_pc()) & PERMISSION_EXECUTE)) {
+                        output << "  <not executable>";
+                        break;
+                  }
+                  output << "  " << disassemble(emulator.get_memory().read_word(cpu.get_pc()), cpu.get_pc());
+                  if (breakpoints.count(cpu.get_pc())) output << " (breakpoint)";
+                  break;
+      }
+      output << std::endl;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -3,24 +3,82 @@
 //
 
 /** C++ Includes */
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 /** Mips Includes */
 #include <emulator.hpp>
+#include <debugger.hpp>
+#include <except.hpp>
+#include <file.hpp>
+#include <instruction.hpp>
+#include <obj.hpp>
 
 /** 
  * @brief Constructor 
  */
-mips::Emulator::Emulator() {
-      this->memory = new Memory();
+mips::Emulator::Emulator(MemoryBackend backend, Engine engine) {
+      this->engine = engine;
+      this->memory = new Memory(backend);
+      if (engine == Engine::Lockstep || engine == Engine::LockstepJit) {
+            this->shadow_memory = new Memory(backend);
+      }
+      this->create_engine();
+}
+
+/**
+ * @brief Forks an emulator from a snapshot
+ */
+mips::Emulator::Emulator(const Snapshot& snapshot, Engine engine) {
+      this->engine = engine;
+      this->memory = new Memory(*snapshot.memory);
+      if (engine == Engine::Lockstep || engine == Engine::LockstepJit) {
+            this->shadow_memory = new Memory(*snapshot.memory);
+      }
+      this->create_engine();
+
+      this->cpu->load_state(snapshot.cpu);
+      if (this->shadow_cpu != nullptr) this->shadow_cpu->load_state(snapshot.cpu);
+}
+
+/**
+ * @brief Creates the CPUs and the execution engine over the memories
+ */
+void mips::Emulator::create_engine() {
       this->cpu = new CPU(this->memory);
+      if (this->shadow_memory != nullptr) {
+            this->shadow_cpu = new CPU(this->shadow_memory);
+      }
+
+      switch (this->engine) {
+            case Engine::Interpreter:
+                  break;
+            case Engine::Threaded:
+                  this->threaded = new ThreadedEngine(this->cpu, this->memory);
+                  break;
+            case Engine::Lockstep:
+                  this->threaded = new ThreadedEngine(this->shadow_cpu, this->shadow_memory);
+                  break;
+            case Engine::Jit:
+                  this->jit = new JitEngine(this->cpu, this->memory);
+                  break;
+            case Engine::LockstepJit:
+                  this->jit = new JitEngine(this->shadow_cpu, this->shadow_memory);
+                  break;
+      }
 }
 
 /** 
  * @brief Destructor 
  */
 mips::Emulator::~Emulator() {
+      delete this->threaded;
+      delete this->jit;
+      delete this->syscalls;
+      delete this->shadow_cpu;
+      delete this->shadow_memory;
       delete this->cpu;
       delete this->memory;
 }
@@ -29,45 +87,243 @@ mips::Emulator::~Emulator() {
  * @brief Runs the emulator 
  * 
  * @details This function runs the emulator
- * 
- * @param[i] filename 
  */
 void mips::Emulator::run() {
-      while (true) {
-            try {
-                  this->step();
-            }
-            catch(const std::exception& e) {
-                  std::cerr << e.what() << '\n';
+      RunResult result;
+      do {
+            result = this->run_for(RUN_SLICE);
+      } while (result.status == RunStatus::Completed);
+
+      this->cpu->get_syscall_handler()->flush();
+      if (result.status == RunStatus::Faulted) {
+            throw RuntimeException(this->cpu->get_fault_message());
+      }
+}
+
+/**
+ * @brief Runs the program under the profiler
+ * 
+ * @param[io] profiler 
+ * @return RunResult 
+ */
+mips::RunResult mips::Emulator::profile(Profiler& profiler) {
+      auto record = [&profiler](address_t from, address_t to) { profiler.record(from, to); };
+
+      RunResult result;
+      do {
+            result = this->make_result(this->cpu->run_observed(record, RUN_SLICE), RunStatus::Completed);
+      } while (result.status == RunStatus::Completed);
+
+      this->cpu->get_syscall_handler()->flush();
+      return result;
+}
+
+/**
+ * @brief Runs the emulator for a number of instructions
+ * 
+ * @details The engine is picked once per call, each engine then runs its own
+ *          loop over the whole budget.
+ * 
+ * @param[i] instructions 
+ * @return RunResult 
+ */
+mips::RunResult mips::Emulator::run_for(uint64_t instructions) {
+      uint64_t executed = 0;
+
+      switch (this->engine) {
+            case Engine::Interpreter:
+                  executed = this->cpu->run(instructions);
                   break;
-            }
-            
+            case Engine::Threaded:
+                  executed = this->threaded->run(instructions);
+                  break;
+            case Engine::Jit:
+                  executed = this->jit->run(instructions);
+                  break;
+            case Engine::Lockstep:
+            case Engine::LockstepJit:
+                  while (executed < instructions && this->cpu->get_status() == Status::Running) {
+                        executed += this->advance(instructions - executed);
+                  }
+                  break;
+      }
+
+      return this->make_result(executed, RunStatus::Completed);
+}
+
+/**
+ * @brief Takes a snapshot of the emulator
+ * 
+ * @return Snapshot 
+ */
+mips::Snapshot mips::Emulator::snapshot() const {
+      return { this->cpu->save_state(), this->memory->snapshot() };
+}
+
+/**
+ * @brief Restores a snapshot
+ * 
+ * @param[i] snapshot 
+ */
+void mips::Emulator::restore(const Snapshot& snapshot) {
+      this->memory->restore(*snapshot.memory);
+      this->cpu->load_state(snapshot.cpu);
+
+      if (this->shadow_cpu != nullptr) {
+            this->shadow_memory->restore(*snapshot.memory);
+            this->shadow_cpu->load_state(snapshot.cpu);
       }
 }
 
+/**
+ * @brief Runs the standard syscalls on the given IO
+ * 
+ * @param[i] io 
+ */
+void mips::Emulator::set_io(IO* io) {
+      delete this->syscalls;
+      this->syscalls = new StandardSyscalls(io);
+      this->cpu->set_syscall_handler(this->syscalls);
+}
+
 /**
  * @brief Prepare program and hold
  * 
  * @details Loads the program into memory, resets the CPU and holds the emulator.
+ *          The file is mapped once and copied into both memories in the
+ *          lockstep engines.
  * 
  * @param[i] filename 
  */
-void mips::Emulator::prepare_and_hold([[maybe_unused]] std::string filename) {
-      //this->memory->load_program(filename);
+void mips::Emulator::prepare_and_hold(std::string filename) {
+      MappedFile file(filename);
+
+      /** Execution starts at the first text address, with $gp and $sp set up */
+      CPUState start = {};
+      start.pc = TEXT_OFFSET;
+      start.registers[28] = GLOBAL_POINTER;
+      start.registers[29] = STACK_POINTER;
+
+      load_mips_image(file.contents(), this->memory);
       this->cpu->reset();
+      this->cpu->load_state(start);
+      if (this->shadow_cpu != nullptr) {
+            load_mips_image(file.contents(), this->shadow_memory);
+            this->shadow_cpu->reset();
+            this->shadow_cpu->load_state(start);
+      }
 }
 
 /**
  * @brief Steps through a CPU cycle
+ * 
+ * @return RunResult 
+ */
+mips::RunResult mips::Emulator::step() {
+      return this->run_for(1);
+}
+
+/**
+ * @brief Executes one step of a lockstep engine
+ * 
+ * @details In Lockstep mode syscalls are only executed by the interpreter,
+ *          so their side effects happen once; the threaded engine's machine
+ *          picks up the resulting registers and memory writes.
+ *
+ *          LockstepJit lets the JIT run one native block, then steps the
+ *          interpreter over the same number of instructions. Instructions
+ *          the JIT does not translate (byte and halfword accesses, HI/LO,
+ *          break, invalid instructions) are stepped by both CPUs; syscalls
+ *          only by the reference, as above.
+ * 
+ * @param[i] limit 
+ * @return uint64_t 
  */
-void mips::Emulator::step() {
-      try {
-            this->cpu->step();
+uint64_t mips::Emulator::advance(uint64_t limit) {
+      address_t pc = this->cpu->get_pc();
+      uint64_t executed = 0;
+
+      /** An unmapped pc faults inside run(), not here */
+      auto at_syscall = [&]() {
+            instruction_t instruction = this->memory->permissions_at(pc) & PERMISSION_READ ? this->memory->read_word(pc) : 0;
+            return get_opcode(instruction) == R_TYPE && get_funct(instruction) == SYSCALL;
+      };
+
+      if (this->engine == Engine::Lockstep) {
+            bool syscall = at_syscall();
+            executed = this->cpu->run(1);
+            if (syscall) {
+                  this->mirror_syscall();
+            }
+            else {
+                  this->threaded->run(1);
+            }
       }
-      catch(const std::exception& e) {
-            std::cerr << e.what() << '\n';
+      else {
+            executed = this->jit->run_native(std::min<uint64_t>(limit, JIT_MAX_BLOCK_LENGTH));
+            if (executed == 0) {
+                  bool syscall = at_syscall();
+                  executed = this->cpu->run(1);
+                  if (syscall) this->mirror_syscall();
+                  else this->shadow_cpu->run(1);
+            }
+            else {
+                  this->cpu->run(executed);
+            }
+      }
+
+      this->check_lockstep(pc);
+      return executed;
+}
+
+/**
+ * @brief Copies the effects of the syscall the interpreter just ran to the
+ *        shadow machine
+ */
+void mips::Emulator::mirror_syscall() {
+      this->shadow_cpu->copy_registers(*this->cpu);
+
+      address_t address = 0;
+      size_t size = this->cpu->get_syscall_handler()->last_write(address);
+      if (size == 0) return;
+
+      std::vector<byte_t> bytes(size);
+      this->memory->read_block(address, bytes.data(), size);
+      this->shadow_memory->write_block(bytes.data(), size, address);
+}
+
+/**
+ * @brief Compares the interpreter and shadow engine registers
+ * 
+ * @details Runs after every instruction, so the registers are compared as
+ *          plain values first and the message is only built on a mismatch.
+ * 
+ * @param[i] pc 
+ */
+void mips::Emulator::check_lockstep(address_t pc) {
+      const CPU& reference = *this->cpu;
+      const CPU& shadow_cpu = *this->shadow_cpu;
+      bool diverged = reference.get_pc() != shadow_cpu.get_pc() || reference.get_hi() != shadow_cpu.get_hi() || reference.get_lo() != shadow_cpu.get_lo();
+      for (byte_t i = 0; i < 32; i++) diverged |= reference.get_register(i) != shadow_cpu.get_register(i);
+      if (!diverged) return;
+
+      const std::string shadow = this->engine == Engine::LockstepJit ? "jit" : "threaded";
+      std::string mismatch;
+      auto compare = [&](const std::string& name, register_t expected, register_t actual) {
+            if (expected == actual) return;
+            mismatch += "\n  " + name + ": interpreter " + std::to_string(expected) + ", " + shadow + " " + std::to_string(actual);
+      };
+
+      compare("PC", this->cpu->get_pc(), this->shadow_cpu->get_pc());
+      compare("HI", this->cpu->get_hi(), this->shadow_cpu->get_hi());
+      compare("LO", this->cpu->get_lo(), this->shadow_cpu->get_lo());
+      for (byte_t i = 0; i < 32; i++) {
+            compare("$" + std::to_string(i), this->cpu->get_register(i), this->shadow_cpu->get_register(i));
+      }
+
+      if (!mismatch.empty()) {
+            throw RuntimeException("Engines diverged after the instruction at " + std::to_string(pc) + ":" + mismatch);
       }
-      
 }
 
 /**
@@ -87,8 +343,15 @@ std::string mips::Emulator::state(bool show_memory) {
       return state;
 }
 
+/**
+ * @brief Launches the debugger CLI
+ * 
+ * @details The program and the debugger share the standard streams.
+ */
 void mips::Emulator::cli() {
-
+      StreamIO io(std::cin, std::cout);
+      Debugger debugger(*this, &io);
+      debugger.cli(std::cin, std::cout);
 }
 
 // MIT License
@@ -0,0 +1,92 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <fstream>
+#include <sstream>
+
+/** System Includes */
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MIPS_HAS_MMAP 1
+#endif
+
+/** Mips Includes */
+#include <file.hpp>
+#include <except.hpp>
+
+/**
+ * @brief Maps a file
+ *
+ * @param[i] filename
+ */
+mips::MappedFile::MappedFile(const std::string& filename) {
+#if MIPS_HAS_MMAP
+      int descriptor = open(filename.c_str(), O_RDONLY);
+      if (descriptor < 0) throw FileException("Could not open " + filename);
+
+      struct stat info;
+      if (fstat(descriptor, &info) != 0) {
+            close(descriptor);
+            throw FileException("Could not open " + filename);
+      }
+
+      /** Empty files (and anything that is not a regular file) are read instead */
+      if (S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            close(descriptor);
+            if (mapping == MAP_FAILED) throw FileException("Could not map " + filename);
+
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            this->data = static_cast<const char*>(mapping);
+            this->size = info.st_size;
+            this->mapped = true;
+            return;
+      }
+      close(descriptor);
+#endif
+
+      std::ifstream file(filename, std::ios::binary);
+      if (!file.is_open()) throw FileException("Could not open " + filename);
+
+      std::ostringstream contents;
+      contents << file.rdbuf();
+      this->buffer = contents.str();
+      this->data = this->buffer.data();
+      this->size = this->buffer.size();
+}
+
+/**
+ * @brief Unmaps the file
+ */
+mips::MappedFile::~MappedFile() {
+#if MIPS_HAS_MMAP
+      if (this->mapped) munmap(const_cast<char*>(this->data), this->size);
+#endif
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
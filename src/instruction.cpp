@@ -3,35 +3,81 @@
 //
 
 /** C++ Includes */
-//#include <map>
+#include <cstdio>
 
-/** R-type instruction opcodes binary mappping */
-/*static std::map<std::string, std::string> r_type_instructions = {
-      {"add", "100000"}, {"addu", "100001"}, {"and", "100100"}, {"break", "001101"},
-      {"div", "011010"}, {"divu", "011011"}, {"jalr", "001001"}, {"jr", "001000"},
-      {"mfhi", "010000"}, {"mflo", "010010"}, {"mthi", "010001"}, {"mtlo", "010011"},
-      {"mult", "011000"}, {"multu", "011001"}, {"nor", "100111"}, {"or", "100101"},
-      {"sll", "000000"}, {"sllv", "000100"}, {"slt", "101010"}, {"sltu", "101011"},
-      {"sra", "000011"}, {"srav", "000111"}, {"srl", "000010"}, {"srlv", "000110"},
-      {"sub", "100010"}, {"subu", "100011"}, {"syscall", "001100"}, {"xor", "100110"}
-};*/
+/** Mips Includes */
+#include <instruction.hpp>
 
-/** I-type instruction opcodes binary mappping */
-/*std::map<std::string, std::string> i_type_instructions = {
-      {"addi", "001000"}, {"addiu", "001001"}, {"andi", "001100"}, {"beq", "000100"},
-      {"bgez", "000001"}, {"bgezal", "000001"}, {"bgtz", "000111"}, {"blez", "000110"},
-      {"bltz", "000001"}, {"bltzal", "000001"}, {"bne", "000101"}, {"lb", "100000"},
-      {"lbu", "100100"}, {"lh", "100001"}, {"lhu", "100101"}, {"lui", "001111"},
-      {"lw", "100011"}, {"lwc1", "110001"}, {"ori", "001101"}, {"sb", "101000"},
-      {"sh", "101001"}, {"slti", "001010"}, {"sltiu", "001011"}, {"sw", "101011"},
-      {"swc1", "111001"}, {"xori", "001110"}
-};*/
+/**
+ * @brief Disassembles an instruction
+ * 
+ * @param[i] instruction 
+ * @param[i] pc 
+ * @return std::string 
+ */
+std::string mips::disassemble(instruction_t instruction, address_t pc) {
+      char text[64];
 
-/** J-type instruction opcodes binary mappping */
-/*std::map<std::string, std::string> j_type_instructions = {
-      {"j", "000010"},
-      {"jal", "000011"}
-};*/
+      const InstructionInfo* info = find_instruction(instruction);
+      if (info == nullptr) {
+            std::snprintf(text, sizeof(text), ".word 0x%08x", instruction);
+            return text;
+      }
+
+      const std::string name(info->name);
+      const int rs = get_rs(instruction);
+      const int rt = get_rt(instruction);
+      const int rd = get_rd(instruction);
+      const int16_t offset = static_cast<int16_t>(get_immediate(instruction));
+      const int immediate = info->zero_extend ? get_immediate(instruction) : offset;
+      const address_t next = pc + sizeof(instruction_t);
+      const address_t branch = next + (offset << 2);
+
+      switch (info->syntax) {
+            case Syntax::None:
+                  return name;
+            case Syntax::RdRsRt:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d, $%d", name.c_str(), rd, rs, rt);
+                  break;
+            case Syntax::RdRtShamt:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d, %d", name.c_str(), rd, rt, get_shamt(instruction));
+                  break;
+            case Syntax::RdRtRs:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d, $%d", name.c_str(), rd, rt, rs);
+                  break;
+            case Syntax::RsRt:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d", name.c_str(), rs, rt);
+                  break;
+            case Syntax::Rs:
+                  std::snprintf(text, sizeof(text), "%s $%d", name.c_str(), rs);
+                  break;
+            case Syntax::Rd:
+                  std::snprintf(text, sizeof(text), "%s $%d", name.c_str(), rd);
+                  break;
+            case Syntax::RdRs:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d", name.c_str(), rd, rs);
+                  break;
+            case Syntax::RtRsImmediate:
+                  std::snprintf(text, sizeof(text), info->zero_extend ? "%s $%d, $%d, 0x%x" : "%s $%d, $%d, %d", name.c_str(), rt, rs, immediate);
+                  break;
+            case Syntax::RtImmediate:
+                  std::snprintf(text, sizeof(text), "%s $%d, 0x%x", name.c_str(), rt, immediate);
+                  break;
+            case Syntax::RtOffsetRs:
+                  std::snprintf(text, sizeof(text), "%s $%d, %d($%d)", name.c_str(), rt, immediate, rs);
+                  break;
+            case Syntax::RsRtLabel:
+                  std::snprintf(text, sizeof(text), "%s $%d, $%d, 0x%08x", name.c_str(), rs, rt, branch);
+                  break;
+            case Syntax::RsLabel:
+                  std::snprintf(text, sizeof(text), "%s $%d, 0x%08x", name.c_str(), rs, branch);
+                  break;
+            case Syntax::Target:
+                  std::snprintf(text, sizeof(text), "%s 0x%08x", name.c_str(), (next & JUMP_REGION_MASK) | (get_address(instruction) << 2));
+                  break;
+      }
+      return text;
+}
 
 // MIT License
 // 
@@ -0,0 +1,791 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+/** Mips Includes */
+#include <jit.hpp>
+
+#if MIPS_HAS_JIT
+#include <sys/mman.h>
+#endif
+
+#if MIPS_HAS_JIT
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+      /** Signature of the entry trampoline */
+      using entry_t = mips::address_t (*)(mips::register_t* registers, uint64_t budget, mips::JitEngine::Runtime* runtime, const mips::byte_t* code);
+
+      /** Condition codes (second byte of jcc rel32) */
+      constexpr uint8_t JO  = 0x80;
+      constexpr uint8_t JB  = 0x82;
+      constexpr uint8_t JE  = 0x84;
+      constexpr uint8_t JNE = 0x85;
+      constexpr uint8_t JL  = 0x8C;
+      constexpr uint8_t JGE = 0x8D;
+      constexpr uint8_t JLE = 0x8E;
+      constexpr uint8_t JG  = 0x8F;
+
+      /** ALU opcodes, eax <op>= [rbx + disp8] */
+      constexpr uint8_t ADD_REG = 0x03;
+      constexpr uint8_t SUB_REG = 0x2B;
+      constexpr uint8_t AND_REG = 0x23;
+      constexpr uint8_t OR_REG  = 0x0B;
+      constexpr uint8_t XOR_REG = 0x33;
+      constexpr uint8_t CMP_REG = 0x3B;
+
+      /** ALU opcodes, eax <op>= imm32 */
+      constexpr uint8_t ADD_IMM = 0x05;
+      constexpr uint8_t AND_IMM = 0x25;
+      constexpr uint8_t OR_IMM  = 0x0D;
+      constexpr uint8_t XOR_IMM = 0x35;
+      constexpr uint8_t CMP_IMM = 0x3D;
+
+      /** Shift kinds (ModRM byte of the shift group, eax operand) */
+      constexpr uint8_t SHL = 0xE0;
+      constexpr uint8_t SHR = 0xE8;
+      constexpr uint8_t SAR = 0xF8;
+
+      /**
+       * @brief Minimal x86-64 emitter
+       *
+       * @details Only knows the handful of encodings the translator needs.
+       *          Guest registers are addressed as [rbx + 4 * index]; writes
+       *          to $zero are dropped.
+       */
+      class Emitter
+      {
+      public:
+            Emitter(mips::byte_t* cursor) : cursor(cursor) {}
+
+            mips::byte_t* position() const { return cursor; }
+
+            void bytes(std::initializer_list<uint8_t> list) {
+                  for (uint8_t b : list) *cursor++ = b;
+            }
+
+            void dword(uint32_t value) {
+                  std::memcpy(cursor, &value, sizeof(value));
+                  cursor += sizeof(value);
+            }
+
+            void qword(uint64_t value) {
+                  std::memcpy(cursor, &value, sizeof(value));
+                  cursor += sizeof(value);
+            }
+
+            /** mov eax, [rbx + reg] */
+            void load(mips::byte_t reg) { bytes({0x8B, 0x43, disp(reg)}); }
+
+            /** mov edx, [rbx + reg] */
+            void load_edx(mips::byte_t reg) { bytes({0x8B, 0x53, disp(reg)}); }
+
+            /** mov ecx, [rbx + reg] */
+            void load_ecx(mips::byte_t reg) { bytes({0x8B, 0x4B, disp(reg)}); }
+
+            /** mov [rbx + reg], eax */
+            void store(mips::byte_t reg) {
+                  if (reg != 0) bytes({0x89, 0x43, disp(reg)});
+            }
+
+            /** mov dword [rbx + reg], imm32 */
+            void store_immediate(mips::byte_t reg, uint32_t value) {
+                  if (reg == 0) return;
+                  bytes({0xC7, 0x43, disp(reg)});
+                  dword(value);
+            }
+
+            /** <op> eax, [rbx + reg] */
+            void alu_register(uint8_t opcode, mips::byte_t reg) { bytes({opcode, 0x43, disp(reg)}); }
+
+            /** <op> eax, imm32 */
+            void alu_immediate(uint8_t opcode, uint32_t value) {
+                  bytes({opcode});
+                  dword(value);
+            }
+
+            /** not eax */
+            void not_eax() { bytes({0xF7, 0xD0}); }
+
+            /** test eax, eax */
+            void test_eax() { bytes({0x85, 0xC0}); }
+
+            /** set<cc> al; movzx eax, al (takes the jcc condition code) */
+            void set_if(uint8_t condition) { bytes({0x0F, static_cast<uint8_t>(condition + 0x10), 0xC0, 0x0F, 0xB6, 0xC0}); }
+
+            /** <shift> eax, imm8 */
+            void shift_immediate(uint8_t kind, uint8_t amount) { bytes({0xC1, kind, amount}); }
+
+            /** <shift> eax, cl */
+            void shift_cl(uint8_t kind) { bytes({0xD3, kind}); }
+
+            /** mov rdi, r14; mov esi, eax (helper arguments: runtime, address) */
+            void helper_arguments() { bytes({0x4C, 0x89, 0xF7, 0x89, 0xC6}); }
+
+            /** mov rax, imm64; call rax */
+            void call(uint64_t function) {
+                  bytes({0x48, 0xB8});
+                  qword(function);
+                  bytes({0xFF, 0xD0});
+            }
+
+            /** cmp byte [r14 + offset], 0 */
+            void check_flag(uint8_t offset) { bytes({0x41, 0x80, 0x7E, offset, 0x00}); }
+
+            /** mov byte [r14 + offset], value */
+            void set_flag(uint8_t offset, uint8_t value) { bytes({0x41, 0xC6, 0x46, offset, value}); }
+
+            /** cmp r15, imm32 */
+            void compare_budget(uint32_t value) {
+                  bytes({0x49, 0x81, 0xFF});
+                  dword(value);
+            }
+
+            /** sub r15, imm32 */
+            void consume_budget(uint32_t value) {
+                  bytes({0x49, 0x81, 0xEF});
+                  dword(value);
+            }
+
+            /** add r15, imm32 */
+            void refund_budget(uint32_t value) {
+                  bytes({0x49, 0x81, 0xC7});
+                  dword(value);
+            }
+
+            /** mov eax, imm32 */
+            void load_pc(uint32_t value) {
+                  bytes({0xB8});
+                  dword(value);
+            }
+
+            /** jcc rel32, returns the displacement to patch */
+            mips::byte_t* jump_if(uint8_t condition) {
+                  bytes({0x0F, condition});
+                  mips::byte_t* displacement = cursor;
+                  dword(0);
+                  return displacement;
+            }
+
+            /** jmp rel32 */
+            void jump(const mips::byte_t* target) {
+                  bytes({0xE9});
+                  patch(cursor, target);
+                  cursor += 4;
+            }
+
+            /** Points a rel32 displacement at the given target */
+            static void patch(mips::byte_t* displacement, const mips::byte_t* target) {
+                  int32_t relative = static_cast<int32_t>(target - (displacement + 4));
+                  std::memcpy(displacement, &relative, sizeof(relative));
+            }
+
+      private:
+            static uint8_t disp(mips::byte_t reg) { return static_cast<uint8_t>(reg * sizeof(mips::register_t)); }
+
+            mips::byte_t* cursor;
+      };
+
+      /** Worst case size of a translated instruction, including its exit stub */
+      constexpr size_t MAX_INSTRUCTION_BYTES = 128;
+
+      /**
+       * @brief Checks if the JIT translates the given operation
+       *
+       * @param[i] op
+       * @return true/false
+       */
+      inline bool is_translatable(mips::Operation op) {
+            switch (op) {
+                  case mips::Operation::Add:
+                  case mips::Operation::Addu:
+                  case mips::Operation::Sub:
+                  case mips::Operation::Subu:
+                  case mips::Operation::And:
+                  case mips::Operation::Or:
+                  case mips::Operation::Xor:
+                  case mips::Operation::Nor:
+                  case mips::Operation::Slt:
+                  case mips::Operation::Sltu:
+                  case mips::Operation::Sll:
+                  case mips::Operation::Srl:
+                  case mips::Operation::Sra:
+                  case mips::Operation::Sllv:
+                  case mips::Operation::Srlv:
+                  case mips::Operation::Srav:
+                  case mips::Operation::Jr:
+                  case mips::Operation::Jalr:
+                  case mips::Operation::Lw:
+                  case mips::Operation::Sw:
+                  case mips::Operation::Addi:
+                  case mips::Operation::Addiu:
+                  case mips::Operation::Slti:
+                  case mips::Operation::Sltiu:
+                  case mips::Operation::Lui:
+                  case mips::Operation::Andi:
+                  case mips::Operation::Ori:
+                  case mips::Operation::Xori:
+                  case mips::Operation::Beq:
+                  case mips::Operation::Bne:
+                  case mips::Operation::Blez:
+                  case mips::Operation::Bgtz:
+                  case mips::Operation::Bltz:
+                  case mips::Operation::Bgez:
+                  case mips::Operation::J:
+                  case mips::Operation::Jal:
+                        return true;
+                  default:
+                        return false;
+            }
+      }
+
+      /**
+       * @brief Checks if the given operation ends a block
+       *
+       * @param[i] op
+       * @return true/false
+       */
+      inline bool ends_block(mips::Operation op) {
+            switch (op) {
+                  case mips::Operation::Jr:
+                  case mips::Operation::Jalr:
+                  case mips::Operation::Beq:
+                  case mips::Operation::Bne:
+                  case mips::Operation::Blez:
+                  case mips::Operation::Bgtz:
+                  case mips::Operation::Bltz:
+                  case mips::Operation::Bgez:
+                  case mips::Operation::J:
+                  case mips::Operation::Jal:
+                        return true;
+                  default:
+                        return false;
+            }
+      }
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @details Maps the code arena and emits the entry and exit trampolines at
+ *          its start.
+ *
+ * @throw std::runtime_error If the arena cannot be mapped
+ */
+mips::JitEngine::JitEngine(CPU* cpu, Memory* memory) {
+      this->cpu = cpu;
+      this->memory = memory;
+      this->code_version = memory->get_code_version();
+      this->runtime.remaining = 0;
+      this->runtime.fault = 0;
+      this->runtime.engine = this;
+
+      void* mapping = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapping == MAP_FAILED) throw std::runtime_error("Failed to map the JIT code arena");
+      arena = static_cast<byte_t*>(mapping);
+
+      Emitter e(arena);
+
+      /** Entry: save callee-saved registers, load the pinned ones, jump to the block */
+      e.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});     // push rbx, r12, r13, r14, r15
+      e.bytes({0x48, 0x89, 0xFB});                                           // mov rbx, rdi (registers)
+      e.bytes({0x49, 0x89, 0xF7});                                           // mov r15, rsi (budget)
+      e.bytes({0x49, 0x89, 0xD6});                                           // mov r14, rdx (runtime)
+      e.bytes({0xFF, 0xE1});                                                 // jmp rcx (block)
+
+      /** Exit: publish the budget and return the next program counter in eax */
+      epilogue = e.position();
+      e.bytes({0x4D, 0x89, 0x7E, static_cast<uint8_t>(offsetof(Runtime, remaining))});   // mov [r14 + remaining], r15
+      e.bytes({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});             // pop r15, r14, r13, r12, rbx; ret
+
+      code_start = e.position();
+      cursor = code_start;
+}
+
+/**
+ * @brief Destructor
+ */
+mips::JitEngine::~JitEngine() {
+      munmap(arena, JIT_ARENA_SIZE);
+}
+
+/**
+ * @brief Drops every translated block
+ */
+void mips::JitEngine::flush() {
+      blocks.clear();
+      pending_links.clear();
+      cursor = code_start;
+      code_version = memory->get_code_version();
+}
+
+/**
+ * @brief Reads a word on behalf of generated code
+ *
+ * @details Exceptions cannot unwind through generated code, so they are
+ *          parked and re-thrown by the dispatcher. Misaligned accesses and
+ *          access violations are left to the interpreter, which raises the
+ *          guest fault.
+ *
+ * @param[i] runtime
+ * @param[i] address
+ * @return word_t
+ */
+mips::word_t mips::JitEngine::read_word(Runtime* runtime, address_t address) {
+      if (address & (sizeof(word_t) - 1)) {
+            runtime->fault = Runtime::INTERPRET;
+            return 0;
+      }
+      try {
+            return runtime->engine->memory->read_word(address);
+      }
+      catch (const AccessViolation&) {
+            runtime->fault = Runtime::INTERPRET;
+            return 0;
+      }
+      catch (...) {
+            runtime->engine->exception = std::current_exception();
+            runtime->fault = Runtime::EXCEPTION;
+            return 0;
+      }
+}
+
+/**
+ * @brief Writes a word on behalf of generated code
+ *
+ * @param[i] runtime
+ * @param[i] address
+ * @param[i] value
+ * @return word_t Non-zero if generated code must return to the dispatcher
+ *                (the write faulted, was misaligned or landed on a code page)
+ */
+mips::word_t mips::JitEngine::write_word(Runtime* runtime, address_t address, word_t value) {
+      JitEngine* engine = runtime->engine;
+      if (address & (sizeof(word_t) - 1)) {
+            runtime->fault = Runtime::INTERPRET;
+            return 1;
+      }
+      try {
+            engine->memory->write_word(value, address);
+      }
+      catch (const AccessViolation&) {
+            runtime->fault = Runtime::INTERPRET;
+            return 1;
+      }
+      catch (...) {
+            engine->exception = std::current_exception();
+            runtime->fault = Runtime::EXCEPTION;
+            return 1;
+      }
+      return engine->memory->get_code_version() != engine->code_version;
+}
+
+/**
+ * @brief Chains a block exit to its target
+ *
+ * @param[i] exit
+ * @param[i] target
+ */
+void mips::JitEngine::link(byte_t* exit, address_t target) {
+      auto it = blocks.find(target);
+      if (it == blocks.end()) {
+            pending_links[target].push_back(exit);
+            return;
+      }
+
+      /** Targets that need the interpreter keep returning to the dispatcher */
+      if (it->second.code == nullptr) return;
+
+      /** Overwrite "mov eax, target" with "jmp block" (both 5 bytes) */
+      Emitter(exit).jump(it->second.code);
+}
+
+/**
+ * @brief Returns the block starting at the given address
+ *
+ * @param[i] pc
+ * @return Block&
+ */
+mips::JitEngine::Block& mips::JitEngine::lookup(address_t pc) {
+      auto it = blocks.find(pc);
+      if (it != blocks.end()) return it->second;
+      return translate(pc);
+}
+
+/**
+ * @brief Translates the block starting at the given address
+ *
+ * @details Layout of a block:
+ *
+ *            cmp r15, length; jb <budget exit>; sub r15, length
+ *            <instructions>
+ *            <fall through / jump exit>
+ *            <side exits>
+ *
+ *          Every exit loads the next program counter into eax and jumps to
+ *          the epilogue. Exits to known addresses start with a 5 byte
+ *          "mov eax, imm32" which link() later turns into a direct jump.
+ *          Side exits taken before the end of the block refund the budget
+ *          of the instructions that did not run. Exits taken because an
+ *          instruction cannot complete natively (it overflowed or accessed
+ *          misaligned memory) flag the runtime, so the dispatcher hands
+ *          that instruction to the interpreter.
+ *
+ * @param[i] pc
+ * @return Block&
+ */
+mips::JitEngine::Block& mips::JitEngine::translate(address_t pc) {
+      if (cursor + JIT_MAX_BLOCK_LENGTH * MAX_INSTRUCTION_BYTES > arena + JIT_ARENA_SIZE) {
+            flush();
+      }
+
+      /** Decode up to the first control transfer or untranslatable instruction */
+      std::vector<DecodedInstruction> instructions;
+      address_t address = pc;
+      while (instructions.size() < JIT_MAX_BLOCK_LENGTH) {
+            DecodedInstruction decoded;
+            try {
+                  cpu->decode(cpu->fetch(address), decoded);
+            } catch (const AccessViolation&) {
+                  /** Not executable; the interpreter raises the fault when it gets there */
+                  break;
+            }
+            if (!is_translatable(decoded.op)) break;
+
+            decoded.pc = address;
+            instructions.push_back(decoded);
+            address += sizeof(instruction_t);
+
+            if (ends_block(decoded.op)) break;
+      }
+
+      Block& block = blocks[pc];
+      block.length = instructions.size();
+      block.code = nullptr;
+
+      if (instructions.empty()) {
+            pending_links.erase(pc);
+            return block;
+      }
+
+      struct Exit {
+            byte_t* displacement;   /** jcc to patch */
+            address_t pc;           /** Next program counter */
+            uint32_t refund;        /** Budget of the instructions skipped */
+            bool chain;             /** Whether the exit can become a direct jump */
+            byte_t fault;           /** Runtime fault flag to raise, if any */
+      };
+      std::vector<Exit> exits;
+      std::vector<std::pair<byte_t*, address_t>> chained;
+
+      Emitter e(cursor);
+      byte_t* code = e.position();
+      const uint32_t length = static_cast<uint32_t>(instructions.size());
+
+      /** Leave untouched if the block does not fit in the budget */
+      e.compare_budget(length);
+      exits.push_back({e.jump_if(JB), pc, 0, false, 0});
+      e.consume_budget(length);
+
+      address_t next = address;
+      bool indirect = false;      /** The block ends in a jump to a register (target in eax) */
+      for (uint32_t i = 0; i < length; i++) {
+            const DecodedInstruction& d = instructions[i];
+            const address_t following = d.pc + sizeof(instruction_t);
+            const address_t branch_target = following + (d.immediate << 2);
+
+            /** Leaves before the instruction at i completes, for the interpreter to rerun it */
+            auto interpret_exit = [&](uint8_t condition) {
+                  exits.push_back({e.jump_if(condition), following, length - i - 1, false, Runtime::INTERPRET});
+            };
+            auto alu = [&](uint8_t opcode) {
+                  e.load(d.rs);
+                  e.alu_register(opcode, d.rt);
+                  e.store(d.rd);
+            };
+            auto alu_immediate = [&](uint8_t opcode) {
+                  e.load(d.rs);
+                  e.alu_immediate(opcode, d.immediate);
+                  e.store(d.rt);
+            };
+            auto compare = [&](uint8_t condition) {
+                  e.load(d.rs);
+                  e.alu_register(CMP_REG, d.rt);
+                  e.set_if(condition);
+                  e.store(d.rd);
+            };
+            auto compare_immediate = [&](uint8_t condition) {
+                  e.load(d.rs);
+                  e.alu_immediate(CMP_IMM, d.immediate);
+                  e.set_if(condition);
+                  e.store(d.rt);
+            };
+            auto shift = [&](uint8_t kind) {
+                  e.load(d.rt);
+                  e.shift_immediate(kind, d.shamt);
+                  e.store(d.rd);
+            };
+            auto shift_variable = [&](uint8_t kind) {
+                  e.load_ecx(d.rs);
+                  e.load(d.rt);
+                  e.shift_cl(kind);
+                  e.store(d.rd);
+            };
+            auto branch_on_sign = [&](uint8_t condition) {
+                  e.load(d.rs);
+                  e.test_eax();
+                  exits.push_back({e.jump_if(condition), branch_target, 0, true, 0});
+            };
+            auto branch_on_compare = [&](uint8_t condition) {
+                  e.load(d.rs);
+                  e.alu_register(CMP_REG, d.rt);
+                  exits.push_back({e.jump_if(condition), branch_target, 0, true, 0});
+            };
+
+            switch (d.op) {
+                  case Operation::Add:
+                        e.load(d.rs);
+                        e.alu_register(ADD_REG, d.rt);
+                        interpret_exit(JO);
+                        e.store(d.rd);
+                        break;
+                  case Operation::Addu:   alu(ADD_REG); break;
+                  case Operation::Sub:
+                        e.load(d.rs);
+                        e.alu_register(SUB_REG, d.rt);
+                        interpret_exit(JO);
+                        e.store(d.rd);
+                        break;
+                  case Operation::Subu:   alu(SUB_REG); break;
+                  case Operation::And:    alu(AND_REG); break;
+                  case Operation::Or:     alu(OR_REG); break;
+                  case Operation::Xor:    alu(XOR_REG); break;
+                  case Operation::Nor:
+                        e.load(d.rs);
+                        e.alu_register(OR_REG, d.rt);
+                        e.not_eax();
+                        e.store(d.rd);
+                        break;
+                  case Operation::Slt:    compare(JL); break;
+                  case Operation::Sltu:   compare(JB); break;
+                  case Operation::Sll:    shift(SHL); break;
+                  case Operation::Srl:    shift(SHR); break;
+                  case Operation::Sra:    shift(SAR); break;
+                  case Operation::Sllv:   shift_variable(SHL); break;
+                  case Operation::Srlv:   shift_variable(SHR); break;
+                  case Operation::Srav:   shift_variable(SAR); break;
+                  case Operation::Jr:
+                        e.load(d.rs);
+                        indirect = true;
+                        break;
+                  case Operation::Jalr:
+                        e.load(d.rs);
+                        e.store_immediate(d.rd, following);
+                        indirect = true;
+                        break;
+                  case Operation::Lw:
+                        e.load(d.rs);
+                        e.alu_immediate(ADD_IMM, d.immediate);
+                        e.helper_arguments();
+                        e.call(reinterpret_cast<uint64_t>(&JitEngine::read_word));
+                        e.check_flag(offsetof(Runtime, fault));
+                        exits.push_back({e.jump_if(JNE), following, length - i - 1, false, 0});
+                        e.store(d.rt);
+                        break;
+                  case Operation::Sw:
+                        e.load(d.rs);
+                        e.alu_immediate(ADD_IMM, d.immediate);
+                        e.helper_arguments();
+                        e.load_edx(d.rt);
+                        e.call(reinterpret_cast<uint64_t>(&JitEngine::write_word));
+                        e.test_eax();
+                        exits.push_back({e.jump_if(JNE), following, length - i - 1, false, 0});
+                        break;
+                  case Operation::Addi:
+                        e.load(d.rs);
+                        e.alu_immediate(ADD_IMM, d.immediate);
+                        interpret_exit(JO);
+                        e.store(d.rt);
+                        break;
+                  case Operation::Addiu:  alu_immediate(ADD_IMM); break;
+                  case Operation::Slti:   compare_immediate(JL); break;
+                  case Operation::Sltiu:  compare_immediate(JB); break;
+                  case Operation::Lui:
+                        e.store_immediate(d.rt, d.immediate << 16);
+                        break;
+                  case Operation::Andi:   alu_immediate(AND_IMM); break;
+                  case Operation::Ori:    alu_immediate(OR_IMM); break;
+                  case Operation::Xori:   alu_immediate(XOR_IMM); break;
+                  case Operation::Beq:    branch_on_compare(JE); break;
+                  case Operation::Bne:    branch_on_compare(JNE); break;
+                  case Operation::Blez:   branch_on_sign(JLE); break;
+                  case Operation::Bgtz:   branch_on_sign(JG); break;
+                  case Operation::Bltz:   branch_on_sign(JL); break;
+                  case Operation::Bgez:   branch_on_sign(JGE); break;
+                  case Operation::J:
+                        next = (following & JUMP_REGION_MASK) | d.immediate;
+                        break;
+                  case Operation::Jal:
+                        e.store_immediate(31, following);
+                        next = (following & JUMP_REGION_MASK) | d.immediate;
+                        break;
+                  default:
+                        throw std::runtime_error("Untranslatable instruction in JIT block");
+            }
+      }
+
+      /** Fall through (or jump) exit; register jumps already hold their target in eax */
+      if (!indirect) {
+            chained.push_back({e.position(), next});
+            e.load_pc(next);
+      }
+      e.jump(epilogue);
+
+      /** Side exits */
+      for (const Exit& exit : exits) {
+            Emitter::patch(exit.displacement, e.position());
+            if (exit.refund != 0) e.refund_budget(exit.refund);
+            if (exit.fault != 0) e.set_flag(offsetof(Runtime, fault), exit.fault);
+            if (exit.chain) chained.push_back({e.position(), exit.pc});
+            e.load_pc(exit.pc);
+            e.jump(epilogue);
+      }
+
+      cursor = e.position();
+      block.code = code;
+
+      /** Resolve exits of other blocks waiting on this one, then our own */
+      auto pending = pending_links.find(pc);
+      if (pending != pending_links.end()) {
+            for (byte_t* exit : pending->second) Emitter(exit).jump(code);
+            pending_links.erase(pending);
+      }
+      for (const auto& [exit, target] : chained) {
+            link(exit, target);
+      }
+
+      return block;
+}
+
+/**
+ * @brief Runs the CPU in native code only
+ *
+ * @param[i] budget
+ * @return uint64_t
+ */
+uint64_t mips::JitEngine::run_native(uint64_t budget) {
+      const entry_t enter = reinterpret_cast<entry_t>(arena);
+      uint64_t remaining = budget;
+
+      while (remaining > 0) {
+            /** The program wrote to a page we translated from */
+            if (code_version != memory->get_code_version()) {
+                  flush();
+            }
+
+            const address_t pc = cpu->pc;
+            const Block& block = lookup(pc);
+            if (block.code == nullptr) break;
+
+            runtime.fault = 0;
+            const address_t next = enter(cpu->registers, remaining, &runtime, block.code);
+
+            /** Fault exits report the instruction after the faulting one */
+            if (runtime.fault == Runtime::INTERPRET) {
+                  cpu->pc = next - sizeof(instruction_t);
+                  remaining = runtime.remaining + 1;
+                  break;
+            }
+            if (runtime.fault) {
+                  cpu->pc = next - sizeof(instruction_t);
+                  std::exception_ptr fault = exception;
+                  exception = nullptr;
+                  std::rethrow_exception(fault);
+            }
+
+            cpu->pc = next;
+
+            /** The block did not fit in the budget */
+            if (runtime.remaining == remaining && next == pc) break;
+            remaining = runtime.remaining;
+      }
+
+      return budget - remaining;
+}
+
+/**
+ * @brief Runs the CPU
+ *
+ * @param[i] budget
+ * @return uint64_t
+ */
+uint64_t mips::JitEngine::run(uint64_t budget) {
+      uint64_t retired = 0;
+      while (retired < budget && cpu->status == Status::Running) {
+            retired += run_native(budget - retired);
+            if (retired < budget) {
+                  cpu->step();
+                  if (cpu->status == Status::Faulted) break;
+                  retired++;
+            }
+      }
+      return retired;
+}
+
+#else
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Hosts without a code generator drive the interpreter */
+
+mips::JitEngine::JitEngine(CPU* cpu, Memory* memory) {
+      this->cpu = cpu;
+      this->memory = memory;
+      this->code_version = memory->get_code_version();
+}
+
+mips::JitEngine::~JitEngine() {}
+
+void mips::JitEngine::flush() {}
+
+uint64_t mips::JitEngine::run_native([[maybe_unused]] uint64_t budget) {
+      return 0;
+}
+
+uint64_t mips::JitEngine::run(uint64_t budget) {
+      return cpu->run(budget);
+}
+
+#endif // MIPS_HAS_JIT
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,178 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <array>
+
+/** Mips Includes */
+#include <lexer.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Character classes */
+constexpr mips::byte_t BLANK = 1 << 0;    /** Skipped between tokens */
+constexpr mips::byte_t WORD  = 1 << 1;    /** Part of identifiers, registers and numbers */
+constexpr mips::byte_t START = 1 << 2;    /** Starts an identifier */
+constexpr mips::byte_t DIGIT = 1 << 3;
+
+/**
+ * @brief Builds the character class table
+ *
+ * @return std::array<mips::byte_t, 256>
+ */
+static constexpr std::array<mips::byte_t, 256> make_classes() {
+      std::array<mips::byte_t, 256> classes = {};
+      classes[' '] = classes['\t'] = classes['\r'] = classes['\v'] = classes['\f'] = BLANK;
+      for (int c = 'a'; c <= 'z'; c++) classes[c] = WORD | START;
+      for (int c = 'A'; c <= 'Z'; c++) classes[c] = WORD | START;
+      for (int c = '0'; c <= '9'; c++) classes[c] = WORD | DIGIT;
+      classes['_'] = WORD | START;
+      classes['.'] = WORD;
+      return classes;
+}
+
+static constexpr std::array<mips::byte_t, 256> classes = make_classes();
+
+/**
+ * @brief Returns the class of a character
+ *
+ * @param[i] c
+ * @return mips::byte_t
+ */
+static inline mips::byte_t class_of(char c) {
+      return classes[static_cast<mips::byte_t>(c)];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Reads the next token
+ *
+ * @return Token
+ */
+mips::Token mips::Lexer::next() {
+      if (this->line_ended) {
+            this->line++;
+            this->line_ended = false;
+      }
+
+      while (this->cursor != this->end && (class_of(*this->cursor) & BLANK)) this->cursor++;
+      if (this->cursor != this->end && *this->cursor == '#') {
+            while (this->cursor != this->end && *this->cursor != '\n') this->cursor++;
+      }
+      if (this->cursor == this->end) return { TokenKind::EndOfFile, std::string_view() };
+
+      const char* start = this->cursor++;
+      auto token = [&](TokenKind kind) {
+            return Token{ kind, std::string_view(start, this->cursor - start) };
+      };
+      auto skip_word = [&]() {
+            while (this->cursor != this->end && (class_of(*this->cursor) & WORD)) this->cursor++;
+      };
+
+      switch (*start) {
+            case '\n':
+                  this->line_ended = true;
+                  return token(TokenKind::EndOfLine);
+            case ',':
+                  return token(TokenKind::Comma);
+            case '(':
+                  return token(TokenKind::LeftParen);
+            case ')':
+                  return token(TokenKind::RightParen);
+            case '"':
+                  while (this->cursor != this->end && *this->cursor != '"' && *this->cursor != '\n') {
+                        if (*this->cursor == '\\' && this->cursor + 1 != this->end) this->cursor++;
+                        this->cursor++;
+                  }
+                  if (this->cursor == this->end || *this->cursor != '"') return token(TokenKind::Invalid);
+                  this->cursor++;
+                  return token(TokenKind::String);
+            case '$':
+                  skip_word();
+                  return token(TokenKind::Register);
+            case '-':
+            case '+':
+                  if (this->cursor == this->end || !(class_of(*this->cursor) & DIGIT)) return token(TokenKind::Invalid);
+                  skip_word();
+                  return token(TokenKind::Number);
+            default:
+                  break;
+      }
+
+      byte_t type = class_of(*start);
+      if (type & DIGIT) {
+            skip_word();
+            return token(TokenKind::Number);
+      }
+      if (!(type & START) && *start != '.') return token(TokenKind::Invalid);
+
+      skip_word();
+      if (this->cursor != this->end && *this->cursor == ':') {
+            Token label = token(TokenKind::Label);
+            this->cursor++;
+            return label;
+      }
+      return token(*start == '.' ? TokenKind::Directive : TokenKind::Identifier);
+}
+
+/**
+ * @brief Parses an integer token
+ *
+ * @param[i] text
+ * @param[o] value
+ * @return true/false
+ */
+bool mips::parse_integer(std::string_view text, int64_t& value) {
+      bool negative = false;
+      if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+            negative = text[0] == '-';
+            text.remove_prefix(1);
+      }
+
+      uint64_t base = 10;
+      if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            base = 16;
+            text.remove_prefix(2);
+      }
+      if (text.empty()) return false;
+
+      uint64_t magnitude = 0;
+      for (char c : text) {
+            uint64_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return false;
+
+            if (digit >= base) return false;
+            magnitude = magnitude * base + digit;
+            if (magnitude > UINT32_MAX) return false;
+      }
+
+      value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+      return true;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -3,12 +3,22 @@
 //
 
 /** C++ Includes */
+#include <fstream>
 #include <iostream>
+#include <memory>
 
 /** MIPS++ Includes */
 #include <assembler.hpp>
+#include <batch.hpp>
+#include <cache.hpp>
 #include <emulator.hpp>
 #include <except.hpp>
+#include <file.hpp>
+#include <obj.hpp>
+#include <pipeline.hpp>
+#include <predictor.hpp>
+#include <trace.hpp>
+#include <profiler.hpp>
 
 #define DEBUG 1
 #define VERSION "0.0.1"
@@ -22,18 +32,297 @@ void print_help() {
       std::cout << "  -c, --compile\t\t\tCompiles the given file" << std::endl;
       std::cout << "  -r, --run\t\t\tRuns the given file" << std::endl;
       std::cout << "  -d, --debug\t\t\tDebugs the given file" << std::endl;
+      std::cout << "  -b, --batch\t\t\tRuns every binary of a directory or list file in parallel" << std::endl;
+      std::cout << "  -t, --dump-trace\t\tPrints a trace written by --trace as text" << std::endl;
       std::cout << "  -v, --version\t\t\tPrints the version" << std::endl;
       std::cout << std::endl;
+      std::cout << "Emulator options (-r, -d, -b):" << std::endl;
+      std::cout << "  --memory <backend>\t\tMemory backend: paged (default), mmap or mmap-huge" << std::endl;
+      std::cout << "  --engine <engine>\t\tExecution engine: interpreter (default), threaded, jit, lockstep or lockstep-jit" << std::endl;
+      std::cout << std::endl;
+      std::cout << "Run options (-r):" << std::endl;
+      std::cout << "  --profile <file>\t\tWrites a hot-spot report to <file> and folded stacks to <file>.folded (interpreter only)" << std::endl;
+      std::cout << "  --cache <config>\t\tSimulates the caches and prints their statistics to stderr (interpreter only)," << std::endl;
+      std::cout << "\t\t\t\t'default' or e.g. l1i=32k:4:64:lru,l1d=32k:8:64:lru,l2=256k:8:64:lru" << std::endl;
+      std::cout << "  --pipeline\t\t\tEstimates cycles and stalls on a five-stage pipeline and prints them to stderr (interpreter only)" << std::endl;
+      std::cout << "  --branch <predictor>\t\tSimulates branch prediction and prints misprediction rates to stderr (interpreter only)," << std::endl;
+      std::cout << "\t\t\t\tstatic, bimodal, gshare or tournament, with a BTB and a return address stack" << std::endl;
+      std::cout << "  --trace <file>\t\tRecords retired instructions, register writes and memory accesses to <file> (interpreter only)" << std::endl;
+      std::cout << std::endl;
+      std::cout << "Assembler and batch options (-c, -b):" << std::endl;
+      std::cout << "  --threads <n>\t\t\tWorker threads (default: one per core)" << std::endl;
+      std::cout << std::endl;
+      std::cout << "Batch options (-b):" << std::endl;
+      std::cout << "  --budget <n>\t\t\tInstruction budget per program" << std::endl;
+      std::cout << "  --timeout <ms>\t\tWall clock limit per program" << std::endl;
+      std::cout << "  --report <file>\t\tWrites the report to a file (.csv for CSV, JSON otherwise)" << std::endl;
+      std::cout << std::endl;
       std::cout << "Examples:" << std::endl;
       std::cout << "  Assembling a file:" << std::endl;
-      std::cout << "    mips++ -c <filename> <output>" << std::endl << std::endl;
+      std::cout << "    mips++ -c <filename> <output> [--threads <n>]" << std::endl << std::endl;
       std::cout << "  Running a MIPS executable:" << std::endl;
-      std::cout << "    mips++ -r <filename>" << std::endl << std::endl;
+      std::cout << "    mips++ -r <filename> [--memory <backend>] [--engine <engine>] [--profile <file> | --cache <config> --pipeline --branch <predictor> --trace <file>]" << std::endl << std::endl;
       std::cout << "  Debugging a MIPS executable:" << std::endl;
       std::cout << "    mips++ -d <filename>" << std::endl << std::endl;
+      std::cout << "  Running a batch of MIPS executables:" << std::endl;
+      std::cout << "    mips++ -b <dir|list> [--threads <n>] [--budget <n>] [--timeout <ms>] [--report <file>]" << std::endl << std::endl;
+      std::cout << "  Printing an execution trace:" << std::endl;
+      std::cout << "    mips++ -t <trace>" << std::endl << std::endl;
       exit(0);
 }
 
+/**
+ * @brief Returns the value following the given option, if present
+ * 
+ * @details Options are looked up after the input file.
+ * 
+ * @param argc 
+ * @param argv 
+ * @param option 
+ * @return const char* The value or nullptr
+ */
+const char* find_option(int argc, char** argv, const std::string& option) {
+      for (int i = 3; i < argc - 1; i++) {
+            if (option == argv[i]) return argv[i + 1];
+      }
+      return nullptr;
+}
+
+/**
+ * @brief Checks whether the given flag is present
+ * 
+ * @details Flags are looked up after the input file.
+ * 
+ * @param argc 
+ * @param argv 
+ * @param flag 
+ * @return bool 
+ */
+bool has_flag(int argc, char** argv, const std::string& flag) {
+      for (int i = 3; i < argc; i++) {
+            if (flag == argv[i]) return true;
+      }
+      return false;
+}
+
+/**
+ * @brief Parses the --memory option
+ * 
+ * @param argc 
+ * @param argv 
+ * @return mips::MemoryBackend 
+ */
+mips::MemoryBackend parse_memory_backend(int argc, char** argv) {
+      const char* value = find_option(argc, argv, "--memory");
+      if (value == nullptr) return mips::MemoryBackend::Paged;
+
+      std::string backend(value);
+      if (backend == "paged") return mips::MemoryBackend::Paged;
+      if (backend == "mmap") return mips::MemoryBackend::Mapped;
+      if (backend == "mmap-huge") return mips::MemoryBackend::MappedHuge;
+
+      std::cout << "Error: Unknown memory backend '" << backend << "'" << std::endl;
+      exit(1);
+}
+
+/**
+ * @brief Parses the --engine option
+ * 
+ * @param argc 
+ * @param argv 
+ * @return mips::Engine 
+ */
+mips::Engine parse_engine(int argc, char** argv) {
+      const char* value = find_option(argc, argv, "--engine");
+      if (value == nullptr) return mips::Engine::Interpreter;
+
+      std::string engine(value);
+      if (engine == "interpreter") return mips::Engine::Interpreter;
+      if (engine == "threaded") return mips::Engine::Threaded;
+      if (engine == "lockstep") return mips::Engine::Lockstep;
+      if (engine == "jit") return mips::Engine::Jit;
+      if (engine == "lockstep-jit") return mips::Engine::LockstepJit;
+
+      std::cout << "Error: Unknown engine '" << engine << "'" << std::endl;
+      exit(1);
+}
+
+/**
+ * @brief Parses a numeric option
+ * 
+ * @param argc 
+ * @param argv 
+ * @param option 
+ * @param fallback The value if the option is absent
+ * @return uint64_t 
+ */
+uint64_t parse_number(int argc, char** argv, const std::string& option, uint64_t fallback) {
+      const char* value = find_option(argc, argv, option);
+      if (value == nullptr) return fallback;
+
+      try {
+            return std::stoull(value);
+      }
+      catch (const std::exception&) {
+            std::cout << "Error: Invalid value '" << value << "' for " << option << std::endl;
+            exit(1);
+      }
+}
+
+/**
+ * @brief Runs a batch and writes its report
+ * 
+ * @param argc 
+ * @param argv 
+ * @return int 0 if every program exited, 1 otherwise
+ */
+int run_batch(int argc, char** argv) {
+      mips::BatchOptions options;
+      options.threads = parse_number(argc, argv, "--threads", 0);
+      options.budget = parse_number(argc, argv, "--budget", UINT64_MAX);
+      options.timeout_ms = parse_number(argc, argv, "--timeout", 0);
+      options.backend = parse_memory_backend(argc, argv);
+      options.engine = parse_engine(argc, argv);
+
+      std::vector<mips::TaskResult> results = mips::run_batch(mips::collect_batch(argv[2]), options);
+
+      const char* report = find_option(argc, argv, "--report");
+      if (report == nullptr) {
+            mips::write_json_report(std::cout, results);
+      }
+      else {
+            std::ofstream file(report);
+            if (!file.is_open()) throw mips::FileException("Failed to open " + std::string(report));
+
+            std::string name(report);
+            if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0) mips::write_csv_report(file, results);
+            else mips::write_json_report(file, results);
+      }
+
+      for (const mips::TaskResult& result : results) {
+            if (result.status != mips::TaskStatus::Halted) return 1;
+      }
+      return 0;
+}
+
+/**
+ * @brief Runs a program under the profiler and writes its reports
+ * 
+ * @param argc 
+ * @param argv 
+ * @param output The report file (folded stacks go to output + ".folded")
+ * @return int The exit code of the program
+ * @throw mips::RuntimeException If the program faults (after writing the reports)
+ */
+int run_profiled(int argc, char** argv, const std::string& output) {
+      mips::Emulator emulator(parse_memory_backend(argc, argv), mips::Engine::Interpreter);
+      emulator.prepare_and_hold(argv[2]);
+
+      mips::Profiler profiler(&emulator.get_memory(), emulator.get_cpu().get_pc());
+      {
+            mips::MappedFile binary(argv[2]);
+            profiler.set_debug_info(mips::read_mips_debug_info(binary.contents()));
+      }
+      mips::RunResult result = emulator.profile(profiler);
+
+      std::ofstream report(output);
+      if (!report.is_open()) throw mips::FileException("Failed to open " + output);
+      profiler.write_report(report);
+
+      std::ofstream folded(output + ".folded");
+      if (!folded.is_open()) throw mips::FileException("Failed to open " + output + ".folded");
+      profiler.write_folded(folded);
+
+      if (result.status == mips::RunStatus::Faulted) throw mips::RuntimeException(emulator.get_cpu().get_fault_message());
+      return emulator.get_exit_code();
+}
+
+/**
+ * @brief Runs a program through the cache simulator, the pipeline timing
+ *        model, the branch prediction model and/or the trace recorder and
+ *        prints their statistics
+ * 
+ * @tparam Predictor The direction predictor of the branch model
+ * @param argc 
+ * @param argv 
+ * @param cache The hierarchy description (see mips::parse_cache_config()), or nullptr
+ * @param timing Whether to run the pipeline timing model
+ * @param predict Whether to run the branch prediction model
+ * @param trace The trace file, or nullptr
+ * @return int The exit code of the program
+ * @throw mips::RuntimeException If the program faults (after printing the statistics)
+ */
+template <typename Predictor>
+int run_modelled(int argc, char** argv, const char* cache, bool timing, bool predict, const char* trace) {
+      mips::Emulator emulator(parse_memory_backend(argc, argv), mips::Engine::Interpreter);
+      emulator.prepare_and_hold(argv[2]);
+
+      std::unique_ptr<mips::CacheHierarchy> caches;
+      if (cache != nullptr) caches = std::make_unique<mips::CacheHierarchy>(mips::parse_cache_config(cache), &emulator.get_memory());
+      mips::PipelineModel pipeline;
+      mips::BranchModel<Predictor> branches(&emulator.get_memory());
+      std::unique_ptr<mips::TraceRecorder> recorder;
+      if (trace != nullptr) recorder = std::make_unique<mips::TraceRecorder>(trace);
+
+      /** The host predicts these perfectly, the models themselves are inlined */
+      mips::RunResult result = emulator.inspect([&](const mips::CPU& cpu, const mips::DecodedInstruction& decoded) {
+            if (caches != nullptr) (*caches)(cpu, decoded);
+            if (timing) pipeline(cpu, decoded);
+            if (predict) branches(cpu, decoded);
+            if (recorder != nullptr) (*recorder)(cpu, decoded);
+      });
+
+      const char* separator = "";
+      if (caches != nullptr) {
+            caches->write_report(std::cerr);
+            separator = "\n";
+      }
+      if (timing) {
+            std::cerr << separator;
+            pipeline.write_report(std::cerr);
+            separator = "\n";
+      }
+      if (predict) {
+            std::cerr << separator;
+            branches.write_report(std::cerr);
+            separator = "\n";
+      }
+      if (recorder != nullptr) {
+            recorder->finish(emulator.get_cpu());
+            std::cerr << separator << "Trace: " << recorder->get_records() << " instructions, " << recorder->get_bytes() << " bytes" << std::endl;
+      }
+
+      if (result.status == mips::RunStatus::Faulted) throw mips::RuntimeException(emulator.get_cpu().get_fault_message());
+      return emulator.get_exit_code();
+}
+
+/**
+ * @brief Picks the branch predictor of run_modelled()
+ * 
+ * @param argc 
+ * @param argv 
+ * @param cache The hierarchy description, or nullptr
+ * @param timing Whether to run the pipeline timing model
+ * @param predictor The direction predictor (see mips::parse_predictor()), or nullptr
+ * @param trace The trace file, or nullptr
+ * @return int The exit code of the program
+ */
+int run_modelled(int argc, char** argv, const char* cache, bool timing, const char* predictor, const char* trace) {
+      if (predictor == nullptr) return run_modelled<mips::StaticPredictor>(argc, argv, cache, timing, false, trace);
+
+      switch (mips::parse_predictor(predictor)) {
+            case mips::PredictorKind::Static:
+                  return run_modelled<mips::StaticPredictor>(argc, argv, cache, timing, true, trace);
+            case mips::PredictorKind::Bimodal:
+                  return run_modelled<mips::BimodalPredictor>(argc, argv, cache, timing, true, trace);
+            case mips::PredictorKind::Gshare:
+                  return run_modelled<mips::GsharePredictor>(argc, argv, cache, timing, true, trace);
+            case mips::PredictorKind::Tournament:
+                  return run_modelled<mips::TournamentPredictor>(argc, argv, cache, timing, true, trace);
+      }
+      return 1;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -53,6 +342,12 @@ void print_help() {
  * 
  *    Debugging a MIPS executable:
  *    ./mips++ -d <filename>
+ * 
+ *    Running a batch of MIPS executables:
+ *    ./mips++ -b <dir|list>
+ * 
+ *    Printing an execution trace:
+ *    ./mips++ -t <trace>
  */
 int main(int argc, char** argv) {
       if (argc < 2) {
@@ -73,9 +368,23 @@ int main(int argc, char** argv) {
             }
 
             try {
-                  mips::Emulator emulator;
+                  const char* profile = find_option(argc, argv, "--profile");
+                  const char* cache = find_option(argc, argv, "--cache");
+                  const bool timing = has_flag(argc, argv, "--pipeline");
+                  const char* predictor = find_option(argc, argv, "--branch");
+                  const char* trace = find_option(argc, argv, "--trace");
+                  const bool modelled = cache != nullptr || timing || predictor != nullptr || trace != nullptr;
+                  if (profile != nullptr && modelled) {
+                        std::cout << "Error: --profile cannot be combined with --cache, --pipeline, --branch or --trace" << std::endl;
+                        return 1;
+                  }
+                  if (profile != nullptr) return run_profiled(argc, argv, profile);
+                  if (modelled) return run_modelled(argc, argv, cache, timing, predictor, trace);
+
+                  mips::Emulator emulator(parse_memory_backend(argc, argv), parse_engine(argc, argv));
                   emulator.prepare_and_hold(argv[2]);
                   emulator.run();
+                  return emulator.get_exit_code();
             }
             catch(const mips::SyntaxException& e) {
                   std::cout << "Syntax error: " << e.what() << std::endl;
@@ -99,7 +408,7 @@ int main(int argc, char** argv) {
             }
 
             try {
-                  mips::Emulator emulator;
+                  mips::Emulator emulator(parse_memory_backend(argc, argv), parse_engine(argc, argv));
                   emulator.prepare_and_hold(argv[2]);
                   emulator.cli();
             }
@@ -118,6 +427,36 @@ int main(int argc, char** argv) {
             
             return 0;
       }
+      else if (std::string(argv[1]) == "-b" || std::string(argv[1]) == "--batch") {
+            if (argc < 3) {
+                  std::cout << "Error: No directory or list specified" << std::endl;
+                  exit(1);
+            }
+
+            try {
+                  return run_batch(argc, argv);
+            }
+            catch(const std::exception& e) {
+                  std::cout << "Error: " << e.what() << std::endl;
+                  return 1;
+            }
+      }
+      else if (std::string(argv[1]) == "-t" || std::string(argv[1]) == "--dump-trace") {
+            if (argc < 3) {
+                  std::cout << "Error: No trace specified" << std::endl;
+                  exit(1);
+            }
+
+            try {
+                  mips::dump_trace(argv[2], std::cout);
+            }
+            catch(const std::exception& e) {
+                  std::cout << "Error: " << e.what() << std::endl;
+                  return 1;
+            }
+
+            return 0;
+      }
       else if (std::string(argv[1]) == "-c" || std::string(argv[1]) == "--compile") {
             if (argc < 4) {
                   std::cout << "Error: No file specified" << std::endl;
@@ -125,7 +464,7 @@ int main(int argc, char** argv) {
             }
 
             try {
-                  mips::Assembler assembler;
+                  mips::Assembler assembler(parse_number(argc, argv, "--threads", 0));
                   assembler.assemble(argv[2], argv[3]);
             }
             catch(const mips::SyntaxException& e) {
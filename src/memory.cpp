@@ -3,127 +3,559 @@
 //
 
 /** C++ Includes */
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+/** System Includes */
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define MIPS_HAS_MMAP 1
+#if defined(__APPLE__)
+using mincore_t = char;
+#else
+using mincore_t = unsigned char;
+#endif
+#endif
 
 /** Mips Includes */
 #include <memory.hpp>
+#include <except.hpp>
+
+/** Shared page backing every untouched region of the address space */
+static const std::array<mips::byte_t, mips::PAGE_SIZE> zero_page = {};
+
+/** 
+ * The reservation has one spare page past the top of the address space so
+ * accesses straddling 0xFFFFFFFF stay inside the mapping.
+ */
+constexpr size_t MAPPING_SIZE = mips::MAX_MEMORY + mips::PAGE_SIZE;
 
 /**
  * @brief Constructor
+ * 
+ * @details The paged backend allocates nothing up front, untouched pages read
+ *          from the shared zero page. The mapped backends reserve the address
+ *          space without committing it, the kernel zero-fills pages on first
+ *          touch.
+ * 
+ * @param[i] backend
+ * @throw std::runtime_error If the address space cannot be reserved
+ */
+mips::Memory::Memory(MemoryBackend backend) : backend(backend) {
+      flush_tlb();
+      if (backend == MemoryBackend::Paged) return;
+
+#if MIPS_HAS_MMAP
+      void* mapping = mmap(nullptr, MAPPING_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (mapping == MAP_FAILED) throw std::runtime_error("Failed to reserve the guest address space");
+      base = static_cast<byte_t*>(mapping);
+
+      if (backend == MemoryBackend::MappedHuge) {
+#ifdef MADV_HUGEPAGE
+            madvise(base, MAPPING_SIZE, MADV_HUGEPAGE);
+#endif
+      }
+#else
+      throw std::runtime_error("Mapped memory is not supported on this platform");
+#endif
+}
+
+/**
+ * @brief Creates a memory from a snapshot
+ * 
+ * @param[i] snapshot 
+ */
+mips::Memory::Memory(const Snapshot& snapshot) : backend(MemoryBackend::Paged) {
+      flush_tlb();
+      segments = snapshot.segments;
+      directory = snapshot.directory;
+      page_count = snapshot.page_count;
+}
+
+/**
+ * @brief Destructor
+ */
+mips::Memory::~Memory() {
+#if MIPS_HAS_MMAP
+      if (base != nullptr) munmap(base, MAPPING_SIZE);
+#endif
+}
+
+/**
+ * @brief Releases every page
+ */
+void mips::Memory::clear() {
+      /** Whatever was decoded from the old contents is now stale */
+      code_pages.clear();
+      segments.clear();
+      code_version++;
+      flush_tlb();
+
+#if MIPS_HAS_MMAP
+      if (base != nullptr) {
+            /** Private anonymous pages read back as zero after being dropped */
+            madvise(base, MAPPING_SIZE, MADV_DONTNEED);
+            return;
+      }
+#endif
+      for (auto& table : directory) {
+            table.reset();
+      }
+      page_count = 0;
+}
+
+/**
+ * @brief Returns the number of pages backed by host memory
+ * 
+ * @details The mapped backends ask the kernel, which is slow, so this is meant
+ *          for reporting only.
+ * 
+ * @return size_t 
+ */
+size_t mips::Memory::resident_pages() const {
+#if MIPS_HAS_MMAP
+      if (base != nullptr) {
+            const size_t host_page = sysconf(_SC_PAGESIZE);
+            std::vector<mincore_t> residency(MAPPING_SIZE / host_page);
+            if (mincore(base, MAPPING_SIZE, residency.data()) != 0) return 0;
+
+            size_t resident = 0;
+            for (mincore_t page : residency) resident += page & 1;
+            return resident * host_page / PAGE_SIZE;
+      }
+#endif
+      return page_count;
+}
+
+/**
+ * @brief Takes a snapshot of the memory
+ * 
+ * @return std::shared_ptr<const Memory::Snapshot> 
+ */
+std::shared_ptr<const mips::Memory::Snapshot> mips::Memory::snapshot() const {
+      auto saved = std::make_shared<Snapshot>();
+      saved->segments = segments;
+
+      if (base == nullptr) {
+            /** Sharing the tables is enough, writers copy whatever is shared */
+            flush_tlb();
+            saved->directory = directory;
+            saved->page_count = page_count;
+            return saved;
+      }
+
+#if MIPS_HAS_MMAP
+      const size_t host_page = sysconf(_SC_PAGESIZE);
+      std::vector<mincore_t> residency(MAPPING_SIZE / host_page);
+      if (mincore(base, MAPPING_SIZE, residency.data()) != 0) {
+            throw std::runtime_error("Failed to query the guest address space");
+      }
+
+      for (uint64_t address = 0; address < static_cast<uint64_t>(MAX_MEMORY); address += PAGE_SIZE) {
+            if (!(residency[address / host_page] & 1)) continue;
+
+            const byte_t* source = base + address;
+            if (std::equal(source, source + PAGE_SIZE, zero_page.begin())) continue;
+
+            std::shared_ptr<PageTable>& table = saved->directory[address >> DIRECTORY_SHIFT];
+            if (table == nullptr) table = std::make_shared<PageTable>();
+
+            auto page = std::make_shared<Page>();
+            std::copy(source, source + PAGE_SIZE, page->begin());
+            (*table)[(address >> PAGE_SHIFT) & (PAGE_TABLE_SIZE - 1)] = std::move(page);
+            saved->page_count++;
+      }
+#endif
+      return saved;
+}
+
+/**
+ * @brief Counts the pages held by a set of snapshots
+ * 
+ * @details Identical tables hold identical pages, so each table is only
+ *          walked once.
+ * 
+ * @param[i] snapshots 
+ * @return size_t 
  */
-mips::Memory::Memory() {
-      zero_memory();
+size_t mips::Memory::Snapshot::distinct_pages(const std::vector<const Snapshot*>& snapshots) {
+      std::unordered_set<const PageTable*> tables;
+      std::unordered_set<const Page*> pages;
+
+      for (const Snapshot* snapshot : snapshots) {
+            for (const std::shared_ptr<PageTable>& table : snapshot->directory) {
+                  if (table == nullptr || !tables.insert(table.get()).second) continue;
+                  for (const std::shared_ptr<Page>& page : *table) {
+                        if (page != nullptr) pages.insert(page.get());
+                  }
+            }
+      }
+      return pages.size();
 }
 
 /**
- * @brief Zeroes the memory
+ * @brief Restores the contents saved in a snapshot
+ * 
+ * @param[i] snapshot 
  */
-void mips::Memory::zero_memory() {
-      for (size_t i = 0; i < MAX_MEMORY; i++) {
-            memory[i] = 0;
+void mips::Memory::restore(const Snapshot& snapshot) {
+      /** Whatever was decoded from the current contents may now be stale */
+      code_version++;
+      flush_tlb();
+      segments = snapshot.segments;
+
+      if (base == nullptr) {
+            directory = snapshot.directory;
+            page_count = snapshot.page_count;
+            return;
+      }
+
+#if MIPS_HAS_MMAP
+      madvise(base, MAPPING_SIZE, MADV_DONTNEED);
+      for (word_t index = 0; index < PAGE_TABLE_SIZE; index++) {
+            const PageTable* table = snapshot.directory[index].get();
+            if (table == nullptr) continue;
+
+            for (word_t entry = 0; entry < PAGE_TABLE_SIZE; entry++) {
+                  const Page* page = (*table)[entry].get();
+                  if (page == nullptr) continue;
+
+                  address_t address = (index << DIRECTORY_SHIFT) | (entry << PAGE_SHIFT);
+                  std::copy(page->begin(), page->end(), base + address);
+            }
       }
+#endif
+}
+
+/**
+ * @brief Returns the page holding the given address for reading
+ * 
+ * @param[i] address 
+ * @return const byte_t* 
+ */
+const mips::byte_t* mips::Memory::page_for_read(address_t address) const {
+      const PageTable* table = directory[address >> DIRECTORY_SHIFT].get();
+      if (table == nullptr) return zero_page.data();
+
+      const Page* page = (*table)[(address >> PAGE_SHIFT) & (PAGE_TABLE_SIZE - 1)].get();
+      if (page == nullptr) return zero_page.data();
+
+      return page->data();
 }
 
 /**
- * @brief Checks if the given address is valid
+ * @brief Returns the page holding the given address for writing
  * 
  * @param[i] address 
- * @return true/false
+ * @return byte_t* 
  */
-bool mips::Memory::check_address(address_t address) {
-      if (static_cast<size_t>(address) >= MAX_MEMORY || address < 0) {
-            return false;
+mips::byte_t* mips::Memory::page_for_write(address_t address) {
+      std::shared_ptr<PageTable>& table = directory[address >> DIRECTORY_SHIFT];
+      if (table == nullptr) table = std::make_shared<PageTable>();
+      else if (table.use_count() > 1) table = std::make_shared<PageTable>(*table);
+
+      std::shared_ptr<Page>& page = (*table)[(address >> PAGE_SHIFT) & (PAGE_TABLE_SIZE - 1)];
+      if (page == nullptr) {
+            page = std::make_shared<Page>();
+            page_count++;
       }
-      return true;
+      else if (page.use_count() > 1) {
+            page = std::make_shared<Page>(*page);
+            page_copies++;
+      }
+
+      return page->data();
 }
 
 /**
- * @brief Returns the byte at the given address
+ * @brief Walks the page directory and refills the TLB entry
+ * 
+ * @details Segment permissions are checked here, once per fill. Only
+ *          writing fills get write access, and never on code pages, so a
+ *          store to a code page always comes back here and bumps the code
+ *          version.
+ * 
+ * @param[i] address 
+ * @param[i] write 
+ * @return byte_t* 
+ */
+mips::byte_t* mips::Memory::fill(address_t address, bool write) {
+      tlb_misses++;
+
+      const byte_t permissions = permissions_at(address);
+      if (!(permissions & (write ? PERMISSION_WRITE : PERMISSION_READ))) {
+            throw AccessViolation(address, write ? AccessKind::Write : AccessKind::Read);
+      }
+      if (write) note_write(address);
+
+      const address_t tag = address & ~PAGE_MASK;
+      byte_t* page;
+      if (base != nullptr) page = base + tag;
+      else if (write) page = page_for_write(address);
+      else page = const_cast<byte_t*>(page_for_read(address));
+
+      TlbEntry& entry = tlb[(address >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+      entry.page = page;
+      entry.read_tag = permissions & PERMISSION_READ ? tag : INVALID_TAG;
+      entry.write_tag = write && !is_code_page(address) ? tag : INVALID_TAG;
+      return page;
+}
+
+/**
+ * @brief Maps a segment
+ * 
+ * @param[i] start 
+ * @param[i] size 
+ * @param[i] permissions 
+ */
+void mips::Memory::map_segment(address_t start, uint64_t size, byte_t permissions) {
+      const uint64_t first = start & ~PAGE_MASK;
+      const uint64_t last = std::min<uint64_t>(static_cast<uint64_t>(start) + size + PAGE_MASK, MAX_MEMORY) & ~static_cast<uint64_t>(PAGE_MASK);
+      if (last <= first) return;
+
+      segments.push_back({ static_cast<address_t>(first), last - first, permissions });
+      code_version++;
+      flush_tlb();
+}
+
+/**
+ * @brief Maps the standard program layout
+ * 
+ * @param[i] text_size 
+ */
+void mips::Memory::map_standard_layout(word_t text_size) {
+      unmap_segments();
+      map_segment(TEXT_OFFSET, text_size, PERMISSION_READ | PERMISSION_EXECUTE);
+      map_segment(DATA_OFFSET, HEAP_LIMIT - DATA_OFFSET, PERMISSION_READ | PERMISSION_WRITE);
+      map_segment(static_cast<uint64_t>(STACK_OFFSET) + 1 - STACK_SIZE, STACK_SIZE, PERMISSION_READ | PERMISSION_WRITE);
+}
+
+/**
+ * @brief Returns the size of the executable segment at TEXT_OFFSET
+ * 
+ * @return uint64_t 
+ */
+uint64_t mips::Memory::get_text_size() const {
+      for (const MemoryRegion& segment : segments) {
+            if (segment.start == TEXT_OFFSET && (segment.permissions & PERMISSION_EXECUTE)) return segment.size;
+      }
+      return 0;
+}
+
+/**
+ * @brief Drops every segment
+ */
+void mips::Memory::unmap_segments() {
+      segments.clear();
+      code_version++;
+      flush_tlb();
+}
+
+/**
+ * @brief Returns the permissions at the given address
+ * 
+ * @details Programs map a handful of segments, so a linear scan is fine;
+ *          it only runs on TLB misses and instruction fetches.
+ * 
+ * @param[i] address 
+ * @return byte_t 
+ */
+mips::byte_t mips::Memory::permissions_at(address_t address) const {
+      if (segments.empty()) return PERMISSION_ALL;
+      for (const MemoryRegion& segment : segments) {
+            if (address >= segment.start && address - segment.start < segment.size) return segment.permissions;
+      }
+      return 0;
+}
+
+/**
+ * @brief Reads an instruction
+ * 
+ * @param[i] address 
+ * @return word_t 
+ */
+mips::word_t mips::Memory::fetch_word(address_t address) {
+      if (!(permissions_at(address) & PERMISSION_EXECUTE)) throw AccessViolation(address, AccessKind::Execute);
+      mark_code_page(address);
+      return read_word(address);
+}
+
+/**
+ * @brief Invalidates every TLB entry
+ */
+void mips::Memory::flush_tlb() const {
+      for (TlbEntry& entry : tlb) {
+            entry.read_tag = entry.write_tag = INVALID_TAG;
+            entry.page = const_cast<byte_t*>(zero_page.data());     // Never written, the write tag cannot match
+      }
+}
+
+/**
+ * @brief Returns the byte at the given address (TLB miss)
  * 
  * @param[i] address
  * @return byte_t
  */
-mips::byte_t mips::Memory::read_byte(address_t address) {
-      if (!check_address(address)) {
-            throw std::runtime_error("Invalid address");
-      }
-      return memory[address];
+mips::byte_t mips::Memory::read_byte_slow(address_t address) {
+      return fill(address, false)[address & PAGE_MASK];
 }
 
 /**
- * @brief Returns the half word at the given address
+ * @brief Returns the half word at the given address (TLB miss or misaligned)
  * 
  * @param[i] address
  * @return halfword_t
  */
-mips::halfword_t mips::Memory::read_halfword(address_t address) {
-      if (!check_address(address) || !check_address(address + 1)) {
-            throw std::runtime_error("Invalid address");
+mips::halfword_t mips::Memory::read_halfword_slow(address_t address) {
+      /** Accesses straddling two pages take the byte by byte path */
+      if ((address & PAGE_MASK) > PAGE_SIZE - sizeof(halfword_t)) {
+            return (read_byte(address) << 8) | read_byte(address + 1);
       }
-      return (memory[address] << 8) | memory[address + 1];
+      return load_halfword(fill(address, false) + (address & PAGE_MASK));
 }
 
 /**
- * @brief Returns the word at the given address
+ * @brief Returns the word at the given address (TLB miss or misaligned)
  * 
  * @param[i] address
  * @return word_t
  */
-mips::word_t mips::Memory::read_word(address_t address) {
-      if (!check_address(address) || !check_address(address + 3)) {
-            throw std::runtime_error("Invalid address");
+mips::word_t mips::Memory::read_word_slow(address_t address) {
+      /** Accesses straddling two pages take the byte by byte path */
+      if ((address & PAGE_MASK) > PAGE_SIZE - sizeof(word_t)) {
+            return (read_byte(address) << 24) | (read_byte(address + 1) << 16) | (read_byte(address + 2) << 8) | read_byte(address + 3);
       }
-      return (memory[address] << 24) | (memory[address + 1] << 16) | (memory[address + 2] << 8) | memory[address + 3];
+      return load_word(fill(address, false) + (address & PAGE_MASK));
 }
 
 /**
- * @brief Writes a byte at the given address
+ * @brief Writes a byte at the given address (TLB miss)
  * 
  * @param[i] value
  * @param[i] address
  */
-void mips::Memory::write_byte(byte_t value, address_t address) {
-      if (!check_address(address)) {
-            throw std::runtime_error("Invalid address");
-      }
-      memory[address] = value;
+void mips::Memory::write_byte_slow(byte_t value, address_t address) {
+      fill(address, true)[address & PAGE_MASK] = value;
 }
 
 /**
- * @brief Writes a half word at the given address
+ * @brief Writes a half word at the given address (TLB miss or misaligned)
  * 
  * @param[i] value
  * @param[i] address
  */
-void mips::Memory::write_halfword(halfword_t value, address_t address) {
-      if (!check_address(address) || !check_address(address + 1)) {
-            throw std::runtime_error("Invalid address");
+void mips::Memory::write_halfword_slow(halfword_t value, address_t address) {
+      /** Accesses straddling two pages take the byte by byte path */
+      if ((address & PAGE_MASK) > PAGE_SIZE - sizeof(halfword_t)) {
+            write_byte(value >> 8, address);
+            write_byte(value, address + 1);
+            return;
       }
-      memory[address] = value >> 8;
-      memory[address + 1] = value;
+      store_halfword(fill(address, true) + (address & PAGE_MASK), value);
 }
 
 /**
- * @brief Writes a word at the given address
+ * @brief Writes a word at the given address (TLB miss or misaligned)
  * 
  * @param[i] value
  * @param[i] address
  */
-void mips::Memory::write_word(word_t value, address_t address) {
-      if (!check_address(address) || !check_address(address + 3)) {
-            throw std::runtime_error("Invalid address");
+void mips::Memory::write_word_slow(word_t value, address_t address) {
+      /** Accesses straddling two pages take the byte by byte path */
+      if ((address & PAGE_MASK) > PAGE_SIZE - sizeof(word_t)) {
+            write_byte(value >> 24, address);
+            write_byte(value >> 16, address + 1);
+            write_byte(value >> 8, address + 2);
+            write_byte(value, address + 3);
+            return;
       }
-      memory[address] = value >> 24;
-      memory[address + 1] = value >> 16;
-      memory[address + 2] = value >> 8;
-      memory[address + 3] = value;
+      store_word(fill(address, true) + (address & PAGE_MASK), value);
 }
 
-void mips::Memory::load_text_section([[maybe_unused]] std::ifstream& file, [[maybe_unused]] word_t offset, [[maybe_unused]] word_t size) {
+/**
+ * @brief Copies a range of memory out
+ * 
+ * @details Copies page by page, so the page lookup is paid once per page
+ *          rather than once per byte.
+ * 
+ * @param[i] address
+ * @param[o] bytes
+ * @param[i] size
+ */
+void mips::Memory::read_block(address_t address, byte_t* bytes, size_t size) {
+      while (size > 0) {
+            size_t chunk = std::min<size_t>(size, PAGE_SIZE - (address & PAGE_MASK));
+            std::memcpy(bytes, fill(address, false) + (address & PAGE_MASK), chunk);
+
+            address += chunk;
+            bytes += chunk;
+            size -= chunk;
+      }
 }
 
-void mips::Memory::load_data_section([[maybe_unused]] std::ifstream& file, [[maybe_unused]] word_t offset, [[maybe_unused]] word_t size) {
+/**
+ * @brief Copies a range of bytes into memory
+ * 
+ * @param[i] bytes
+ * @param[i] size
+ * @param[i] address
+ */
+void mips::Memory::write_block(const byte_t* bytes, size_t size, address_t address) {
+      while (size > 0) {
+            size_t chunk = std::min<size_t>(size, PAGE_SIZE - (address & PAGE_MASK));
+            std::memcpy(fill(address, true) + (address & PAGE_MASK), bytes, chunk);
+
+            address += chunk;
+            bytes += chunk;
+            size -= chunk;
+      }
+}
+
+/**
+ * @brief Marks the page holding the given address as code
+ * 
+ * @param[i] address 
+ */
+void mips::Memory::mark_code_page(address_t address) {
+      if (code_pages.empty()) code_pages.resize((MAX_MEMORY >> PAGE_SHIFT) / 64);
+      code_pages[address >> (PAGE_SHIFT + 6)] |= uint64_t(1) << ((address >> PAGE_SHIFT) & 63);
+
+      /** Stores to the page must come back through fill() to bump the code version */
+      TlbEntry& entry = tlb[(address >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+      if (entry.write_tag == (address & ~PAGE_MASK)) entry.write_tag = INVALID_TAG;
+}
+
+/**
+ * @brief Loads a text section
+ * 
+ * @param[i] bytes 
+ * @param[i] offset 
+ * @param[i] size 
+ */
+void mips::Memory::load_text_section(const byte_t* bytes, word_t offset, word_t size) {
+      if (static_cast<uint64_t>(offset) + size > DATA_OFFSET - TEXT_OFFSET) {
+            throw std::runtime_error("Text section does not fit below the data segment");
+      }
+      write_block(bytes, size, TEXT_OFFSET + offset);
+}
+
+/**
+ * @brief Loads a data section
+ * 
+ * @param[i] bytes 
+ * @param[i] offset 
+ * @param[i] size 
+ */
+void mips::Memory::load_data_section(const byte_t* bytes, word_t offset, word_t size) {
+      if (static_cast<uint64_t>(offset) + size > HEAP_LIMIT - DATA_OFFSET) {
+            throw std::runtime_error("Data section does not fit below the heap limit");
+      }
+      write_block(bytes, size, DATA_OFFSET + offset);
 }
 
 /**
@@ -134,11 +566,17 @@ void mips::Memory::load_data_section([[maybe_unused]] std::ifstream& file, [[may
  */
 std::string mips::Memory::read_string(address_t address) {
       std::string str;
-      while (memory[address] != 0) {
-            str += memory[address];
-            address++;
+      for (;;) {
+            size_t chunk = PAGE_SIZE - (address & PAGE_MASK);
+            const byte_t* source = fill(address, false) + (address & PAGE_MASK);
+            const void* end = std::memchr(source, 0, chunk);
+            if (end != nullptr) {
+                  str.append(reinterpret_cast<const char*>(source), static_cast<const byte_t*>(end) - source);
+                  return str;
+            }
+            str.append(reinterpret_cast<const char*>(source), chunk);
+            address += chunk;
       }
-      return str;
 }
 
 /**
@@ -155,7 +593,11 @@ void mips::Memory::dump(std::ostream& stream) {
  * @param[i] finish 
  */
 void mips::Memory::dump_offset(std::ostream& stream, address_t start, address_t finish) {
-      mips::dump_bytes(stream, &memory[start], finish - start);
+      std::vector<byte_t> bytes(finish - start);
+      for (address_t i = 0; i < bytes.size(); i++) {
+            bytes[i] = read_byte(start + i);
+      }
+      mips::dump_bytes(stream, bytes.data(), bytes.size());
 }
 
 // MIT License
@@ -3,13 +3,25 @@
 //
 
 /** C++ Includes */
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 
 /** Mips Includes */
 #include <obj.hpp>
+#include <except.hpp>
+#include <file.hpp>
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
+/** Byte order of this host, as recorded in the file header */
+static mips::byte_t host_endianess() {
+      const uint16_t probe = 1;
+      mips::byte_t first;
+      std::memcpy(&first, &probe, 1);
+      return first == 1 ? 0 : 1;
+}
+
 /**
  * @brief Checks if the given header is a valid MIPS header
  * 
@@ -23,13 +35,136 @@ static bool is_mips_header(mips::MIPS_file_header header) {
       }
 
       /** Check the version */
-      if (header.version != mips::MIPS_VERSION) {
+      if (header.version != mips::MIPS_VERSION && header.version != mips::MIPS_VERSION_1) {
             return false;
       }
 
       return true;
 }
 
+/**
+ * @brief Reads and checks the file header
+ * 
+ * @param[i] image 
+ * @return mips::MIPS_file_header 
+ * @throw mips::FileException If the header is not valid
+ */
+static mips::MIPS_file_header read_header(std::string_view image) {
+      mips::MIPS_file_header header;
+      if (image.size() < mips::MIPS_HEADER_SIZE_BYTES) throw mips::FileException("Invalid MIPS header");
+      std::memcpy(&header, image.data(), mips::MIPS_HEADER_SIZE_BYTES);
+      if (!is_mips_header(header)) throw mips::FileException("Invalid MIPS header");
+
+      /** v2 fields are written in host order */
+      if (header.version != mips::MIPS_VERSION_1 && header.endianess != host_endianess()) {
+            throw mips::FileException("MIPS binary was written with the other byte order");
+      }
+      return header;
+}
+
+/**
+ * @brief Reads and checks the section headers of a v2 image
+ * 
+ * @param[i] image 
+ * @param[i] header 
+ * @return std::vector<mips::MIPS_section_header_v2> 
+ * @throw mips::FileException If a section lies outside the image
+ */
+static std::vector<mips::MIPS_section_header_v2> read_sections(std::string_view image, const mips::MIPS_file_header& header) {
+      const size_t table = mips::MIPS_HEADER_SIZE_BYTES;
+      if (image.size() - table < header.shnum * sizeof(mips::MIPS_section_header_v2)) {
+            throw mips::FileException("Truncated MIPS section header");
+      }
+
+      std::vector<mips::MIPS_section_header_v2> sections(header.shnum);
+      std::memcpy(sections.data(), image.data() + table, sections.size() * sizeof(mips::MIPS_section_header_v2));
+      for (const mips::MIPS_section_header_v2& section : sections) {
+            if (section.offset > image.size() || image.size() - section.offset < section.size) {
+                  throw mips::FileException("Truncated MIPS section");
+            }
+      }
+      return sections;
+}
+
+/**
+ * @brief Reads a section made of fixed size entries
+ * 
+ * @param[i] image 
+ * @param[i] section 
+ * @return std::vector<Entry> 
+ * @throw mips::FileException If the section is not a whole number of entries
+ */
+template <typename Entry>
+static std::vector<Entry> read_entries(std::string_view image, const mips::MIPS_section_header_v2& section) {
+      if (section.size % sizeof(Entry) != 0) throw mips::FileException("Invalid MIPS section size");
+
+      std::vector<Entry> entries(section.size / sizeof(Entry));
+      std::memcpy(entries.data(), image.data() + section.offset, section.size);
+      return entries;
+}
+
+/**
+ * @brief Loads the sections of a v1 image
+ * 
+ * @param[i] image 
+ * @param[i] header 
+ * @param[o] memory 
+ * @return uint64_t The end of the text, from TEXT_OFFSET
+ */
+static uint64_t load_sections_v1(std::string_view image, const mips::MIPS_file_header& header, mips::Memory* memory) {
+      const mips::byte_t* bytes = reinterpret_cast<const mips::byte_t*>(image.data());
+      const size_t size = image.size();
+
+      uint64_t text_end = 0;
+      size_t position = mips::MIPS_HEADER_SIZE_BYTES;
+      for (int i = 0; i < header.shnum; i++) {
+            mips::MIPS_section_header section_header;
+            if (size - position < sizeof(mips::MIPS_section_header)) throw mips::FileException("Truncated MIPS section header");
+            std::memcpy(&section_header, bytes + position, sizeof(mips::MIPS_section_header));
+            position += sizeof(mips::MIPS_section_header);
+
+            if (size - position < section_header.size) throw mips::FileException("Truncated MIPS section");
+            if (section_header.segment == 0) {
+                  memory->load_text_section(bytes + position, section_header.offset, section_header.size);
+                  text_end = std::max<uint64_t>(text_end, static_cast<uint64_t>(section_header.offset) + section_header.size);
+            } else if (section_header.segment == 1) {
+                  memory->load_data_section(bytes + position, section_header.offset, section_header.size);
+            }
+            position += section_header.size;
+      }
+      return text_end;
+}
+
+/**
+ * @brief Loads the text and data sections of a v2 image
+ * 
+ * @param[i] image 
+ * @param[i] header 
+ * @param[o] memory 
+ * @return uint64_t The end of the text, from TEXT_OFFSET
+ */
+static uint64_t load_sections_v2(std::string_view image, const mips::MIPS_file_header& header, mips::Memory* memory) {
+      const mips::byte_t* bytes = reinterpret_cast<const mips::byte_t*>(image.data());
+
+      uint64_t text_end = 0;
+      for (const mips::MIPS_section_header_v2& section : read_sections(image, header)) {
+            const mips::SectionType type = mips::SectionType(section.type);
+            if (type != mips::SectionType::Text && type != mips::SectionType::Data) continue;
+
+            /** Wrapping offsets are caught by the segment bounds checks */
+            if (section.size > UINT32_MAX) throw mips::FileException("MIPS section too large");
+            const mips::word_t size = static_cast<mips::word_t>(section.size);
+            if (type == mips::SectionType::Text) {
+                  const mips::word_t offset = section.address - mips::TEXT_OFFSET;
+                  memory->load_text_section(bytes + section.offset, offset, size);
+                  text_end = std::max<uint64_t>(text_end, static_cast<uint64_t>(offset) + size);
+            } else {
+                  memory->load_data_section(bytes + section.offset, section.address - mips::DATA_OFFSET, size);
+            }
+      }
+      return text_end;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -37,69 +172,142 @@ static bool is_mips_header(mips::MIPS_file_header header) {
  * 
  * @param[i] filename 
  * @param[o] memory 
- * @throw std::runtime_error If the file is not found
- * @throw std::runtime_error If the file is not a valid MIPS binary file
  */
 void mips::load_mips_binary(std::string filename, mips::Memory* memory) {
-      std::ifstream file(filename, std::ios::binary);
-      if (!file.is_open()) throw std::runtime_error("Failed to open file");
+      MappedFile file(filename);
+      load_mips_image(file.contents(), memory);
+}
 
-      /** Check the file headers */
-      MIPS_file_header header;
-      file.read((char*)&header, MIPS_HEADER_SIZE_BYTES);
-      if (!is_mips_header(header)) throw std::runtime_error("Invalid MIPS header");
+/**
+ * @brief Loads a MIPS binary image into memory
+ * 
+ * @param[i] image 
+ * @param[o] memory 
+ */
+void mips::load_mips_image(std::string_view image, mips::Memory* memory) {
+      const MIPS_file_header header = read_header(image);
 
-      for (int i = 0; i < header.shnum; i++) {
-            MIPS_section_header section_header;
-            file.read((char*)&section_header, sizeof(MIPS_section_header));
+      /** The loader writes into text, so the old layout has to go first */
+      memory->unmap_segments();
 
-            if (section_header.segment == 0) {
-                  memory->load_text_section(file, section_header.offset, section_header.size);
-            } else if (section_header.segment == 1) {
-                  memory->load_data_section(file, section_header.offset, section_header.size);
+      uint64_t text_end = header.version == MIPS_VERSION_1 ? load_sections_v1(image, header, memory) : load_sections_v2(image, header, memory);
+      memory->map_standard_layout(text_end);
+}
+
+/**
+ * @brief Reads the symbols, relocations and line map of a binary image
+ * 
+ * @param[i] image 
+ * @return mips::MIPS_debug_info 
+ */
+mips::MIPS_debug_info mips::read_mips_debug_info(std::string_view image) {
+      const MIPS_file_header header = read_header(image);
+
+      MIPS_debug_info info;
+      if (header.version == MIPS_VERSION_1) return info;
+
+      std::vector<MIPS_symbol> symbols;
+      std::string_view strings;
+      for (const MIPS_section_header_v2& section : read_sections(image, header)) {
+            switch (SectionType(section.type)) {
+                  case SectionType::Symbols:
+                        symbols = read_entries<MIPS_symbol>(image, section);
+                        break;
+                  case SectionType::Strings:
+                        strings = image.substr(section.offset, section.size);
+                        break;
+                  case SectionType::Relocations:
+                        info.relocations = read_entries<MIPS_relocation>(image, section);
+                        break;
+                  case SectionType::Lines:
+                        info.lines = read_entries<MIPS_line>(image, section);
+                        break;
+                  default:
+                        break;
             }
       }
+
+      info.symbols.reserve(symbols.size());
+      for (const MIPS_symbol& symbol : symbols) {
+            if (symbol.name > strings.size() || strings.size() - symbol.name < symbol.name_size) {
+                  throw FileException("Invalid MIPS symbol name");
+            }
+            info.symbols.push_back({ std::string(strings.substr(symbol.name, symbol.name_size)), symbol.address, symbol.segment, symbol.line });
+      }
+      for (const MIPS_relocation& relocation : info.relocations) {
+            if (relocation.symbol >= info.symbols.size()) throw FileException("Invalid MIPS relocation");
+      }
+      return info;
 }
 
 /**
  * @brief Save the MIPS bytecode to a file
  * 
  * @param[i] filename 
- * @param[i] binary 
- * @throw std::runtime_error If the file fails to open
+ * @param[i] text 
+ * @param[i] data 
+ * @param[i] info 
  */
-void mips::save_mips_binary(std::string filename, std::vector<byte_t> binary) {
-      std::ofstream file(filename, std::ios::binary);
-      if (!file.is_open()) throw std::runtime_error("Failed to open file");
+void mips::save_mips_binary(std::string filename, const std::vector<byte_t>& text, const std::vector<byte_t>& data, const MIPS_debug_info& info) {
+      /** Symbols refer to their names in the string section */
+      std::vector<MIPS_symbol> symbols;
+      std::string strings;
+      symbols.reserve(info.symbols.size());
+      for (const ObjectSymbol& symbol : info.symbols) {
+            symbols.push_back({ static_cast<word_t>(strings.size()), static_cast<word_t>(symbol.name.size()), symbol.address, symbol.line, symbol.segment, { 0, 0, 0 } });
+            strings += symbol.name;
+      }
 
-      /** Write the header */
+      struct Payload {
+            SectionType type;
+            address_t address;
+            const void* bytes;
+            size_t size;
+      };
+      std::vector<Payload> payloads;
+      payloads.push_back({ SectionType::Text, static_cast<address_t>(TEXT_OFFSET), text.data(), text.size() });
+      if (!data.empty()) payloads.push_back({ SectionType::Data, static_cast<address_t>(DATA_OFFSET), data.data(), data.size() });
+      if (!symbols.empty() || !info.lines.empty()) {
+            payloads.push_back({ SectionType::Symbols, 0, symbols.data(), symbols.size() * sizeof(MIPS_symbol) });
+            payloads.push_back({ SectionType::Strings, 0, strings.data(), strings.size() });
+            payloads.push_back({ SectionType::Relocations, 0, info.relocations.data(), info.relocations.size() * sizeof(MIPS_relocation) });
+            payloads.push_back({ SectionType::Lines, 0, info.lines.data(), info.lines.size() * sizeof(MIPS_line) });
+      }
+
+      /** Header */
       MIPS_file_header header;
       header.magic[0] = 'M';
       header.magic[1] = 'I';
       header.magic[2] = 'P';
       header.magic[3] = 'S';
-      header.endianess = 0;
+      header.endianess = host_endianess();
       header.version = MIPS_VERSION;
-      header.shnum = 1;
+      header.shnum = payloads.size();
       header.padding[0] = 0;
-      file.write((char*)&header, MIPS_HEADER_SIZE_BYTES);
-
-      /** Write the text section */
-      MIPS_section_header text_section;
-      text_section.segment = 0;
-      text_section.padding[0] = 0;
-      text_section.padding[1] = 0;
-      text_section.padding[2] = 0;
-      text_section.offset = 0;
-      text_section.size = binary.size();
-      file.write((char*)&text_section, sizeof(MIPS_section_header));
-
-      /** Write the binary */
-      for (size_t i = 0; i < binary.size(); i++) {
-            file.write((char*)&binary[i], sizeof(byte_t));
+
+      /** Lay the whole file out in one buffer */
+      size_t size = MIPS_HEADER_SIZE_BYTES + payloads.size() * sizeof(MIPS_section_header_v2);
+      for (const Payload& payload : payloads) size += payload.size;
+
+      std::string buffer;
+      buffer.reserve(size);
+      buffer.append(reinterpret_cast<const char*>(&header), MIPS_HEADER_SIZE_BYTES);
+
+      uint64_t offset = MIPS_HEADER_SIZE_BYTES + payloads.size() * sizeof(MIPS_section_header_v2);
+      for (const Payload& payload : payloads) {
+            MIPS_section_header_v2 section = { static_cast<byte_t>(payload.type), { 0, 0, 0 }, payload.address, offset, payload.size };
+            buffer.append(reinterpret_cast<const char*>(&section), sizeof(MIPS_section_header_v2));
+            offset += payload.size;
+      }
+      for (const Payload& payload : payloads) {
+            buffer.append(static_cast<const char*>(payload.bytes), payload.size);
       }
 
+      std::ofstream file(filename, std::ios::binary);
+      if (!file.is_open()) throw FileException("Failed to open " + filename);
+      file.write(buffer.data(), buffer.size());
       file.close();
+      if (!file) throw FileException("Failed to write " + filename);
 }
 
 // MIT License
@@ -0,0 +1,195 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <iomanip>
+
+/** Mips Includes */
+#include <pipeline.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Cycles to fill the pipeline before the first instruction completes */
+constexpr uint64_t PIPELINE_FILL = 4;
+
+/** Names of the instruction classes, in InstructionClass order */
+static const char* const CLASS_NAMES[] = { "alu", "load", "store", "branch", "jump", "mul/div", "other" };
+
+/**
+ * @brief Classifies an operation
+ *
+ * @param[i] op
+ * @return mips::InstructionClass
+ */
+static mips::InstructionClass classify(mips::Operation op) {
+      using mips::Operation;
+      using mips::InstructionClass;
+
+      switch (op) {
+            case Operation::Lb: case Operation::Lbu: case Operation::Lh: case Operation::Lhu: case Operation::Lw:
+                  return InstructionClass::Load;
+            case Operation::Sb: case Operation::Sh: case Operation::Sw:
+                  return InstructionClass::Store;
+            case Operation::Beq: case Operation::Bne: case Operation::Blez: case Operation::Bgtz:
+            case Operation::Bltz: case Operation::Bgez: case Operation::Bltzal: case Operation::Bgezal:
+                  return InstructionClass::Branch;
+            case Operation::J: case Operation::Jal: case Operation::Jr: case Operation::Jalr:
+                  return InstructionClass::Jump;
+            case Operation::Mult: case Operation::Multu: case Operation::Div: case Operation::Divu:
+            case Operation::Mfhi: case Operation::Mflo: case Operation::Mthi: case Operation::Mtlo:
+                  return InstructionClass::MultiplyDivide;
+            case Operation::Syscall: case Operation::Break: case Operation::Invalid: case Operation::Count:
+                  return InstructionClass::Other;
+            default:
+                  return InstructionClass::Alu;
+      }
+}
+
+/**
+ * @brief Formats cycles per instruction
+ *
+ * @param[i] cycles
+ * @param[i] instructions
+ * @return double
+ */
+static double per_instruction(uint64_t cycles, uint64_t instructions) {
+      return instructions == 0 ? 0.0 : static_cast<double>(cycles) / instructions;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @details The registers an operation reads in EX come from its operand
+ *          syntax in INSTRUCTIONS. A store's rt is only needed in MEM,
+ *          where it is forwarded from a load right before it, so stores
+ *          only stall on their base register.
+ *
+ * @param[i] config
+ */
+mips::PipelineModel::PipelineModel(const PipelineConfig& config) : config(config) {
+      for (size_t op = 0; op < timings.size(); op++) {
+            timings[op] = { classify(static_cast<Operation>(op)), false, false, false, false, 0, 0 };
+      }
+
+      for (const InstructionInfo& info : INSTRUCTIONS) {
+            Timing& timing = timings[static_cast<size_t>(info.op)];
+            switch (info.syntax) {
+                  case Syntax::RdRsRt:
+                  case Syntax::RdRtRs:
+                  case Syntax::RsRt:
+                  case Syntax::RsRtLabel:
+                        timing.reads_rs = timing.reads_rt = true;
+                        break;
+                  case Syntax::RdRtShamt:
+                        timing.reads_rt = true;
+                        break;
+                  case Syntax::Rs:
+                  case Syntax::RdRs:
+                  case Syntax::RtRsImmediate:
+                  case Syntax::RtOffsetRs:
+                  case Syntax::RsLabel:
+                        timing.reads_rs = true;
+                        break;
+                  default:
+                        break;
+            }
+      }
+
+      for (Operation op : { Operation::Lb, Operation::Lbu, Operation::Lh, Operation::Lhu, Operation::Lw }) {
+            timings[static_cast<size_t>(op)].load = true;
+      }
+      for (Operation op : { Operation::Mfhi, Operation::Mflo }) {
+            timings[static_cast<size_t>(op)].reads_hilo = true;
+      }
+      for (Operation op : { Operation::Mult, Operation::Multu }) {
+            timings[static_cast<size_t>(op)].writes_hilo = config.multiply;
+      }
+      for (Operation op : { Operation::Div, Operation::Divu }) {
+            timings[static_cast<size_t>(op)].writes_hilo = config.divide;
+      }
+
+      for (Timing& timing : timings) {
+            if (timing.kind == InstructionClass::Branch) timing.penalty = config.taken_branch;
+      }
+      timings[static_cast<size_t>(Operation::J)].penalty = config.jump;
+      timings[static_cast<size_t>(Operation::Jal)].penalty = config.jump;
+      timings[static_cast<size_t>(Operation::Jr)].penalty = config.register_jump;
+      timings[static_cast<size_t>(Operation::Jalr)].penalty = config.register_jump;
+}
+
+/**
+ * @brief Returns the modelled cycles
+ *
+ * @return uint64_t
+ */
+uint64_t mips::PipelineModel::get_cycles() const {
+      return cycle == 0 ? 0 : cycle + PIPELINE_FILL;
+}
+
+/**
+ * @brief Returns the number of instructions accounted
+ *
+ * @return uint64_t
+ */
+uint64_t mips::PipelineModel::get_instructions() const {
+      uint64_t instructions = 0;
+      for (const ClassStats& stats : classes) instructions += stats.instructions;
+      return instructions;
+}
+
+/**
+ * @brief Writes the cycles, CPI and stall breakdown per class
+ *
+ * @param[o] output
+ */
+void mips::PipelineModel::write_report(std::ostream& output) const {
+      const uint64_t instructions = get_instructions();
+      const uint64_t cycles = get_cycles();
+
+      output << std::fixed << std::setprecision(3);
+      output << "Pipeline: " << instructions << " instructions, " << cycles << " cycles, CPI " << per_instruction(cycles, instructions) << std::endl;
+      output << std::setw(8) << "class" << std::setw(14) << "instructions" << std::setw(14) << "taken" << std::setw(14) << "load-use"
+             << std::setw(14) << "hi/lo" << std::setw(14) << "control" << std::setw(8) << "CPI" << std::endl;
+
+      ClassStats total;
+      for (size_t i = 0; i < classes.size(); i++) {
+            const ClassStats& stats = classes[i];
+            if (stats.instructions == 0) continue;
+
+            const uint64_t lost = stats.load_use_cycles + stats.hilo_cycles + stats.control_cycles;
+            output << std::setw(8) << CLASS_NAMES[i] << std::setw(14) << stats.instructions << std::setw(14) << stats.taken << std::setw(14) << stats.load_use_cycles
+                   << std::setw(14) << stats.hilo_cycles << std::setw(14) << stats.control_cycles << std::setw(8) << per_instruction(stats.instructions + lost, stats.instructions) << std::endl;
+
+            total.taken += stats.taken;
+            total.load_use_cycles += stats.load_use_cycles;
+            total.hilo_cycles += stats.hilo_cycles;
+            total.control_cycles += stats.control_cycles;
+      }
+      output << std::setw(8) << "total" << std::setw(14) << instructions << std::setw(14) << total.taken << std::setw(14) << total.load_use_cycles
+             << std::setw(14) << total.hilo_cycles << std::setw(14) << total.control_cycles << std::setw(8) << per_instruction(cycles, instructions) << std::endl;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,107 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <iomanip>
+
+/** Mips Includes */
+#include <predictor.hpp>
+#include <except.hpp>
+#include <report.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Number of instructions in the misprediction report */
+constexpr size_t PREDICTOR_REPORT_LIMIT = 20;
+
+/**
+ * @brief Parses a predictor name
+ *
+ * @param[i] name
+ * @return PredictorKind
+ */
+mips::PredictorKind mips::parse_predictor(const std::string& name) {
+      if (name == StaticPredictor::NAME) return PredictorKind::Static;
+      if (name == BimodalPredictor::NAME) return PredictorKind::Bimodal;
+      if (name == GsharePredictor::NAME) return PredictorKind::Gshare;
+      if (name == TournamentPredictor::NAME) return PredictorKind::Tournament;
+      throw Exception("Unknown branch predictor '" + name + "', expected static, bimodal, gshare or tournament");
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param[i] memory
+ * @param[i] predictor
+ */
+mips::BranchStats::BranchStats(Memory* memory, const char* predictor) : memory(memory), predictor(predictor) {
+      per_pc.assign(memory->get_text_size() / sizeof(instruction_t), PcStats());
+}
+
+/**
+ * @brief Writes the totals and the branches mispredicted the most
+ *
+ * @param[o] output
+ */
+void mips::BranchStats::write_report(std::ostream& output) const {
+      KindStats total = { outside.executed, outside.mispredicted };
+      std::vector<size_t> missed;
+      for (size_t i = 0; i < per_pc.size(); i++) {
+            total.executed += per_pc[i].executed;
+            total.mispredicted += per_pc[i].mispredicted;
+            if (per_pc[i].mispredicted != 0) missed.push_back(i);
+      }
+
+      output << std::fixed << std::setprecision(2);
+      output << "Branch prediction (" << predictor << ", " << BTB_ENTRIES << " entry BTB, " << RAS_DEPTH << " entry RAS):" << std::endl;
+      output << std::setw(14) << "" << std::setw(14) << "executed" << std::setw(14) << "mispredicted" << std::setw(8) << "miss%" << std::endl;
+      auto row = [&](const char* name, const KindStats& stats) {
+            output << std::setw(14) << name << std::setw(14) << stats.executed << std::setw(14) << stats.mispredicted
+                   << std::setw(8) << percent(stats.mispredicted, stats.executed) << std::endl;
+      };
+      row("direction", conditional);
+      row("btb", targets);
+      row("ras", returns);
+      row("transfers", total);
+      output << std::endl;
+
+      const size_t limit = std::min(missed.size(), PREDICTOR_REPORT_LIMIT);
+      std::partial_sort(missed.begin(), missed.begin() + limit, missed.end(), [&](size_t a, size_t b) {
+            return per_pc[a].mispredicted != per_pc[b].mispredicted ? per_pc[a].mispredicted > per_pc[b].mispredicted : a < b;
+      });
+      missed.resize(limit);
+
+      output << "Transfers by mispredictions:" << std::endl;
+      output << std::setw(14) << "executed" << std::setw(8) << "taken%" << std::setw(14) << "mispredicted" << std::setw(8) << "miss%" << "  address     instruction" << std::endl;
+      for (size_t i : missed) {
+            const PcStats& pc = per_pc[i];
+            const address_t address = static_cast<address_t>(TEXT_OFFSET + i * sizeof(instruction_t));
+            output << std::setw(14) << pc.executed << std::setw(8) << percent(pc.taken, pc.executed) << std::setw(14) << pc.mispredicted
+                   << std::setw(8) << percent(pc.mispredicted, pc.executed) << "  0x" << std::hex << std::setw(8) << std::setfill('0') << address
+                   << std::dec << std::setfill(' ') << "  " << disassemble(memory->read_word(address), address) << std::endl;
+      }
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,313 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+/** Mips Includes */
+#include <profiler.hpp>
+#include <instruction.hpp>
+#include <report.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Most call stacks tracked; further calls are attributed to their caller */
+constexpr size_t MAX_PROFILE_FRAMES = 1 << 16;
+
+/**
+ * @brief Formats an address as 0x%08x
+ *
+ * @param[i] address
+ * @return std::string
+ */
+static std::string hex(mips::address_t address) {
+      std::ostringstream text;
+      text << "0x" << std::hex << std::setw(8) << std::setfill('0') << address;
+      return text.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @param[i] memory
+ * @param[i] entry
+ */
+mips::Profiler::Profiler(Memory* memory, address_t entry) : memory(memory) {
+      counts.assign(memory->get_text_size() / sizeof(instruction_t), 0);
+      taken.assign(counts.size(), 0);
+      entries.assign(counts.size(), 0);
+      kinds.assign(counts.size(), Kind::Plain);
+
+      frames.push_back({ 0, entry });
+      samples.push_back(0);
+
+      const address_t index = (entry - TEXT_OFFSET) >> 2;
+      if (index < entries.size()) entries[index]++;
+}
+
+/**
+ * @brief Sets the symbols and line map used in the reports
+ *
+ * @param[i] info
+ */
+void mips::Profiler::set_debug_info(MIPS_debug_info info) {
+      symbols.clear();
+      for (ObjectSymbol& symbol : info.symbols) {
+            if (symbol.segment == 0) symbols.push_back(std::move(symbol));
+      }
+      std::stable_sort(symbols.begin(), symbols.end(), [](const ObjectSymbol& a, const ObjectSymbol& b) { return a.address < b.address; });
+
+      lines = std::move(info.lines);
+      std::stable_sort(lines.begin(), lines.end(), [](const MIPS_line& a, const MIPS_line& b) { return a.address < b.address; });
+}
+
+/**
+ * @brief Returns the number of instructions recorded
+ *
+ * @return uint64_t
+ */
+uint64_t mips::Profiler::get_total() const {
+      return std::accumulate(counts.begin(), counts.end(), outside);
+}
+
+/**
+ * @brief Classifies the instruction at the given address
+ *
+ * @param[i] address
+ * @return Kind
+ */
+mips::Profiler::Kind mips::Profiler::classify(address_t address) {
+      const instruction_t instruction = memory->read_word(address);
+      const InstructionInfo* info = find_instruction(instruction);
+      if (info == nullptr) return Kind::Plain;
+
+      switch (info->op) {
+            case Operation::Beq:
+            case Operation::Bne:
+            case Operation::Blez:
+            case Operation::Bgtz:
+            case Operation::Bltz:
+            case Operation::Bgez:
+                  return Kind::Branch;
+            case Operation::J:
+                  return Kind::Jump;
+            case Operation::Jr:
+                  return get_rs(instruction) == 31 ? Kind::Return : Kind::Jump;
+            case Operation::Jal:
+            case Operation::Jalr:
+            case Operation::Bltzal:
+            case Operation::Bgezal:
+                  return Kind::Call;
+            default:
+                  return Kind::Plain;
+      }
+}
+
+/**
+ * @brief Records a control transfer
+ *
+ * @details Both sides of a branch start a basic block. Linking branches
+ *          only call when taken.
+ *
+ * @param[i] index
+ * @param[i] from
+ * @param[i] to
+ */
+void mips::Profiler::transfer(address_t index, address_t from, address_t to) {
+      const bool jumped = to != from + sizeof(instruction_t);
+      if (jumped) taken[index]++;
+
+      const address_t target = (to - TEXT_OFFSET) >> 2;
+      if (target < entries.size()) entries[target]++;
+
+      switch (kinds[index]) {
+            case Kind::Call: {
+                  if (!jumped || frames.size() >= MAX_PROFILE_FRAMES) break;
+
+                  const uint64_t key = (uint64_t(frame) << 32) | to;
+                  auto child = children.find(key);
+                  if (child == children.end()) {
+                        child = children.emplace(key, static_cast<uint32_t>(frames.size())).first;
+                        frames.push_back({ frame, to });
+                        samples.push_back(0);
+                  }
+                  frame = child->second;
+                  break;
+            }
+            case Kind::Return:
+                  frame = frames[frame].parent;
+                  break;
+            default:
+                  break;
+      }
+}
+
+/**
+ * @brief Names an address
+ *
+ * @param[i] address
+ * @return std::string
+ */
+std::string mips::Profiler::symbolize(address_t address) const {
+      auto after = std::upper_bound(symbols.begin(), symbols.end(), address, [](address_t value, const ObjectSymbol& symbol) { return value < symbol.address; });
+      if (after == symbols.begin()) return hex(address);
+
+      const ObjectSymbol& symbol = *std::prev(after);
+      if (symbol.address == address) return symbol.name;
+
+      std::ostringstream text;
+      text << symbol.name << "+0x" << std::hex << address - symbol.address;
+      return text.str();
+}
+
+/**
+ * @brief Finds the source line of an instruction
+ *
+ * @param[i] address
+ * @return word_t
+ */
+mips::word_t mips::Profiler::line_of(address_t address) const {
+      auto line = std::lower_bound(lines.begin(), lines.end(), address, [](const MIPS_line& entry, address_t value) { return entry.address < value; });
+      return line != lines.end() && line->address == address ? line->line : 0;
+}
+
+/**
+ * @brief Writes the hot-spot report
+ *
+ * @details Blocks are rebuilt from the counters: a block starts wherever
+ *          control entered and runs up to the next control transfer or
+ *          the next entry.
+ *
+ * @param[o] output
+ */
+void mips::Profiler::write_report(std::ostream& output) {
+      const uint64_t total = get_total();
+      auto address_of = [](size_t index) { return static_cast<address_t>(TEXT_OFFSET + index * sizeof(instruction_t)); };
+      auto describe = [&](size_t index) {
+            const address_t address = address_of(index);
+            std::ostringstream text;
+            text << std::setw(6) << line_of(address) << "  " << disassemble(memory->read_word(address), address) << "  <" << symbolize(address) << ">";
+            return text.str();
+      };
+      auto hottest = [](std::vector<size_t>& indices, auto&& weight) {
+            size_t limit = std::min(indices.size(), PROFILE_REPORT_LIMIT);
+            std::partial_sort(indices.begin(), indices.begin() + limit, indices.end(), [&](size_t a, size_t b) {
+                  return weight(a) != weight(b) ? weight(a) > weight(b) : a < b;
+            });
+            indices.resize(limit);
+      };
+
+      output << std::fixed << std::setprecision(2);
+      output << "Profile: " << total << " instructions";
+      if (outside != 0) output << ", " << outside << " outside the text segment";
+      output << std::endl << std::endl;
+
+      /** Hot instructions */
+      std::vector<size_t> executed;
+      for (size_t i = 0; i < counts.size(); i++) {
+            if (counts[i] != 0) executed.push_back(i);
+      }
+      std::vector<size_t> instructions = executed;
+      hottest(instructions, [&](size_t i) { return counts[i]; });
+
+      output << "Hot instructions:" << std::endl;
+      output << std::setw(14) << "count" << std::setw(8) << "%" << "  address     " << std::setw(6) << "line" << "  instruction" << std::endl;
+      for (size_t i : instructions) {
+            output << std::setw(14) << counts[i] << std::setw(8) << percent(counts[i], total) << "  " << hex(address_of(i)) << "  " << describe(i) << std::endl;
+      }
+      output << std::endl;
+
+      /** Hot blocks */
+      struct Block {
+            size_t first;
+            size_t last;
+            uint64_t instructions;
+      };
+      std::vector<Block> blocks;
+      for (size_t i : executed) {
+            if (entries[i] == 0 && !blocks.empty() && blocks.back().last + 1 == i && kinds[i - 1] == Kind::Plain) {
+                  blocks.back().last = i;
+                  blocks.back().instructions += counts[i];
+            }
+            else {
+                  blocks.push_back({ i, i, counts[i] });
+            }
+      }
+      std::vector<size_t> hot_blocks(blocks.size());
+      std::iota(hot_blocks.begin(), hot_blocks.end(), 0);
+      hottest(hot_blocks, [&](size_t b) { return blocks[b].instructions; });
+
+      output << "Hot blocks:" << std::endl;
+      output << std::setw(14) << "instructions" << std::setw(8) << "%" << std::setw(14) << "entries" << "  start       end         " << std::setw(6) << "line" << "  symbol" << std::endl;
+      for (size_t b : hot_blocks) {
+            const Block& block = blocks[b];
+            const address_t start = address_of(block.first);
+            output << std::setw(14) << block.instructions << std::setw(8) << percent(block.instructions, total) << std::setw(14) << counts[block.first]
+                   << "  " << hex(start) << "  " << hex(address_of(block.last)) << "  " << std::setw(6) << line_of(start) << "  " << symbolize(start) << std::endl;
+      }
+      output << std::endl;
+
+      /** Branches */
+      std::vector<size_t> branches;
+      for (size_t i : executed) {
+            if (kinds[i] == Kind::Branch) branches.push_back(i);
+      }
+      hottest(branches, [&](size_t i) { return counts[i]; });
+
+      output << "Branches:" << std::endl;
+      output << std::setw(14) << "executed" << std::setw(14) << "taken" << std::setw(14) << "not taken" << std::setw(8) << "taken%" << "  address     " << std::setw(6) << "line" << "  instruction" << std::endl;
+      for (size_t i : branches) {
+            output << std::setw(14) << counts[i] << std::setw(14) << taken[i] << std::setw(14) << counts[i] - taken[i] << std::setw(8) << percent(taken[i], counts[i])
+                   << "  " << hex(address_of(i)) << "  " << describe(i) << std::endl;
+      }
+}
+
+/**
+ * @brief Writes the folded call stacks
+ *
+ * @param[o] output
+ */
+void mips::Profiler::write_folded(std::ostream& output) const {
+      std::vector<std::string> names(frames.size());
+      for (size_t i = 0; i < frames.size(); i++) {
+            std::string name = symbolize(frames[i].function);
+
+            /** ';' separates frames and ' ' the count */
+            std::replace(name.begin(), name.end(), ';', '_');
+            std::replace(name.begin(), name.end(), ' ', '_');
+            names[i] = i == 0 ? name : names[frames[i].parent] + ";" + name;
+      }
+
+      for (size_t i = 0; i < frames.size(); i++) {
+            if (samples[i] != 0) output << names[i] << " " << samples[i] << "\n";
+      }
+      output.flush();
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
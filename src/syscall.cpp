@@ -0,0 +1,215 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <cstdlib>
+
+/** Mips Includes */
+#include <syscall.hpp>
+#include <cpu.hpp>
+#include <memory.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ */
+mips::StreamIO::StreamIO(std::istream& input, std::ostream& output) : input(input), output(output) {
+      buffer.reserve(IO_BUFFER_SIZE);
+}
+
+/**
+ * @brief Destructor
+ */
+mips::StreamIO::~StreamIO() {
+      flush();
+}
+
+/**
+ * @brief Buffers program output
+ * 
+ * @param[i] data 
+ */
+void mips::StreamIO::write(std::string_view data) {
+      if (buffer.size() + data.size() > IO_BUFFER_SIZE) flush();
+
+      /** Large writes skip the buffer */
+      if (data.size() > IO_BUFFER_SIZE) output.write(data.data(), data.size());
+      else buffer.append(data);
+}
+
+/**
+ * @brief Reads a line of input
+ * 
+ * @param[o] line 
+ * @return true/false
+ */
+bool mips::StreamIO::read_line(std::string& line) {
+      flush();
+      return static_cast<bool>(std::getline(input, line));
+}
+
+/**
+ * @brief Reads a character of input
+ * 
+ * @return int 
+ */
+int mips::StreamIO::read_char() {
+      flush();
+      int c = input.get();
+      return c == std::istream::traits_type::eof() ? IO_EOF : c;
+}
+
+/**
+ * @brief Writes the buffered output to the stream
+ */
+void mips::StreamIO::flush() {
+      if (buffer.empty()) return;
+      output.write(buffer.data(), buffer.size());
+      output.flush();
+      buffer.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ */
+mips::BufferIO::BufferIO(std::string input) : input(std::move(input)) {}
+
+/**
+ * @brief Collects program output
+ * 
+ * @param[i] data 
+ */
+void mips::BufferIO::write(std::string_view data) {
+      output.append(data);
+}
+
+/**
+ * @brief Reads a line of the preloaded input
+ * 
+ * @param[o] line 
+ * @return true/false
+ */
+bool mips::BufferIO::read_line(std::string& line) {
+      if (position >= input.size()) return false;
+
+      size_t end = input.find('\n', position);
+      if (end == std::string::npos) end = input.size();
+
+      line.assign(input, position, end - position);
+      position = end + 1;
+      return true;
+}
+
+/**
+ * @brief Reads a character of the preloaded input
+ * 
+ * @return int 
+ */
+int mips::BufferIO::read_char() {
+      if (position >= input.size()) return IO_EOF;
+      return static_cast<unsigned char>(input[position++]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Gets the handler every CPU starts with
+ * 
+ * @return StandardSyscalls& 
+ */
+mips::StandardSyscalls& mips::StandardSyscalls::standard() {
+      static StreamIO io(std::cin, std::cout);
+      static StandardSyscalls handler(&io);
+      return handler;
+}
+
+/**
+ * @brief Executes the syscall selected by $v0
+ * 
+ * @details read_string follows SPIM: reads at most $a1 - 1 characters of a
+ *          line into the buffer at $a0, keeping the newline if it fits, and
+ *          null terminates it.
+ * 
+ * @param[io] cpu 
+ * @param[io] memory 
+ * @return SyscallResult 
+ */
+mips::SyscallResult mips::StandardSyscalls::execute(CPU& cpu, Memory& memory) {
+      const register_t a0 = cpu.get_register(4);
+      const register_t a1 = cpu.get_register(5);
+      written_size = 0;
+
+      switch (cpu.get_register(2)) {
+            case 1: { // print_int (print an integer)
+                  io->write(std::to_string(static_cast<int32_t>(a0)));
+                  break;
+            }
+            case 4: { // print_string (print a null terminated string)
+                  io->write(memory.read_string(a0));
+                  break;
+            }
+            case 5: { // read_int (read an integer into $v0)
+                  std::string line;
+                  register_t value = 0;
+                  if (io->read_line(line)) value = static_cast<register_t>(std::strtol(line.c_str(), nullptr, 10));
+                  cpu.set_register(2, value);
+                  break;
+            }
+            case 8: { // read_string (read a line into the buffer at $a0, of size $a1)
+                  if (a1 == 0) break;
+
+                  std::string line;
+                  if (io->read_line(line)) line += '\n';
+                  if (line.size() > a1 - 1) line.resize(a1 - 1);
+
+                  /** Copies the terminator too */
+                  memory.write_block(reinterpret_cast<const byte_t*>(line.c_str()), line.size() + 1, a0);
+                  written_address = a0;
+                  written_size = line.size() + 1;
+                  break;
+            }
+            // TODO: Add support for sbrk
+            /*case 9: // sbrk (allocate memory on the heap)
+                  break; */
+            case 10: // exit (exit the program)
+                  return SyscallResult::Halt;
+            case 11: { // print_char (print the character in $a0)
+                  char c = static_cast<char>(a0);
+                  io->write(std::string_view(&c, 1));
+                  break;
+            }
+            case 12: { // read_char (read a character into $v0)
+                  cpu.set_register(2, static_cast<register_t>(io->read_char()));
+                  break;
+            }
+            default:
+                  return SyscallResult::Invalid;
+      }
+      return SyscallResult::Continue;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
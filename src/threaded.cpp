@@ -0,0 +1,397 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <stdexcept>
+
+/** Mips Includes */
+#include <threaded.hpp>
+#include <handlers.hpp>
+
+/** Labels as values are a GNU extension */
+#if MIPS_COMPUTED_GOTO
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Dispatch macros. With computed gotos every operation jumps straight to the
+ * next one, otherwise operations are the cases of a switch inside a loop.
+ */
+#if MIPS_COMPUTED_GOTO
+#define DISPATCH_BEGIN()      goto *ip->label;
+#define DISPATCH_END()
+#define OP(name)              label_##name:
+#define PSEUDO_OP(kind)       label_##kind:
+#define NEXT()                { ++ip; goto *ip->label; }
+#else
+#define DISPATCH_BEGIN()      for (;;) { switch (ip->kind) {
+#define DISPATCH_END()        default: throw std::runtime_error("Invalid threaded operation"); } }
+#define OP(name)              case static_cast<byte_t>(Operation::name):
+#define PSEUDO_OP(kind)       case kind:
+#define NEXT()                { ++ip; continue; }
+#endif
+
+/** Leaves the block if the operation faulted; the faulting instruction does not retire */
+#define CHECK_FAULT() \
+      if (cpu.status != Status::Running) { \
+            retired += ip - block->ops.data(); \
+            goto stopped; \
+      }
+
+/** Leaves the block after a store to a translated page, before running stale operations */
+#define CHECK_CODE_WRITE() \
+      if (memory->get_code_version() != code_version) { \
+            cpu.pc = ip->decoded.pc + sizeof(instruction_t); \
+            retired += ip - block->ops.data() + 1; \
+            goto block_exit; \
+      }
+
+/** Control transfers see the program counter of the next instruction, then end the block */
+#define TRANSFER(handler) \
+      cpu.pc = ip->decoded.pc + sizeof(instruction_t); \
+      Handlers::handler(cpu, ip->decoded); \
+      goto block_done;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Checks if the given operation ends a basic block
+ *
+ * @param[i] op
+ * @return true/false
+ */
+static inline bool ends_block(mips::Operation op) {
+      switch (op) {
+            case mips::Operation::Jr:
+            case mips::Operation::Jalr:
+            case mips::Operation::Syscall:
+            case mips::Operation::Break:
+            case mips::Operation::Beq:
+            case mips::Operation::Bne:
+            case mips::Operation::Blez:
+            case mips::Operation::Bgtz:
+            case mips::Operation::Bltz:
+            case mips::Operation::Bgez:
+            case mips::Operation::Bltzal:
+            case mips::Operation::Bgezal:
+            case mips::Operation::J:
+            case mips::Operation::Jal:
+            case mips::Operation::Invalid:
+                  return true;
+            default:
+                  return false;
+      }
+}
+
+/**
+ * @brief Returns the dispatch label of the given operation kind
+ *
+ * @param[i] labels The label table (null without computed goto)
+ * @param[i] kind
+ * @return const void*
+ */
+static inline const void* label_for(const void* const* labels, mips::byte_t kind) {
+      return labels != nullptr ? labels[kind] : nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ */
+mips::ThreadedEngine::ThreadedEngine(CPU* cpu, Memory* memory) {
+      this->cpu = cpu;
+      this->memory = memory;
+      this->code_version = memory->get_code_version();
+}
+
+/**
+ * @brief Drops every translated block
+ */
+void mips::ThreadedEngine::flush() {
+      blocks.clear();
+      code_version = memory->get_code_version();
+}
+
+/**
+ * @brief Translates the basic block starting at the given address
+ *
+ * @param[i] pc
+ * @param[i] labels
+ * @return Block*
+ */
+mips::ThreadedEngine::Block* mips::ThreadedEngine::translate(address_t pc, const void* const* labels) {
+      std::unique_ptr<Block> block = std::make_unique<Block>();
+      address_t address = pc;
+
+      while (block->ops.size() < MAX_BLOCK_LENGTH) {
+            ThreadedOp op;
+            try {
+                  cpu->decode(cpu->fetch(address), op.decoded);
+            } catch (const AccessViolation&) {
+                  /** Stop short of the bad address; it faults when the block falls into it */
+                  if (block->ops.empty()) throw;
+                  break;
+            }
+            op.decoded.pc = address;
+            op.kind = static_cast<byte_t>(op.decoded.op);
+            op.label = labels != nullptr ? labels[op.kind] : nullptr;
+            block->ops.push_back(op);
+            address += sizeof(instruction_t);
+
+            if (ends_block(op.decoded.op)) break;
+      }
+
+      /** Falling off the end continues at the next address */
+      ThreadedOp end;
+      end.decoded.pc = address;
+      end.kind = BLOCK_END;
+      end.label = label_for(labels, BLOCK_END);
+      block->ops.push_back(end);
+
+      block->length = block->ops.size() - 1;
+      block->successor[0] = block->successor[1] = nullptr;
+      block->successor_pc[0] = block->successor_pc[1] = 0;
+
+      Block* translated = block.get();
+      blocks[pc] = std::move(block);
+      return translated;
+}
+
+/**
+ * @brief Returns the block starting at the given address
+ *
+ * @param[i] previous
+ * @param[i] pc
+ * @param[i] labels
+ * @return Block*
+ */
+mips::ThreadedEngine::Block* mips::ThreadedEngine::next_block(Block* previous, address_t pc, const void* const* labels) {
+      if (previous != nullptr) {
+            if (previous->successor[0] != nullptr && previous->successor_pc[0] == pc) return previous->successor[0];
+            if (previous->successor[1] != nullptr && previous->successor_pc[1] == pc) return previous->successor[1];
+      }
+
+      Block* block;
+      auto it = blocks.find(pc);
+      if (it != blocks.end()) block = it->second.get();
+      else block = translate(pc, labels);
+
+      /** Chain it, evicting the older successor */
+      if (previous != nullptr) {
+            previous->successor[1] = previous->successor[0];
+            previous->successor_pc[1] = previous->successor_pc[0];
+            previous->successor[0] = block;
+            previous->successor_pc[0] = pc;
+      }
+      return block;
+}
+
+/**
+ * @brief Runs the CPU through translated blocks
+ *
+ * @details Control transfers always end a block, so they set the program
+ *          counter themselves. Straight-line operations leave it stale; it is
+ *          only written back when leaving the block.
+ *
+ *          Syscalls, breaks and invalid instructions always end a block, so
+ *          the CPU status is only checked between blocks, and after the
+ *          few straight-line operations that can fault (overflowing
+ *          arithmetic and misaligned accesses).
+ *
+ *          When fewer instructions are left in the budget than in the block,
+ *          the operation at the budget limit is temporarily turned into a
+ *          BUDGET_EXIT, so the hot path never counts instructions.
+ *
+ * @param[i] budget
+ * @return uint64_t
+ */
+uint64_t mips::ThreadedEngine::run(uint64_t budget) {
+#if MIPS_COMPUTED_GOTO
+      static const void* const labels[] = {
+      #define MIPS_OPERATION_LABEL(operation, handler) &&label_##operation,
+            MIPS_OPERATIONS(MIPS_OPERATION_LABEL)
+      #undef MIPS_OPERATION_LABEL
+            &&label_BLOCK_END, &&label_BUDGET_EXIT
+      };
+      static_assert(sizeof(labels) / sizeof(labels[0]) == BUDGET_EXIT + 1, "Label table out of sync with the pseudo operations");
+#else
+      const void* const* labels = nullptr;
+#endif
+
+      using Handlers = CPU::Handlers;
+
+      CPU& cpu = *this->cpu;
+      if (cpu.status != Status::Running) return 0;
+
+      uint64_t retired = 0;
+      Block* block = nullptr;
+      ThreadedOp* ip = nullptr;
+
+      /** Operation turned into a BUDGET_EXIT and its original kind */
+      ThreadedOp* patched = nullptr;
+      byte_t patched_kind = 0;
+
+      auto unpatch = [&]() {
+            if (patched == nullptr) return;
+            patched->kind = patched_kind;
+            patched->label = label_for(labels, patched_kind);
+            patched = nullptr;
+      };
+
+      try {
+            while (retired < budget) {
+                  unpatch();
+
+                  /** The program wrote to a page we translated from */
+                  if (code_version != memory->get_code_version()) {
+                        flush();
+                        block = nullptr;
+                  }
+
+                  ip = nullptr;
+                  block = next_block(block, cpu.pc, labels);
+
+                  uint64_t left = budget - retired;
+                  if (left < block->length) {
+                        patched = &block->ops[left];
+                        patched_kind = patched->kind;
+                        patched->kind = BUDGET_EXIT;
+                        patched->label = label_for(labels, BUDGET_EXIT);
+                  }
+
+                  ip = block->ops.data();
+                  DISPATCH_BEGIN()
+
+                  /** R-type */
+                  OP(Add)     Handlers::op_add(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Addu)    Handlers::op_addu(cpu, ip->decoded); NEXT();
+                  OP(Sub)     Handlers::op_sub(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Subu)    Handlers::op_subu(cpu, ip->decoded); NEXT();
+                  OP(And)     Handlers::op_and(cpu, ip->decoded); NEXT();
+                  OP(Or)      Handlers::op_or(cpu, ip->decoded); NEXT();
+                  OP(Xor)     Handlers::op_xor(cpu, ip->decoded); NEXT();
+                  OP(Nor)     Handlers::op_nor(cpu, ip->decoded); NEXT();
+                  OP(Slt)     Handlers::op_slt(cpu, ip->decoded); NEXT();
+                  OP(Sltu)    Handlers::op_sltu(cpu, ip->decoded); NEXT();
+                  OP(Sll)     Handlers::op_sll(cpu, ip->decoded); NEXT();
+                  OP(Srl)     Handlers::op_srl(cpu, ip->decoded); NEXT();
+                  OP(Sra)     Handlers::op_sra(cpu, ip->decoded); NEXT();
+                  OP(Sllv)    Handlers::op_sllv(cpu, ip->decoded); NEXT();
+                  OP(Srlv)    Handlers::op_srlv(cpu, ip->decoded); NEXT();
+                  OP(Srav)    Handlers::op_srav(cpu, ip->decoded); NEXT();
+                  OP(Mult)    Handlers::op_mult(cpu, ip->decoded); NEXT();
+                  OP(Multu)   Handlers::op_multu(cpu, ip->decoded); NEXT();
+                  OP(Div)     Handlers::op_div(cpu, ip->decoded); NEXT();
+                  OP(Divu)    Handlers::op_divu(cpu, ip->decoded); NEXT();
+                  OP(Mfhi)    Handlers::op_mfhi(cpu, ip->decoded); NEXT();
+                  OP(Mflo)    Handlers::op_mflo(cpu, ip->decoded); NEXT();
+                  OP(Mthi)    Handlers::op_mthi(cpu, ip->decoded); NEXT();
+                  OP(Mtlo)    Handlers::op_mtlo(cpu, ip->decoded); NEXT();
+                  OP(Jr)      TRANSFER(op_jr);
+                  OP(Jalr)    TRANSFER(op_jalr);
+                  OP(Syscall) TRANSFER(op_syscall);
+                  OP(Break)   Handlers::op_break(cpu, ip->decoded); goto block_done;
+
+                  /** I-type */
+                  OP(Lb)      Handlers::op_lb(cpu, ip->decoded); NEXT();
+                  OP(Lbu)     Handlers::op_lbu(cpu, ip->decoded); NEXT();
+                  OP(Lh)      Handlers::op_lh(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Lhu)     Handlers::op_lhu(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Lw)      Handlers::op_lw(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Sb)      Handlers::op_sb(cpu, ip->decoded); CHECK_CODE_WRITE(); NEXT();
+                  OP(Sh)      Handlers::op_sh(cpu, ip->decoded); CHECK_FAULT(); CHECK_CODE_WRITE(); NEXT();
+                  OP(Sw)      Handlers::op_sw(cpu, ip->decoded); CHECK_FAULT(); CHECK_CODE_WRITE(); NEXT();
+                  OP(Addi)    Handlers::op_addi(cpu, ip->decoded); CHECK_FAULT(); NEXT();
+                  OP(Addiu)   Handlers::op_addiu(cpu, ip->decoded); NEXT();
+                  OP(Slti)    Handlers::op_slti(cpu, ip->decoded); NEXT();
+                  OP(Sltiu)   Handlers::op_sltiu(cpu, ip->decoded); NEXT();
+                  OP(Lui)     Handlers::op_lui(cpu, ip->decoded); NEXT();
+                  OP(Andi)    Handlers::op_andi(cpu, ip->decoded); NEXT();
+                  OP(Ori)     Handlers::op_ori(cpu, ip->decoded); NEXT();
+                  OP(Xori)    Handlers::op_xori(cpu, ip->decoded); NEXT();
+                  OP(Beq)     TRANSFER(op_beq);
+                  OP(Bne)     TRANSFER(op_bne);
+                  OP(Blez)    TRANSFER(op_blez);
+                  OP(Bgtz)    TRANSFER(op_bgtz);
+                  OP(Bltz)    TRANSFER(op_bltz);
+                  OP(Bgez)    TRANSFER(op_bgez);
+                  OP(Bltzal)  TRANSFER(op_bltzal);
+                  OP(Bgezal)  TRANSFER(op_bgezal);
+
+                  /** J-type */
+                  OP(J)       TRANSFER(op_j);
+                  OP(Jal)     TRANSFER(op_jal);
+
+                  /** Invalid */
+                  OP(Invalid) Handlers::op_invalid(cpu, ip->decoded); goto block_done;
+
+                  /** Pseudo operations */
+                  PSEUDO_OP(BLOCK_END)
+                              cpu.pc = ip->decoded.pc;
+                              goto block_done;
+                  PSEUDO_OP(BUDGET_EXIT)
+                              cpu.pc = ip->decoded.pc;
+                              retired += ip - block->ops.data();
+                              goto block_exit;
+
+                  DISPATCH_END()
+
+            block_done:
+                  retired += block->length;
+
+                  /** Only the last operation of a block can stop the CPU; a faulting one does not retire */
+                  if (cpu.status != Status::Running) {
+                        if (cpu.status == Status::Faulted) retired--;
+                        break;
+                  }
+            block_exit:;
+            }
+      stopped:;
+      }
+      catch (const AccessViolation& violation) {
+            /** The operations before the faulting one retired */
+            address_t address = cpu.pc;
+            if (ip != nullptr) {
+                  address = ip->decoded.pc;
+                  retired += ip - block->ops.data();
+            }
+            unpatch();
+            cpu.raise_access_violation(violation, address);
+            return retired;
+      }
+      catch (...) {
+            /** Point at the faulting instruction */
+            if (ip != nullptr) cpu.pc = ip->decoded.pc;
+            unpatch();
+            throw;
+      }
+
+      unpatch();
+      return retired;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file
@@ -0,0 +1,338 @@
+//
+// Created by JoaoAJMatos on 2026-10-16
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+
+/** Mips Includes */
+#include <trace.hpp>
+#include <except.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** How long the writer thread sleeps when the ring is empty */
+constexpr std::chrono::microseconds TRACE_IDLE(200);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Copies as many bytes as fit into the ring
+ *
+ * @param[i] data
+ * @param[i] size
+ * @return size_t
+ */
+size_t mips::TraceRing::push(const byte_t* data, size_t size) {
+      const uint64_t written = head.load(std::memory_order_relaxed);
+      const uint64_t free = buffer.size() - (written - tail.load(std::memory_order_acquire));
+      size = std::min<uint64_t>(size, free);
+
+      const size_t offset = written & (buffer.size() - 1);
+      const size_t first = std::min(size, buffer.size() - offset);
+      std::memcpy(buffer.data() + offset, data, first);
+      std::memcpy(buffer.data(), data + first, size - first);
+
+      head.store(written + size, std::memory_order_release);
+      return size;
+}
+
+/**
+ * @brief Copies as many bytes as are available out of the ring
+ *
+ * @param[o] data
+ * @param[i] size
+ * @return size_t
+ */
+size_t mips::TraceRing::pop(byte_t* data, size_t size) {
+      const uint64_t read = tail.load(std::memory_order_relaxed);
+      const uint64_t available = head.load(std::memory_order_acquire) - read;
+      size = std::min<uint64_t>(size, available);
+
+      const size_t offset = read & (buffer.size() - 1);
+      const size_t first = std::min(size, buffer.size() - offset);
+      std::memcpy(data, buffer.data() + offset, first);
+      std::memcpy(data + first, buffer.data(), size - first);
+
+      tail.store(read + size, std::memory_order_release);
+      return size;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Opens the file and starts the writer thread
+ *
+ * @param[i] filename
+ */
+mips::TraceWriter::TraceWriter(const std::string& filename) : file(filename, std::ios::binary), ring(TRACE_RING_SIZE) {
+      if (!file.is_open()) throw FileException("Failed to open " + filename);
+      thread = std::thread(&TraceWriter::drain, this);
+}
+
+/**
+ * @brief Drains the ring and stops the thread, if close() was not called
+ */
+mips::TraceWriter::~TraceWriter() {
+      done.store(true, std::memory_order_release);
+      if (thread.joinable()) thread.join();
+}
+
+/**
+ * @brief Hands bytes to the writer thread
+ *
+ * @param[i] data
+ * @param[i] size
+ */
+void mips::TraceWriter::write(const byte_t* data, size_t size) {
+      while (size != 0) {
+            const size_t pushed = ring.push(data, size);
+            data += pushed;
+            size -= pushed;
+            if (size != 0) std::this_thread::yield();
+      }
+}
+
+/**
+ * @brief Drains the ring, stops the thread and closes the file
+ */
+void mips::TraceWriter::close() {
+      done.store(true, std::memory_order_release);
+      if (thread.joinable()) thread.join();
+
+      file.close();
+      if (file.fail()) throw FileException("Failed to write the trace");
+}
+
+/**
+ * @brief Writer thread: moves the ring to the file until closed
+ *
+ * @details done is checked before the ring is emptied, so the bytes pushed
+ *          before close() are always written.
+ */
+void mips::TraceWriter::drain() {
+      std::vector<byte_t> block(TRACE_CHUNK * 4);
+      for (;;) {
+            const bool closing = done.load(std::memory_order_acquire);
+            size_t size;
+            while ((size = ring.pop(block.data(), block.size())) != 0) {
+                  file.write(reinterpret_cast<const char*>(block.data()), size);
+            }
+            if (closing) return;
+            std::this_thread::sleep_for(TRACE_IDLE);
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constructor
+ *
+ * @details The effects of every operation are taken from its operand
+ *          syntax in INSTRUCTIONS. syscall is traced as writing $v0, the
+ *          register the reading syscalls return in.
+ *
+ * @param[i] filename
+ */
+mips::TraceRecorder::TraceRecorder(const std::string& filename) : writer(filename) {
+      cursor = chunk.data();
+      operations.fill({ 0, Field::None, 0, 0 });
+
+      for (const InstructionInfo& info : INSTRUCTIONS) {
+            Effects& effects = operations[static_cast<size_t>(info.op)];
+            switch (info.syntax) {
+                  case Syntax::RdRsRt:
+                  case Syntax::RdRtShamt:
+                  case Syntax::RdRtRs:
+                  case Syntax::Rd:
+                  case Syntax::RdRs:
+                        effects = { TRACE_REGISTER, Field::Rd, 0, 0 };
+                        break;
+                  case Syntax::RtRsImmediate:
+                  case Syntax::RtImmediate:
+                        effects = { TRACE_REGISTER, Field::Rt, 0, 0 };
+                        break;
+                  default:
+                        break;
+            }
+      }
+
+      auto memory = [&](Operation op, byte_t flags, byte_t size_log2) {
+            const word_t mask = size_log2 == 2 ? 0xFFFFFFFF : (word_t(1) << (8 << size_log2)) - 1;
+            const Field destination = flags == TRACE_LOAD ? Field::Rt : Field::None;
+            const byte_t written = flags == TRACE_LOAD ? TRACE_REGISTER : 0;
+            operations[static_cast<size_t>(op)] = { static_cast<byte_t>(flags | written | (size_log2 << TRACE_SIZE_SHIFT)), destination, 0, mask };
+      };
+      memory(Operation::Lb, TRACE_LOAD, 0);
+      memory(Operation::Lbu, TRACE_LOAD, 0);
+      memory(Operation::Lh, TRACE_LOAD, 1);
+      memory(Operation::Lhu, TRACE_LOAD, 1);
+      memory(Operation::Lw, TRACE_LOAD, 2);
+      memory(Operation::Sb, TRACE_STORE, 0);
+      memory(Operation::Sh, TRACE_STORE, 1);
+      memory(Operation::Sw, TRACE_STORE, 2);
+
+      for (Operation op : { Operation::Jal, Operation::Bltzal, Operation::Bgezal }) {
+            operations[static_cast<size_t>(op)] = { TRACE_REGISTER, Field::Fixed, 31, 0 };
+      }
+      operations[static_cast<size_t>(Operation::Syscall)] = { TRACE_REGISTER, Field::Fixed, 2, 0 };
+      for (Operation op : { Operation::Mult, Operation::Multu, Operation::Div, Operation::Divu, Operation::Mthi, Operation::Mtlo }) {
+            operations[static_cast<size_t>(op)] = { TRACE_HILO, Field::None, 0, 0 };
+      }
+
+      const byte_t version = TRACE_VERSION;
+      writer.write(reinterpret_cast<const byte_t*>(TRACE_MAGIC), sizeof(TRACE_MAGIC));
+      writer.write(&version, 1);
+      bytes = sizeof(TRACE_MAGIC) + 1;
+}
+
+/**
+ * @brief Records the last instruction, unless it faulted, and closes the trace
+ *
+ * @param[i] cpu
+ */
+void mips::TraceRecorder::finish(const CPU& cpu) {
+      if (pending && cpu.get_status() != Status::Faulted) record(cpu);
+      pending = false;
+      flush();
+      writer.close();
+}
+
+/**
+ * @brief Hands the chunk to the writer
+ */
+void mips::TraceRecorder::flush() {
+      writer.write(chunk.data(), cursor - chunk.data());
+      cursor = chunk.data();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Opens a trace
+ *
+ * @param[i] filename
+ */
+mips::TraceReader::TraceReader(const std::string& filename) : file(filename, std::ios::binary) {
+      if (!file.is_open()) throw FileException("Failed to open " + filename);
+
+      char header[sizeof(TRACE_MAGIC) + 1];
+      file.read(header, sizeof(header));
+      if (!file || std::memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) throw FileException(filename + " is not a trace");
+      if (static_cast<byte_t>(header[sizeof(TRACE_MAGIC)]) != TRACE_VERSION) throw FileException(filename + ": unsupported trace version");
+}
+
+/**
+ * @brief Reads a varint
+ *
+ * @return word_t
+ */
+mips::word_t mips::TraceReader::get_varint() {
+      word_t number = 0;
+      for (int shift = 0; shift < 35; shift += 7) {
+            const int byte = file.get();
+            if (byte == EOF) throw FileException("Truncated trace");
+            number |= word_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return number;
+      }
+      throw FileException("Corrupted trace");
+}
+
+/**
+ * @brief Reads a zigzag encoded delta
+ *
+ * @return word_t
+ */
+mips::word_t mips::TraceReader::get_delta() {
+      const word_t zigzag = get_varint();
+      return (zigzag >> 1) ^ (0 - (zigzag & 1));
+}
+
+/**
+ * @brief Reads the next record
+ *
+ * @param[o] record
+ * @return bool
+ */
+bool mips::TraceReader::next(TraceRecord& record) {
+      const int flags = file.get();
+      if (flags == EOF) return false;
+
+      record = {};
+      record.flags = static_cast<byte_t>(flags);
+      record.pc = next_pc;
+      if (record.flags & TRACE_JUMP) record.pc += get_delta();
+      next_pc = record.pc + sizeof(instruction_t);
+
+      if (record.flags & TRACE_REGISTER) {
+            const int reg = file.get();
+            if (reg == EOF || reg >= 32) throw FileException("Corrupted trace");
+            record.reg = static_cast<byte_t>(reg);
+            registers[reg] += get_delta();
+            record.value = registers[reg];
+      }
+      if (record.flags & TRACE_HILO) {
+            hi += get_delta();
+            lo += get_delta();
+            record.hi = hi;
+            record.lo = lo;
+      }
+      if (record.flags & (TRACE_LOAD | TRACE_STORE)) {
+            last_address += get_delta();
+            record.address = last_address;
+            record.size = word_t(1) << ((record.flags & TRACE_SIZE) >> TRACE_SIZE_SHIFT);
+      }
+      if (record.flags & TRACE_STORE) record.stored = get_varint();
+      return true;
+}
+
+/**
+ * @brief Writes a trace as text, one retired instruction per line
+ *
+ * @param[i] filename
+ * @param[o] output
+ */
+void mips::dump_trace(const std::string& filename, std::ostream& output) {
+      TraceReader reader(filename);
+      TraceRecord record;
+
+      output << std::hex << std::setfill('0');
+      while (reader.next(record)) {
+            output << "0x" << std::setw(8) << record.pc;
+            if (record.flags & TRACE_REGISTER) output << "  $" << std::dec << int(record.reg) << std::hex << " = 0x" << std::setw(8) << record.value;
+            if (record.flags & TRACE_HILO) output << "  hi = 0x" << std::setw(8) << record.hi << "  lo = 0x" << std::setw(8) << record.lo;
+            if (record.flags & TRACE_LOAD) output << "  load" << std::dec << record.size << std::hex << " [0x" << std::setw(8) << record.address << "]";
+            if (record.flags & TRACE_STORE) {
+                  output << "  store" << std::dec << record.size << std::hex << " [0x" << std::setw(8) << record.address << "] = 0x"
+                         << std::setw(2 * record.size) << record.stored;
+            }
+            output << "\n";
+      }
+      output << std::dec << std::setfill(' ');
+      output.flush();
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
\ No newline at end of file